@@ -0,0 +1,92 @@
+#include <vector>
+#include <random>
+#include "benchmark.hpp"
+#include "gamelib/utils/BatchAllocator.hpp"
+
+// Fragmentation stress test: keeps a number of blocks of random sizes
+// alive and replaces random ones, like particles or destructible brushes
+// creating and freeing meshes. Optionally every second block is freed
+// beforehand, leaving lots of small holes. Reports the time per free +
+// allocate pair and the allocator's size relative to the live elements.
+// The time per operation should not depend on the number of blocks.
+// Afterwards the allocator is compacted in steps of compactbudget elements.
+
+using namespace gamelib;
+
+constexpr size_t numops = 200000;
+constexpr size_t compactbudget = 4096;
+
+void run(size_t numblocks, size_t maxsize, bool holes)
+{
+    std::mt19937 rng(1337);
+    std::uniform_int_distribution<size_t> sizes(1, maxsize);
+    std::uniform_int_distribution<size_t> pick(0, numblocks - 1);
+
+    BatchAllocator<float> alloc;
+    std::vector<BatchHandle> blocks;
+    size_t live = 0;
+
+    for (size_t i = 0; i < numblocks; ++i)
+    {
+        blocks.push_back(alloc.allocate(sizes(rng)));
+        live += blocks.back().size;
+    }
+
+    if (holes)
+    {
+        for (size_t i = 0; i < numblocks; i += 2)
+        {
+            live -= blocks[i].size;
+            alloc.free(blocks[i]);
+        }
+
+        for (size_t i = 0; i < numblocks / 2; ++i)
+            blocks[i] = blocks[i * 2 + 1];
+        blocks.resize(numblocks / 2);
+        pick = std::uniform_int_distribution<size_t>(0, blocks.size() - 1);
+    }
+
+    double optime = bench::measure(numops, [&]() {
+            BatchHandle& handle = blocks[pick(rng)];
+            live -= handle.size;
+            alloc.free(handle);
+            handle = alloc.allocate(sizes(rng));
+            live += handle.size;
+            *alloc.get(handle.index) = 1;
+        });
+
+    // Highest used index + 1 is the allocator's size
+    size_t size = 0;
+    for (auto& i : blocks)
+        size = std::max(size, i.index + i.size);
+
+    std::cout<<blocks.size()<<" blocks of 1-"<<maxsize<<" elements"<<(holes ? " with holes, " : ", ")
+        <<(float)size / live<<"x live size"<<std::endl;
+    bench::report("  free + allocate", optime);
+
+    std::vector<BatchRelocation> relocations;
+    size_t steps = 0, moved = 0;
+    double compacttime = bench::measure(1, [&]() {
+            while (alloc.getNumFreeBlocks() > 0)
+            {
+                relocations.clear();
+                moved += alloc.compact(&relocations, compactbudget);
+                ++steps;
+            }
+        });
+
+    std::cout<<"  compacted "<<moved<<" elements in "<<steps<<" steps"<<std::endl;
+    bench::report("  compact step", steps > 0 ? compacttime / steps : 0);
+}
+
+int main()
+{
+    for (size_t numblocks : { 1000, 10000, 100000 })
+    {
+        run(numblocks, 4, false);
+        run(numblocks, 64, false);
+        run(numblocks, 64, true);
+    }
+
+    return 0;
+}
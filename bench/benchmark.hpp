@@ -0,0 +1,42 @@
+#ifndef GAMELIB_BENCHMARK_HPP
+#define GAMELIB_BENCHMARK_HPP
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Minimal helpers for the benchmarks in this directory.
+
+namespace bench
+{
+    // Prevents the compiler from optimizing away a computed value
+    template <typename T>
+    inline void keep(const T& value)
+    {
+#ifdef __GNUC__
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static const void* volatile sink;
+        sink = &value;
+#endif
+    }
+
+    // Runs f() the given amount of times and returns the average time per
+    // iteration in microseconds.
+    template <typename F>
+    double measure(size_t iterations, F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+            f();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+    }
+
+    inline void report(const std::string& name, double us)
+    {
+        std::cout<<name<<": "<<us<<" us"<<std::endl;
+    }
+}
+
+#endif
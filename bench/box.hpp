@@ -0,0 +1,58 @@
+#ifndef GAMELIB_BENCH_BOX_HPP
+#define GAMELIB_BENCH_BOX_HPP
+
+#include "math/geometry/intersect.hpp"
+#include "gamelib/core/geometry/Collidable.hpp"
+#include "gamelib/core/geometry/flags.hpp"
+
+// Simple solid box used as collision object in benchmarks.
+
+namespace bench
+{
+    class Box : public gamelib::Collidable
+    {
+        public:
+            Box(const math::AABBf& rect) :
+                gamelib::Collidable(gamelib::collision_solid),
+                _rect(rect)
+            {
+                setPosition(rect.pos.asPoint());
+            }
+
+            auto intersect(const math::Point2f& point) const -> bool final override
+            {
+                return math::intersect(_rect, point);
+            }
+
+            auto intersect(const math::Line2f& line) const -> gamelib::Intersection final override
+            {
+                return math::intersect(line, _rect);
+            }
+
+            auto intersect(const math::AABBf& rect) const -> gamelib::Intersection final override
+            {
+                return math::intersect(_rect, rect);
+            }
+
+            auto sweep(const math::AABBf& rect, const math::Vec2f& vel) const -> gamelib::Intersection final override
+            {
+                return math::sweep(rect, vel, _rect);
+            }
+
+            auto getBBox() const -> math::AABBf final override
+            {
+                return _rect;
+            }
+
+        protected:
+            auto _onChanged(const sf::Transform&) -> void final override
+            {
+                _rect.pos = getPosition().asVector();
+            }
+
+        private:
+            math::AABBf _rect;
+    };
+}
+
+#endif
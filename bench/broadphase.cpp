@@ -0,0 +1,81 @@
+#include <vector>
+#include <memory>
+#include <random>
+#include "benchmark.hpp"
+#include "box.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+#include "gamelib/core/geometry/AABBTree.hpp"
+#include "gamelib/core/geometry/LinearBroadphase.hpp"
+
+// Compares the default AABBTree broadphase with a linear scan over all
+// objects for different amounts of static boxes spread over a large level.
+
+using namespace gamelib;
+using bench::Box;
+
+constexpr float worldsize = 20000;
+constexpr size_t numqueries = 1000;
+
+void run(const char* name, size_t numobjs, std::unique_ptr<Broadphase> broadphase)
+{
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> pos(0, worldsize);
+    std::uniform_real_distribution<float> size(8, 64);
+
+    CollisionSystem colsys(std::move(broadphase));
+    std::vector<std::unique_ptr<Box>> boxes;
+    boxes.reserve(numobjs);
+
+    for (size_t i = 0; i < numobjs; ++i)
+    {
+        boxes.emplace_back(new Box(math::AABBf(pos(rng), pos(rng), size(rng), size(rng))));
+        colsys.add(boxes.back().get());
+    }
+
+    std::vector<math::AABBf> queries;
+    std::vector<math::Vec2f> vels;
+    for (size_t i = 0; i < numqueries; ++i)
+    {
+        queries.emplace_back(pos(rng), pos(rng), 32, 48);
+        vels.emplace_back(size(rng) - 32, size(rng) - 32);
+    }
+
+    size_t q = 0;
+    double intersect = bench::measure(numqueries, [&]() {
+            bench::keep(colsys.intersect(queries[q++ % numqueries], nullptr, collision_solid));
+        });
+
+    q = 0;
+    double trace = bench::measure(numqueries, [&]() {
+            auto& rect = queries[q % numqueries];
+            bench::keep(colsys.trace(rect, vels[q++ % numqueries], nullptr, collision_solid));
+        });
+
+    q = 0;
+    double line = bench::measure(numqueries, [&]() {
+            auto& rect = queries[q % numqueries];
+            math::Line2f seg(rect.getCenter(), vels[q++ % numqueries] * 10, math::Segment);
+            bench::keep(colsys.trace(seg, nullptr, collision_solid));
+        });
+
+    q = 0;
+    double move = bench::measure(numqueries, [&]() {
+            boxes[q++ % numobjs]->move(1, 1);
+        });
+
+    std::cout<<name<<" ("<<numobjs<<" objects)"<<std::endl;
+    bench::report("  intersect(AABB)", intersect);
+    bench::report("  trace(AABB, vel)", trace);
+    bench::report("  trace(Line)", line);
+    bench::report("  move", move);
+}
+
+int main()
+{
+    for (size_t num : { 1000, 10000, 100000 })
+    {
+        run("linear", num, std::unique_ptr<Broadphase>(new LinearBroadphase()));
+        run("aabbtree", num, std::unique_ptr<Broadphase>(new AABBTree()));
+    }
+    return 0;
+}
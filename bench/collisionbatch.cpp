@@ -0,0 +1,86 @@
+#include <vector>
+#include <memory>
+#include <random>
+#include "benchmark.hpp"
+#include "box.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+
+// Compares per-call trace()/intersect() with traceBatch()/intersectBatch()
+// for the queries a frame of 500 QPhysics actors would perform:
+// isStuck(), ground check, movement trace and moving platform snap trace.
+
+using namespace gamelib;
+using bench::Box;
+
+constexpr size_t numactors = 500;
+constexpr size_t numframes = 200;
+constexpr float tilesize = 32;
+constexpr size_t levelwidth = 500;     // tiles
+
+int main()
+{
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> xpos(0, levelwidth * tilesize);
+    std::uniform_real_distribution<float> speed(-200, 200);
+    std::uniform_int_distribution<int> height(1, 6);
+
+    CollisionSystem colsys;
+    std::vector<std::unique_ptr<Box>> tiles;
+
+    // Ground with some pillars
+    for (size_t x = 0; x < levelwidth; ++x)
+    {
+        int h = x % 7 == 0 ? height(rng) : 1;
+        for (int y = 0; y < h; ++y)
+        {
+            tiles.emplace_back(new Box(math::AABBf(x * tilesize, -y * tilesize, tilesize, tilesize)));
+            colsys.add(tiles.back().get());
+        }
+    }
+
+    std::vector<math::AABBf> hulls;
+    std::vector<math::Vec2f> vels;
+    for (size_t i = 0; i < numactors; ++i)
+    {
+        hulls.emplace_back(xpos(rng), -48 - 8 * height(rng), 24, 48);
+        vels.emplace_back(speed(rng), speed(rng));
+    }
+
+    const float frametime = 1.f / 60;
+    const math::Vec2f down(0, 1), snap(0, 15);
+
+    std::vector<IntersectQuery> stuckqueries;
+    std::vector<TraceQuery> tracequeries;
+    std::vector<Collidable*> stuckresults(numactors);
+    std::vector<TraceResult> traceresults(numactors * 3);
+
+    for (size_t i = 0; i < numactors; ++i)
+    {
+        stuckqueries.push_back({ hulls[i], nullptr, collision_solid });
+        tracequeries.push_back({ hulls[i], down, nullptr, collision_solid });
+        tracequeries.push_back({ hulls[i], vels[i] * frametime, nullptr, collision_solid });
+        tracequeries.push_back({ hulls[i], snap, nullptr, collision_solid });
+    }
+
+    double percall = bench::measure(numframes, [&]() {
+            for (size_t i = 0; i < numactors; ++i)
+            {
+                bench::keep(colsys.intersect(hulls[i], nullptr, collision_solid));
+                bench::keep(colsys.trace(hulls[i], down, nullptr, collision_solid));
+                bench::keep(colsys.trace(hulls[i], vels[i] * frametime, nullptr, collision_solid));
+                bench::keep(colsys.trace(hulls[i], snap, nullptr, collision_solid));
+            }
+        });
+
+    double batched = bench::measure(numframes, [&]() {
+            colsys.intersectBatch(stuckqueries.data(), stuckqueries.size(), stuckresults.data());
+            colsys.traceBatch(tracequeries.data(), tracequeries.size(), traceresults.data());
+            bench::keep(stuckresults);
+            bench::keep(traceresults);
+        });
+
+    std::cout<<numactors<<" actors, "<<tiles.size()<<" tiles (per frame)"<<std::endl;
+    bench::report("  per call", percall);
+    bench::report("  batched", batched);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <vector>
+#include <random>
+#include "benchmark.hpp"
+#include "gamelib/core/ecs/ArchetypeStorage.hpp"
+
+// Iterating all entities with two given component types: looking up the
+// components per entity with Entity::findByType() compared to iterating the
+// matching archetypes of an ArchetypeStorage.
+// Half of the entities have both components, the others only one of them.
+// Afterwards random entities are replaced, so new components reuse the
+// memory of destroyed ones, like in a running game.
+// While the storage is active, components are allocated from an arena per
+// type. Before and after that change (GCC -O2, median of 3 runs):
+//     fresh:     findByType() 2690 us -> 2160 us, each() 370 us -> 330 us
+//     replaced:  findByType() 13800 us -> 13900 us, each() 530 us -> 400 us
+
+using namespace gamelib;
+
+constexpr size_t numiters = 20;
+constexpr size_t numentities = 100000;
+
+class PosComponent : public Identifier<0x1d5e7a30, Component>
+{
+    public:
+        ASSIGN_NAMETAG("PosComponent");
+        float x = 0, y = 0;
+};
+
+class VelComponent : public Identifier<0x6a24c0f9, Component>
+{
+    public:
+        ASSIGN_NAMETAG("VelComponent");
+        float x = 1, y = 2;
+};
+
+EntityPtr create(size_t i)
+{
+    EntityPtr ent(new Entity());
+    if (i % 4 != 3)
+        ent->add<PosComponent>();
+    if (i % 4 != 2)
+        ent->add<VelComponent>();
+    return ent;
+}
+
+void run(ArchetypeStorage& storage, std::vector<EntityPtr>& ents)
+{
+    std::cout<<ents.size()<<" entities, "<<storage.count<PosComponent, VelComponent>()
+        <<" with both components"<<std::endl;
+
+    bench::report("  Entity::findByType()", bench::measure(numiters, [&]() {
+            for (auto& ent : ents)
+            {
+                auto pos = ent->findByType<PosComponent>();
+                auto vel = ent->findByType<VelComponent>();
+                if (pos && vel)
+                {
+                    pos->x += vel->x;
+                    pos->y += vel->y;
+                }
+            }
+            bench::keep(ents[0]->findByType<PosComponent>()->x);
+        }));
+
+    bench::report("  ArchetypeStorage::each()", bench::measure(numiters, [&]() {
+            storage.each<PosComponent, VelComponent>([](Entity&, PosComponent& pos, VelComponent& vel) {
+                    pos.x += vel.x;
+                    pos.y += vel.y;
+                });
+            bench::keep(ents[0]->findByType<PosComponent>()->x);
+        }));
+}
+
+int main()
+{
+    ArchetypeStorage storage;
+    std::vector<EntityPtr> ents;
+    ents.reserve(numentities);
+
+    for (size_t i = 0; i < numentities; ++i)
+        ents.push_back(create(i));
+
+    run(storage, ents);
+
+    // Entities log their destruction in debug builds
+    auto coutbuf = std::cout.rdbuf(nullptr);
+
+    std::mt19937 rng(1337);
+    for (size_t n = 0; n < numentities; ++n)
+    {
+        const size_t i = rng() % numentities;
+        ents[i] = create(i);
+    }
+
+    std::cout.rdbuf(coutbuf);
+    std::cout<<"After replacing random entities"<<std::endl;
+    run(storage, ents);
+
+    coutbuf = std::cout.rdbuf(nullptr);
+    ents.clear();
+    std::cout.rdbuf(coutbuf);
+
+    return 0;
+}
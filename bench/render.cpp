@@ -0,0 +1,118 @@
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <SFML/Graphics.hpp>
+#include "benchmark.hpp"
+#include "gamelib/core/rendering/RenderSystem.hpp"
+#include "gamelib/core/rendering/SoftwareRenderer.hpp"
+
+// Reports draw calls and CPU time per frame for a tilemap-like scene of
+// sprite quads sharing one texture, with and without batching, with render
+// lists built on one thread or the thread pool, and the cost of spawning and
+// removing a single node in that scene.
+//
+// Usage: bench_render [--draw | --software] [numsprites]
+// Without --draw only the batches are built, which works headless.
+// --software draws using SoftwareRenderer, which also works headless.
+
+using namespace gamelib;
+
+constexpr size_t numframes = 100;
+
+void run(const char* name, RenderSystem& rendersystem, sf::RenderTarget* target, SoftwareRenderer* software)
+{
+    double frametime = bench::measure(numframes, [&]() {
+            if (target)
+            {
+                target->clear();
+                rendersystem.render(*target);
+            }
+            else if (software)
+            {
+                software->clear();
+                rendersystem.render(*software);
+                software->display();
+            }
+            else
+                bench::keep(rendersystem.updateBatches());
+        });
+
+    std::cout<<name<<" ("<<rendersystem.getNumObjectsRendered()<<" objects, "
+        <<rendersystem.getNumDrawCalls()<<" draw calls)"<<std::endl;
+    bench::report("  per frame", frametime);
+}
+
+int main(int argc, char* argv[])
+{
+    bool draw = false, software = false;
+    int numsprites = 10000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--draw") == 0)
+            draw = true;
+        else if (strcmp(argv[i], "--software") == 0)
+            software = true;
+        else
+            numsprites = atoi(argv[i]);
+    }
+
+    RenderSystem rendersystem;
+    auto tex = TextureResource::create();
+    std::unique_ptr<sf::RenderTexture> target;
+    std::unique_ptr<SoftwareRenderer> softtarget;
+    sf::Image teximage;
+
+    if (draw)
+    {
+        target.reset(new sf::RenderTexture());
+        if (!target->create(1024, 1024) || !tex->create(32, 32))
+        {
+            std::cout<<"Failed to create render target"<<std::endl;
+            return 1;
+        }
+    }
+    else if (software)
+    {
+        softtarget.reset(new SoftwareRenderer(1024, 1024));
+        teximage.create(32, 32, sf::Color::White);
+        softtarget->setTextureImage(tex.get(), &teximage);
+    }
+
+    const sf::Vector2f quad[] = { { 0, 0 }, { 0, 16 }, { 16, 0 }, { 16, 16 } };
+
+    for (int i = 0; i < numsprites; ++i)
+    {
+        NodeHandle handle = rendersystem.createNode(nullptr);
+        rendersystem.createNodeMesh(handle, 4, sf::TriangleStrip);
+        rendersystem.updateNodeMesh(handle, 4, 0, quad, quad);
+        rendersystem.setNodeOptions(handle, nullptr, nullptr, nullptr, &tex);
+        rendersystem.setNodeTransform(handle, sf::Transform().translate(i % 100 * 16, i / 100 * 16));
+    }
+
+    std::cout<<numsprites<<" sprites, "<<(draw ? "drawing" : software ? "drawing in software" : "building batches only")<<std::endl;
+
+    rendersystem.batching = false;
+    run("unbatched", rendersystem, target.get(), softtarget.get());
+
+    rendersystem.batching = true;
+    const size_t threads = rendersystem.threads;
+    rendersystem.threads = 0;
+    run("batched, single thread", rendersystem, target.get(), softtarget.get());
+
+    rendersystem.threads = threads;
+    run("batched, threaded", rendersystem, target.get(), softtarget.get());
+
+    double spawntime = bench::measure(numframes, [&]() {
+            NodeHandle handle = rendersystem.createNode(nullptr);
+            rendersystem.setNodeDepth(handle, rand() % 10);
+            rendersystem.createNodeMesh(handle, 4, sf::TriangleStrip);
+            rendersystem.updateNodeMesh(handle, 4, 0, quad, quad);
+            rendersystem.forceUpdate();
+            rendersystem.removeNode(handle);
+            rendersystem.forceUpdate();
+        });
+    bench::report("spawn and remove one node", spawntime);
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "benchmark.hpp"
+#include "gamelib/utils/SlotMap.hpp"
+#include "gamelib/utils/DenseSlotMap.hpp"
+
+// Iteration cost of SlotMap and DenseSlotMap after churn: the maps are
+// filled to a peak count, then all but a fraction of the objects are
+// destroyed in random order. SlotMap iteration scales with the peak count,
+// DenseSlotMap iteration with the live count.
+
+using namespace gamelib;
+
+constexpr size_t numiters = 1000;
+constexpr size_t peak = 60000;
+
+struct Data
+{
+    void* obj;
+    int nextupdate;
+    float elapsed;
+};
+
+template <typename Map>
+double run(float livefraction)
+{
+    std::mt19937 rng(1337);
+    Map map;
+    std::vector<typename Map::Handle> handles;
+
+    for (size_t i = 0; i < peak; ++i)
+    {
+        handles.push_back(map.acquire());
+        map[handles.back()].nextupdate = 1;
+    }
+
+    std::shuffle(handles.begin(), handles.end(), rng);
+    for (size_t i = peak * livefraction; i < peak; ++i)
+        map.destroy(handles[i]);
+
+    return bench::measure(numiters, [&]() {
+            int sum = 0;
+            for (auto& i : map)
+                sum += i.nextupdate;
+            bench::keep(sum);
+        });
+}
+
+int main()
+{
+    for (float fraction : { 1.f, 0.5f, 0.1f, 0.01f })
+    {
+        std::cout<<peak * fraction<<" of "<<peak<<" objects alive"<<std::endl;
+        bench::report("  SlotMap iteration", run<SlotMapShort<Data>>(fraction));
+        bench::report("  DenseSlotMap iteration", run<DenseSlotMapShort<Data>>(fraction));
+    }
+
+    return 0;
+}
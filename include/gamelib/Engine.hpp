@@ -11,6 +11,7 @@
 #include "core/update/UpdateSystem.hpp"
 #include "core/event/EventManager.hpp"
 #include "core/input/InputSystem.hpp"
+#include "components/update/PhysicsScheduler.hpp"
 
 namespace gamelib
 {
@@ -35,6 +36,7 @@ namespace gamelib
             EntityManager entmgr;
             EntityFactory entfactory;
             UpdateSystem updatesystem;
+            PhysicsScheduler physscheduler;
             EventManager evmgr;
             InputSystem inputsys;
 
@@ -1,6 +1,7 @@
 #ifndef GAMELIB_COLLISIONCOMPONENT_HPP
 #define GAMELIB_COLLISIONCOMPONENT_HPP
 
+#include <string>
 #include "gamelib/utils/Identifier.hpp"
 #include "gamelib/core/ecs/Component.hpp"
 #include "gamelib/core/geometry/Collidable.hpp"
@@ -17,9 +18,20 @@ namespace gamelib
             virtual auto getTransform()       -> Transformable* override;
             virtual auto getTransform() const -> const Transformable* override;
 
+            // Sets the collision layer by name. An empty name refers to the
+            // default layer. Unknown layers fall back to the default layer.
+            auto setLayerName(const std::string& name) -> void;
+            auto getLayerName() const                  -> const std::string&;
+
         protected:
             virtual auto _init() -> bool override;
             virtual auto _quit() -> void override;
+
+        private:
+            auto _updateLayer(CollisionSystem* sys) -> void;
+
+        private:
+            std::string _layername;
     };
 }
 
@@ -10,7 +10,7 @@ namespace gamelib
     class UpdateComponent : public Identifier<0xd0936e0f, Component>, public Updatable
     {
         public:
-            typedef SlotKeyShort Handle;
+            typedef HandleKey Handle;
 
         public:
             UpdateComponent(int interval = 1, UpdateHookType hook = Frame);
@@ -19,6 +19,10 @@ namespace gamelib
             auto setHook(UpdateHookType hook) -> void;
             auto getHook() const              -> UpdateHookType;
 
+            // Returns the scheduler that should run this component's
+            // updates, or nullptr to update it directly (default).
+            virtual auto getScheduler() const -> UpdateScheduler*;
+
         protected:
             virtual auto _init() -> bool override;
             virtual auto _quit() -> void override;
@@ -12,7 +12,7 @@ namespace gamelib
 
         public:
             AABBMask(unsigned int flags = 0);
-            ~AABBMask() {}
+            ~AABBMask();
 
             auto intersect(const math::Point2f& point) const -> bool final override;
             auto intersect(const math::Line2f& line) const   -> Intersection final override;
@@ -20,6 +20,7 @@ namespace gamelib
 
             auto sweep(const math::AABBf& rect, const math::Vec2f& vel) const -> Intersection final override;
 
+            // Returns an empty box if no component is set
             auto getBBox() const -> math::AABBf final override;
 
             auto setComponent(BaseCompRef c) -> bool;
@@ -27,9 +28,11 @@ namespace gamelib
 
         protected:
             auto _onChanged(const sf::Transform&) -> void final override {};
+            auto _onSourceDestroyed(const Transformable* src) -> void final override;
 
         private:
             BaseCompRef _comp;
+            const Transformable* _target;   // _comp's transform, notifies this mask when it changes
     };
 }
 
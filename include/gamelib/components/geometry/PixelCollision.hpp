@@ -3,7 +3,16 @@
 
 #include <SFML/Graphics.hpp>
 #include "gamelib/components/CollisionComponent.hpp"
-#include "gamelib/core/res/TextureResource.hpp"
+#include "gamelib/core/res/CollisionMaskResource.hpp"
+
+/*
+ * Pixel perfect collision shape. Pixels with alpha 0 or the mask color
+ * are empty, everything else is solid.
+ *
+ * Queries use the PixelMask of a CollisionMaskResource. Masks of textures
+ * are shared between all components using the same texture and mask color.
+ * Without an image, nothing collides.
+ */
 
 namespace gamelib
 {
@@ -32,23 +41,38 @@ namespace gamelib
             auto loadFromJson(const Json::Value& node) -> bool final override;
             auto writeToJson(Json::Value& node) const  -> void final override;
 
-            // Queries the ResourceManager or falls back to normal loading
+            // Queries the ResourceManager or falls back to normal loading.
+            // Accepts textures and collision mask files.
             auto loadImageFromFile(const std::string& fname)       -> bool;
+            auto loadImage(const sf::Image& img)                   -> void;
             auto loadImageFromTexture(const sf::Texture& tex)      -> void;
             auto loadImageFromTexture(TextureResource::Handle tex) -> void;
+            auto setCollisionMask(CollisionMaskResource::Handle mask) -> void;
 
-            auto getImage() const -> const sf::Image&;
-            auto getImage()       -> sf::Image&;
+            // Returns nullptr if no image is loaded
+            auto getMask() const -> const PixelMask*;
 
+            // Reloads the current image if it was loaded from a file or
+            // TextureResource, otherwise it applies to the next image.
             auto setMaskColor(sf::Color mask) -> void;
 
         protected:
             virtual auto _onChanged(const sf::Transform& old) -> void override;
 
+        private:
+            // Finds a solid pixel in the given world space rect
+            auto _findPixel(const math::AABBf& rect, math::Vec2i* pixel) const -> bool;
+
+            // Moves rect along vel from time tmin to tmax, using the distance
+            // field to skip empty space. Returns the last time before
+            // touching solid pixels, or tmin if they overlap already.
+            auto _march(const math::AABBf& rect, const math::Vec2f& vel,
+                    float tmin, float tmax, float* time) const -> bool;
+
         protected:
             sf::Color _mask;
             math::AABBf _rect;
-            sf::Image _img;
+            CollisionMaskResource::Handle _pixels;
             std::string _texname;
     };
 }
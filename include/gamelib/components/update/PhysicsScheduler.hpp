@@ -0,0 +1,93 @@
+#ifndef GAMELIB_PHYSICS_SCHEDULER_HPP
+#define GAMELIB_PHYSICS_SCHEDULER_HPP
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "math/geometry/AABB.hpp"
+#include "gamelib/core/Subsystem.hpp"
+#include "gamelib/core/update/UpdateSystem.hpp"
+#include "gamelib/utils/ThreadPool.hpp"
+
+/*
+ * Updates QPhysics components in parallel, when QPhysics::parallel is set.
+ *
+ * Objects are grouped into islands that can't affect each other during
+ * this frame. Every collider of an object is grown by the object's reach
+ * (see QPhysics::getReach()) and reserved in the broadphase (see
+ * CollisionSystem::reserve()). Two objects end up in the same island if
+ * one object's grown colliders overlap a broadphase proxy of the other,
+ * e.g. its reserved area, ground, platforms or collision_physicsdrag
+ * objects. Queries during the update only look at objects whose proxy
+ * overlaps the queried area, so objects of different islands never see
+ * each other. Objects that are only linked, but not due for an update,
+ * are added to the island without being updated.
+ *
+ * Islands are run on a work-stealing thread pool, objects inside an island
+ * are updated sequentially in the order given by the UpdateSystem.
+ * Broadphase updates are deferred and applied in a fixed order afterwards
+ * (see CollisionSystem::beginDeferredRefit()), so results don't depend on
+ * the number of threads or the scheduling order.
+ */
+
+namespace gamelib
+{
+    class QPhysics;
+    class Collidable;
+
+    class PhysicsScheduler : public UpdateScheduler, public Subsystem<PhysicsScheduler>
+    {
+        public:
+            ASSIGN_NAMETAG("PhysicsScheduler");
+
+        public:
+            // The thread pool is created on first use
+            PhysicsScheduler(size_t numthreads = ThreadPool::getDefaultThreads());
+
+            auto update(UpdateComponent* const* objs, const float* elapsed, size_t num) -> void final override;
+
+            // Returns the number of islands found in the last update
+            auto getNumIslands() const -> size_t;
+
+        private:
+            struct Actor
+            {
+                QPhysics* phys;
+                float elapsed;
+                size_t parent;      // union-find, the root is the smallest index
+                bool scheduled;     // false if only linked
+            };
+
+            // Area a collider of a scheduled actor might move in
+            struct Volume
+            {
+                size_t actor;
+                const Collidable* col;
+                math::AABBf area;   // bbox grown by the actor's reach
+            };
+
+            struct Island
+            {
+                size_t begin;
+                size_t end;
+            };
+
+        private:
+            auto _add(QPhysics* phys, float elapsed, bool scheduled) -> size_t;
+            auto _find(size_t actor) -> size_t;
+            auto _unite(size_t a, size_t b) -> void;
+            auto _link() -> void;
+            auto _buildIslands() -> void;
+
+        private:
+            std::unique_ptr<ThreadPool> _pool;
+            size_t _numthreads;
+            std::vector<Actor> _actors;
+            std::vector<Volume> _volumes;
+            std::vector<size_t> _members;   // actor indices ordered by island
+            std::vector<Island> _islands;
+            std::unordered_map<const QPhysics*, size_t> _lookup;
+    };
+}
+
+#endif
@@ -9,6 +9,7 @@ namespace gamelib
     class CollisionComponent;
     class Collidable;
     class TraceResult;
+    class PhysicsScheduler;
 
 
     // Provides properties for global settings (gravity, friction, etc)
@@ -24,6 +25,8 @@ namespace gamelib
 
     class QPhysics : public UpdateComponent
     {
+        friend class PhysicsScheduler;
+
         public:
             ASSIGN_NAMETAG("QPhysicsComponent");
 
@@ -48,6 +51,9 @@ namespace gamelib
 
             virtual auto update(float elapsed) -> void override;
 
+            // Returns the PhysicsScheduler if parallel is enabled
+            virtual auto getScheduler() const -> UpdateScheduler* override;
+
             // Accelerate by a given amount of units/sec in a certain direction
             // Expects wishdir to be a normalized vector.
             // Accelerates in a 1 / accel second to the desired speed.
@@ -65,6 +71,10 @@ namespace gamelib
             auto isStuck(float relx, float rely) const -> bool;
             auto isStuck() const                       -> bool;
 
+            // Returns a conservative estimate of how far the object can
+            // move during update(elapsed), including snapping and nudging.
+            auto getReach(float elapsed) const -> float;
+
             auto getHull() const   -> math::AABBf;
             auto getState() const  -> State;
             auto getGround() const -> const GroundData&;
@@ -85,6 +95,7 @@ namespace gamelib
             static float friction;
             static float stopFriction;
             static float stopSpeed;
+            static bool parallel;   // Update independent objects in parallel, see PhysicsScheduler
 
         public:
             math::Vec2f vel;
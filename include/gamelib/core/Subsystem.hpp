@@ -35,6 +35,12 @@ namespace gamelib
                 return _active;
             }
 
+            // Same as getActive() without the warning, for optional subsystems
+            static auto findActive() -> T*
+            {
+                return _active;
+            }
+
         private:
             static T* _active;
     };
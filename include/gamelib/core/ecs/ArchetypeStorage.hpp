@@ -0,0 +1,179 @@
+#ifndef GAMELIB_ARCHETYPESTORAGE_HPP
+#define GAMELIB_ARCHETYPESTORAGE_HPP
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <utility>
+#include "gamelib/core/Subsystem.hpp"
+#include "gamelib/utils/Identifier.hpp"
+#include "gamelib/utils/ObjectPool.hpp"
+#include "Entity.hpp"
+
+/*
+ * Optional index of entities by archetype, i.e. the set of component types
+ * they have.
+ *
+ * Each archetype stores its entities and one column per component type in
+ * parallel arrays, so querying all entities with a given set of components
+ * only visits matching archetypes and reads their columns sequentially,
+ * instead of finding components per entity with Entity::find(), which
+ * scans the entity's component list and resolves lifetime handles.
+ *
+ * Example:
+ *     storage.each<QPhysics, AABB>([](Entity& ent, QPhysics& phys, AABB& aabb) {
+ *             ...
+ *         });
+ *
+ * Components can't be moved (other systems and the property system keep
+ * pointers to them), so the columns store component pointers. To keep
+ * the components of a column close to each other anyway, components
+ * created by Entity::add() or EntityFactory while the storage is active
+ * are allocated from an ObjectPool arena per component type (see
+ * findArena()). An explicitly set arena, e.g. the level arena of
+ * EntityManager, takes precedence. Entities
+ * move between archetypes in O(number of component types) when a
+ * component is added or removed.
+ * If an entity has multiple components of one type, the column contains
+ * the first one.
+ * Types are told apart by their type index (see getTypeIndex()), not by
+ * their ID, because components of one category share an ID, e.g. AABB and
+ * Polygon are both CollisionComponents.
+ *
+ * While a storage is active (see Subsystem), entities register themselves
+ * when a component is added. Entities that already have components when
+ * the storage is created can be registered using add() or addSubtree().
+ * Entities unregister themselves on destruction.
+ *
+ * Components must not be added or removed while iterating with each().
+ */
+
+namespace gamelib
+{
+    class ArchetypeStorage : public Subsystem<ArchetypeStorage>
+    {
+        friend class Entity;
+
+        public:
+            ASSIGN_NAMETAG("ArchetypeStorage");
+
+            struct Archetype
+            {
+                std::vector<TypeIndex> types;  // sorted, see getTypeIndex()
+                std::vector<Entity*> entities;
+                std::vector<std::vector<Component*>> columns; // parallel to types, rows parallel to entities
+            };
+
+        public:
+            ArchetypeStorage();
+            ~ArchetypeStorage();
+
+            // Registering an entity twice does nothing
+            auto add(Entity* ent)                  -> void;
+            auto addSubtree(Entity* ent)           -> void;
+            auto remove(Entity* ent)               -> void;
+            auto clear()                           -> void;
+            auto size() const                      -> size_t;
+
+            auto getArchetypes() const -> const std::vector<Archetype>&;
+
+            // Returns the arena components of the given type are allocated
+            // from while this storage is active
+            auto getArena(TypeIndex type) -> ObjectPool*;
+
+            // Returns the active storage's arena for the given type or
+            // nullptr if there is no active storage or another arena is set
+            static auto findArena(TypeIndex type) -> ObjectPool*;
+
+            // Calls f(Entity&, T&...) for each registered entity with
+            // components of all the given types
+            template <typename... T, typename F>
+            auto each(F f) -> void;
+
+            // Returns the amount of entities with components of all the
+            // given types
+            template <typename... T>
+            auto count() const -> size_t;
+
+        private:
+            auto _update(Entity* ent) -> void;
+            auto _removeRow(Entity* ent) -> void;
+            auto _findArchetype(std::vector<TypeIndex>&& types) -> size_t;
+
+            // Returns the column index of the given type or -1
+            static auto _findColumn(const Archetype& arch, TypeIndex type) -> size_t;
+
+            template <typename F, typename... T, size_t... I>
+            static auto _eachRow(const Archetype& arch, const size_t* cols, F& f,
+                    std::index_sequence<I...>) -> void;
+
+        private:
+            std::vector<Archetype> _archetypes;     // never removed, so indices stay valid
+            std::map<std::vector<TypeIndex>, size_t> _lookup;
+            std::vector<TypeIndex> _signature;       // reused by _update()
+            std::vector<std::unique_ptr<ObjectPool>> _arenas;  // type index -> component arena
+            size_t _size;
+    };
+}
+
+
+// Implementation
+
+namespace gamelib
+{
+    template <typename... T, typename F>
+    auto ArchetypeStorage::each(F f) -> void
+    {
+        static_assert(sizeof...(T) > 0, "No component types given");
+        const TypeIndex types[] = { getTypeIndex<T>()... };
+        size_t cols[sizeof...(T)];
+
+        for (auto& arch : _archetypes)
+        {
+            if (arch.entities.empty())
+                continue;
+
+            bool match = true;
+            for (size_t i = 0; i < sizeof...(T) && match; ++i)
+            {
+                cols[i] = _findColumn(arch, types[i]);
+                match = cols[i] != (size_t)-1;
+            }
+
+            if (match)
+                _eachRow<F, T...>(arch, cols, f, std::index_sequence_for<T...>());
+        }
+    }
+
+    template <typename... T>
+    auto ArchetypeStorage::count() const -> size_t
+    {
+        static_assert(sizeof...(T) > 0, "No component types given");
+        const TypeIndex types[] = { getTypeIndex<T>()... };
+        size_t n = 0;
+
+        for (auto& arch : _archetypes)
+        {
+            bool match = true;
+            for (size_t i = 0; i < sizeof...(T) && match; ++i)
+                match = _findColumn(arch, types[i]) != (size_t)-1;
+
+            if (match)
+                n += arch.entities.size();
+        }
+
+        return n;
+    }
+
+    template <typename F, typename... T, size_t... I>
+    auto ArchetypeStorage::_eachRow(const Archetype& arch, const size_t* cols, F& f,
+            std::index_sequence<I...>) -> void
+    {
+        const std::vector<Component*>* columns[] = { &arch.columns[cols[I]]... };
+
+        for (size_t row = 0; row < arch.entities.size(); ++row)
+            f(*arch.entities[row], static_cast<T&>(*(*columns[I])[row])...);
+    }
+}
+
+#endif
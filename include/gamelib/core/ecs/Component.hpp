@@ -5,6 +5,7 @@
 #include "gamelib/utils/Identifiable.hpp"
 #include "gamelib/utils/nametag.hpp"
 #include "gamelib/utils/LifetimeTracker.hpp"
+#include "gamelib/utils/ObjectPool.hpp"
 #include "gamelib/properties/PropertyContainer.hpp"
 #include "gamelib/json/JsonSerializer.hpp"
 #include "ecsmeta.hpp"
@@ -18,6 +19,9 @@ namespace gamelib
     {
         friend class Entity;
 
+        public:
+            GAMELIB_POOL_ALLOCATED
+
         public:
             Component();
             Component(const Component&) = delete;   // Prevent shooting in the foot
@@ -51,6 +55,22 @@ namespace gamelib
             EntityReference _entptr; // Set by Entity
             bool _initialized;
     };
+
+
+    // Component types (i.e. nametags) are mapped to small integers, which
+    // Entity uses to find components without comparing strings.
+    // Indices are assigned on first use and are not persistent.
+    // Thread-safe.
+    auto getTypeIndex(const std::string& name)  -> TypeIndex;
+    auto findTypeIndex(const std::string& name) -> TypeIndex; // invalidTypeIndex if not registered
+
+    template <typename T>
+    auto getTypeIndex() -> TypeIndex
+    {
+        static_assert(has_nametag<T>(), "Only works for types with a nametag");
+        static const TypeIndex index = getTypeIndex(T::name());
+        return index;
+    }
 }
 
 #endif
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include "gamelib/utils/Identifier.hpp"
+#include "gamelib/utils/ObjectPool.hpp"
 #include "gamelib/core/geometry/GroupTransform.hpp"
 #include "ecsmeta.hpp"
 #include "json/json.h"
@@ -29,18 +30,26 @@
 
 namespace gamelib
 {
+    class ArchetypeStorage;
+
     class Entity : public LifetimeTracker<Entity>
     {
+        friend class ArchetypeStorage;
+
         private:
             struct ComponentData
             {
                 unsigned int id;
+                TypeIndex type;
                 ComponentPtr ptr;
             };
 
         public:
             typedef std::vector<ComponentData> ComponentList;
 
+        public:
+            GAMELIB_POOL_ALLOCATED
+
         public:
             Entity();
             Entity(const std::string& name);
@@ -65,6 +74,7 @@ namespace gamelib
             auto hasComponent(BaseCompRef comp) const -> bool;
             auto find(ID type) const                    -> BaseCompRef;
             auto find(const std::string& name) const    -> BaseCompRef;
+            auto find(const std::string& name, unsigned int id) const -> BaseCompRef; // see generateName()
             auto size() const                           -> size_t;
             auto clearComponents()                      -> void;
 
@@ -122,6 +132,18 @@ namespace gamelib
         private:
             auto _quit() -> void;
             auto _refresh(RefreshType type, Component* comp) -> void;
+            auto _updateArchetype(bool registerself) -> void;
+            auto _updateTypeSlots() -> void;
+
+            // Returns the position of the first component of the given
+            // type, or size() if there is none
+            auto _findFirst(TypeIndex type) const -> size_t;
+
+            // See ArchetypeStorage::findArena()
+            static auto _findArena(TypeIndex type) -> ObjectPool*;
+
+            template <typename F>
+            auto _findAll(TypeIndex type, F callback) const -> BaseCompRef;
 
         public:
             unsigned int flags;
@@ -133,6 +155,12 @@ namespace gamelib
             ComponentList _components;
             EntityReference _parent;
             std::vector<EntityPtr> _children;
+            std::vector<unsigned short> _typeslots; // type index -> position of the first component + 1, 0 if none
+
+            // Set by ArchetypeStorage
+            ArchetypeStorage* _storage;
+            size_t _archetype;
+            size_t _archetyperow;
     };
 }
 
@@ -143,7 +171,12 @@ namespace gamelib
     template <typename T, typename... Args>
     auto Entity::add(Args&&... args) -> ComponentReference<T>
     {
-        return add(ComponentPtr(new T(std::forward<Args>(args)...))).as<T>();
+        ComponentPtr comp;
+        {
+            ObjectPool::ScopedArena arena(_findArena(getTypeIndex<T>()));
+            comp.reset(new T(std::forward<Args>(args)...));
+        }
+        return add(std::move(comp)).as<T>();
     }
 
 
@@ -158,7 +191,8 @@ namespace gamelib
     auto Entity::findByName() const -> ComponentReference<T>
     {
         static_assert(has_nametag<T>(), "Only works for types with a nametag");
-        return find(T::name()).template as<T>();
+        const size_t i = _findFirst(getTypeIndex<T>());
+        return i < _components.size() ? static_cast<T*>(_components[i].ptr.get()) : nullptr;
     }
 
     template <typename T, typename F>
@@ -174,7 +208,7 @@ namespace gamelib
     auto Entity::findAllByName(F callback) const -> ComponentReference<T>
     {
         static_assert(has_nametag<T>(), "Only works for types with a nametag");
-        return findAll(T::name(), [&](BaseCompRef comp) {
+        return _findAll(getTypeIndex<T>(), [&](BaseCompRef comp) {
                 return callback(comp.as<T>());
             }).template as<T>();
     }
@@ -192,9 +226,18 @@ namespace gamelib
     template <typename F>
     auto Entity::findAll(const std::string& name, F callback) const -> BaseCompRef
     {
-        for (const auto& i : _components)
-            if (i.ptr->getName() == name && callback(i.ptr.get()))
-                return i.ptr.get();
+        return _findAll(findTypeIndex(name), callback);
+    }
+
+    template <typename F>
+    auto Entity::_findAll(TypeIndex type, F callback) const -> BaseCompRef
+    {
+        for (size_t i = _findFirst(type); i < _components.size(); ++i)
+        {
+            const auto& data = _components[i];
+            if (data.type == type && data.ptr && callback(data.ptr.get()))
+                return data.ptr.get();
+        }
         return nullptr;
     }
 
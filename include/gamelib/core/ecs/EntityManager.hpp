@@ -1,8 +1,10 @@
 #ifndef GAMELIB_ENTITYMANAGER_HPP
 #define GAMELIB_ENTITYMANAGER_HPP
 
+#include <memory>
 #include "gamelib/core/ecs/Entity.hpp"
 #include "gamelib/core/Subsystem.hpp"
+#include "gamelib/utils/ObjectPool.hpp"
 
 namespace gamelib
 {
@@ -24,6 +26,13 @@ namespace gamelib
             auto find(const std::string& name) const      -> EntityReference;
             auto clear()                                  -> void;
 
+            // While enabled, all entities and components are allocated
+            // from a level arena, which is released at once by clear().
+            // Objects still alive afterwards, e.g. popped entities, keep
+            // the arena from being released until they are destroyed.
+            auto setLevelArena(bool enable) -> void;
+            auto getLevelArena() const      -> const ObjectPool*;
+
             // Iterate over the hierachy.
             // Returns the entity breaked at, otherwise null.
             // Return true to break loop, otherwise false.
@@ -35,6 +44,7 @@ namespace gamelib
             }
 
         private:
+            std::unique_ptr<ObjectPool> _arena; // must outlive _root
             Entity _root;
     };
 }
@@ -21,6 +21,10 @@ namespace gamelib
     template <typename T = Component>
     using CompRef = ComponentReference<T>;
 
+    // Dense index of a component type, see getTypeIndex()
+    typedef unsigned int TypeIndex;
+    constexpr TypeIndex invalidTypeIndex = -1;
+
     enum RefreshType
     {
         ComponentAdded,     // A component was added to the entity
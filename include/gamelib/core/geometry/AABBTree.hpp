@@ -0,0 +1,74 @@
+#ifndef GAMELIB_AABBTREE_HPP
+#define GAMELIB_AABBTREE_HPP
+
+#include "Broadphase.hpp"
+
+/*
+ * Dynamic bounding volume hierarchy, similar to the one used in Box2D.
+ *
+ * Leaves store enlarged ("fat") bounding boxes, so that small movements
+ * don't require the tree to be restructured. update() only reinserts a
+ * proxy if its new bounding box leaves the fat box.
+ * The tree is kept balanced using rotations on insertion and removal.
+ *
+ * sweep() visits nodes in the order they are touched by the moving box and
+ * stops as soon as the next node lies behind the nearest hit, so its cost
+ * depends on the length of the sweep rather than on the size of the tree.
+ */
+
+namespace gamelib
+{
+    class AABBTree : public Broadphase
+    {
+        public:
+            AABBTree(float margin = 4);
+            virtual ~AABBTree() {};
+
+            auto add(Collidable* col, const math::AABBf& bbox) -> int final override;
+            auto remove(int proxy)                             -> void final override;
+            auto update(int proxy, const math::AABBf& bbox)    -> void final override;
+            auto clear()                                       -> void final override;
+            auto size() const                                  -> size_t final override;
+            auto create() const                                -> std::unique_ptr<Broadphase> final override;
+
+            auto query(const math::AABBf& rect, std::vector<Collidable*>* result) const -> void final override;
+            auto sweep(const math::AABBf& rect, const math::Vec2f& vel,
+                    SweepCallback callback, void* me) const -> void final override;
+
+            auto getFatBBox(int proxy) const -> const math::AABBf&;
+            auto getHeight() const           -> int;
+
+        private:
+            struct Node
+            {
+                math::AABBf bbox;
+                Collidable* obj;
+                int parent;     // next free node if unused
+                int left;
+                int right;
+                int height;     // -1 if unused, 0 for leaves
+
+                inline bool isLeaf() const
+                {
+                    return left == broadphase_nullproxy;
+                }
+            };
+
+        private:
+            auto _allocate()             -> int;
+            auto _free(int node)         -> void;
+            auto _insertLeaf(int leaf)   -> void;
+            auto _removeLeaf(int leaf)   -> void;
+            auto _balance(int node)      -> int;
+            auto _refitParents(int node) -> void;
+
+        private:
+            std::vector<Node> _nodes;
+            int _root;
+            int _freelist;
+            size_t _size;
+            float _margin;
+    };
+}
+
+#endif
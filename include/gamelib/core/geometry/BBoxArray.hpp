@@ -0,0 +1,83 @@
+#ifndef GAMELIB_BBOXARRAY_HPP
+#define GAMELIB_BBOXARRAY_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "math/geometry/AABB.hpp"
+#include "math/geometry/Vector.hpp"
+
+/*
+ * Bounding boxes stored as structure of arrays (min x, min y, max x, max y),
+ * and kernels that test many boxes at once.
+ *
+ * The kernels process 8 (AVX) or 4 (SSE) boxes at a time, depending on the
+ * instruction sets enabled at compile time, and fall back to plain loops
+ * otherwise. The scalar versions are always available and produce
+ * bit-identical results.
+ *
+ * Overlap tests have the same semantics as overlaps(), sweep tests the same
+ * as sweepTime() (see Broadphase.hpp), except that boxes are given as
+ * min/max instead of position/size.
+ */
+
+namespace gamelib
+{
+    // Returned by the sweep kernels for boxes that are not hit
+    constexpr float bbox_nohit = std::numeric_limits<float>::infinity();
+
+    // Pointers to num boxes in structure of arrays layout
+    struct BBoxRef
+    {
+        const float* minx;
+        const float* miny;
+        const float* maxx;
+        const float* maxy;
+        size_t size;
+    };
+
+    // Sets result[i] to 1 if box i overlaps or touches rect, otherwise 0.
+    void overlapBoxes(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result);
+    void overlapBoxesScalar(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result);
+
+    // Sets times[i] to the time (as fraction of vel) at which rect, moving
+    // along vel, starts touching box i, or to bbox_nohit if it doesn't
+    // touch it within [0, maxtime].
+    void sweepBoxes(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times);
+    void sweepBoxesScalar(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times);
+
+    // Returns the name of the instruction set used by the kernels
+    auto getBBoxKernelName() -> const char*;
+
+
+    class BBoxArray
+    {
+        public:
+            auto add(const math::AABBf& box)           -> void;
+            auto set(size_t index, const math::AABBf& box) -> void;
+            auto get(size_t index) const               -> math::AABBf;
+
+            // Moves the last box to the given index
+            auto swapRemove(size_t index) -> void;
+
+            auto clear()       -> void;
+            auto size() const  -> size_t;
+            auto ref() const   -> BBoxRef;
+
+        private:
+            std::vector<float> _minx;
+            std::vector<float> _miny;
+            std::vector<float> _maxx;
+            std::vector<float> _maxy;
+    };
+
+    // Packs the boxes in a single buffer: all min x values, then min y, ...
+    // Returns a reference to the packed boxes, which is valid as long as
+    // buffer is not modified.
+    auto packBoxes(const math::AABBf* boxes, size_t num, std::vector<float>* buffer) -> BBoxRef;
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef GAMELIB_BROADPHASE_HPP
+#define GAMELIB_BROADPHASE_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "math/geometry/AABB.hpp"
+#include "math/geometry/Vector.hpp"
+#include "gamelib/utils/ScratchBuffer.hpp"
+
+/*
+ * Interface for spatial acceleration structures used by CollisionSystem to
+ * reduce the number of objects that have to be tested precisely.
+ *
+ * Every object is represented by a proxy that stores a (possibly enlarged)
+ * bounding box. add() returns a proxy id that has to be passed to update()
+ * and remove() later. Proxy ids are only unique for a single broadphase.
+ *
+ * query() is conservative: it may return objects that don't actually
+ * intersect the given rect, but it never misses one. The order of the
+ * returned objects is unspecified.
+ *
+ * sweep() visits objects touched by a moving box. The callback returns the
+ * time (as fraction of vel) of the nearest hit found so far, which allows
+ * implementations to skip everything behind it. The broadphase must not be
+ * modified while sweeping.
+ */
+
+namespace gamelib
+{
+    class Collidable;
+
+    constexpr int broadphase_nullproxy = -1;
+
+    // Returns true if the two boxes overlap or touch.
+    inline bool overlaps(const math::AABBf& a, const math::AABBf& b)
+    {
+        return a.x <= b.x + b.w && b.x <= a.x + a.w
+            && a.y <= b.y + b.h && b.y <= a.y + a.h;
+    }
+
+    // Returns true if inner lies completely inside outer.
+    inline bool contains(const math::AABBf& outer, const math::AABBf& inner)
+    {
+        return outer.x <= inner.x && outer.y <= inner.y
+            && inner.x + inner.w <= outer.x + outer.w
+            && inner.y + inner.h <= outer.y + outer.h;
+    }
+
+    // Returns the smallest box containing both a and b.
+    inline math::AABBf merged(const math::AABBf& a, const math::AABBf& b)
+    {
+        const float minx = std::min(a.x, b.x),
+                    miny = std::min(a.y, b.y);
+        return math::AABBf(minx, miny,
+                std::max(a.x + a.w, b.x + b.w) - minx,
+                std::max(a.y + a.h, b.y + b.h) - miny);
+    }
+
+    inline float perimeter(const math::AABBf& box)
+    {
+        return 2 * (box.w + box.h);
+    }
+
+    // Returns the area covered by a box moving along vel.
+    inline math::AABBf sweptBBox(const math::AABBf& rect, const math::Vec2f& vel)
+    {
+        return merged(rect, math::AABBf(rect.x + vel.x, rect.y + vel.y, rect.w, rect.h));
+    }
+
+    // Computes the time (as fraction of vel) at which rect, moving along
+    // vel, starts touching box. Returns false if it doesn't touch box
+    // within [0, maxtime].
+    inline bool sweepTime(const math::AABBf& rect, const math::Vec2f& vel,
+            const math::AABBf& box, float maxtime, float* time)
+    {
+        // Ray vs. box extended by rect's size
+        const float lo[] = { box.x - rect.w - rect.x, box.y - rect.h - rect.y };
+        const float hi[] = { box.x + box.w - rect.x, box.y + box.h - rect.y };
+        float tmin = 0, tmax = maxtime;
+
+        for (int i = 0; i < 2; ++i)
+        {
+            if (vel[i] == 0)
+            {
+                if (lo[i] > 0 || hi[i] < 0)
+                    return false;
+            }
+            else
+            {
+                float t1 = lo[i] / vel[i],
+                      t2 = hi[i] / vel[i];
+                if (t1 > t2)
+                    std::swap(t1, t2);
+                tmin = std::max(tmin, t1);
+                tmax = std::min(tmax, t2);
+                if (tmin > tmax)
+                    return false;
+            }
+        }
+
+        *time = tmin;
+        return true;
+    }
+
+    // Signature: float(void* me, Collidable* obj)
+    typedef float (*SweepCallback)(void*, Collidable*);
+
+    class Broadphase
+    {
+        public:
+            virtual ~Broadphase() {};
+
+            virtual auto add(Collidable* col, const math::AABBf& bbox) -> int = 0;
+            virtual auto remove(int proxy)                             -> void = 0;
+            virtual auto update(int proxy, const math::AABBf& bbox)    -> void = 0;
+            virtual auto clear()                                       -> void = 0;
+            virtual auto size() const                                  -> size_t = 0;
+
+            // Returns a new, empty broadphase of the same type and configuration
+            virtual auto create() const -> std::unique_ptr<Broadphase> = 0;
+
+            // Appends all objects whose proxy overlaps the given rect to result.
+            virtual auto query(const math::AABBf& rect, std::vector<Collidable*>* result) const -> void = 0;
+
+            // Calls callback for every object whose proxy is touched by rect
+            // moving along vel. The default implementation visits all
+            // candidates in the swept area, in unspecified order.
+            virtual auto sweep(const math::AABBf& rect, const math::Vec2f& vel,
+                    SweepCallback callback, void* me) const -> void
+            {
+                ScratchBuffer<Collidable*> candidates;
+                query(sweptBBox(rect, vel), &candidates.get());
+                for (Collidable* i : *candidates)
+                    callback(me, i);
+            }
+    };
+}
+
+#endif
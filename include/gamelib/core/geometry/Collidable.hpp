@@ -11,18 +11,28 @@
  * Base class for objects that have a "body" and can collide with others.
  * A collidable object can be moved to a different position, has a
  * bounding box and can intersect at least with points and lines.
+ *
+ * When registered in a CollisionSystem, bounding box changes (signaled by
+ * _markDirty()) are automatically forwarded to the system's broadphase.
+ *
+ * Every object belongs to exactly one collision layer of its system,
+ * see CollisionSystem for details.
  */
 
 namespace gamelib
 {
+    class CollisionSystem;
+
     typedef math::Intersection<float> Intersection;
 
     class Collidable : public Transformable
     {
+        friend class CollisionSystem;
+
         public:
-            Collidable() : flags(0) {};
-            Collidable(unsigned int flags_) : flags(flags_) {};
-            virtual ~Collidable() {};
+            Collidable();
+            Collidable(unsigned int flags_);
+            virtual ~Collidable();
 
             virtual auto intersect(const math::Point2f& point) const -> bool = 0;
             virtual auto intersect(const math::Line2f& line) const   -> Intersection = 0;
@@ -30,8 +40,24 @@ namespace gamelib
 
             virtual auto sweep(const math::AABBf& rect, const math::Vec2f& vel) const -> Intersection = 0;
 
+            // Moves the object to the given layer of its CollisionSystem.
+            // Can be called before the object is registered.
+            auto setLayer(int layer) -> void;
+            auto getLayer() const    -> int;
+
+        protected:
+            virtual auto _markDirty() const -> void override;
+
         public:
             unsigned int flags;
+
+        private:
+            // Managed by CollisionSystem
+            CollisionSystem* _colsys;
+            size_t _colindex;   // Index in the system's object list
+            size_t _colorder;   // Insertion stamp, used to keep newer objects "on top"
+            int _proxy;         // Broadphase proxy
+            int _layer;         // Collision layer index
     };
 }
 
@@ -2,22 +2,83 @@
 #define GAMELIB_COLLISION_SYSTEM_HPP
 
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
 #include "math/geometry/intersect.hpp"
 #include "gamelib/core/Subsystem.hpp"
+#include "gamelib/json/JsonSerializer.hpp"
+#include "gamelib/utils/ScratchBuffer.hpp"
 #include "Collidable.hpp"
+#include "Broadphase.hpp"
+#include "BBoxArray.hpp"
 #include "flags.hpp"
 
-// TODO: Use quadtrees
-
 // The CollisionSystem class keeps track of Collidable-based objects.
 // It doesn't manage the objects' lifetime, it only takes pointers to
 // Collidables. Allocating and freeing objects is up to the user.
 // To register an object call add() and to unregister remove().
+//
+// Objects are stored in a Broadphase (by default an AABBTree) that is used
+// to find candidates for the precise collision tests. The broadphase is
+// updated automatically when an object's bounding box changes.
+// Candidates are always processed in reverse insertion order, so newer
+// objects are "on top", regardless of the broadphase used.
+//
+// Bounding boxes of all objects are cached in a BBoxArray, so candidates
+// can be filtered in bulk using SIMD kernels before the precise tests.
+//
+// Objects are sorted into named collision layers, each with its own
+// broadphase. Queries take a bitmask of layers to search (bit i = layer i)
+// and skip all other layers entirely. Every layer also has a mask of layers
+// it collides with. If a query is done on behalf of an object (self), only
+// layers in the mask of that object's layer are searched.
+// Layer 0 ("default") always exists. Layers can't be removed, so indices
+// stay valid, but destroy() resets the system to the default layer.
 
 namespace gamelib
 {
     class Collidable;
 
+    namespace detail
+    {
+        inline math::AABBf queryBBox(const math::Point2f& point)
+        {
+            return math::AABBf(point.x, point.y, 0, 0);
+        }
+
+        inline const math::AABBf& queryBBox(const math::AABBf& rect)
+        {
+            return rect;
+        }
+
+        // Candidates are prefiltered with slightly enlarged boxes, so that
+        // precision differences to the precise tests can't drop touching
+        // objects.
+        inline math::AABBf prefilterBBox(const math::AABBf& rect)
+        {
+            constexpr float margin = 0.01;
+            return math::AABBf(rect.x - margin, rect.y - margin, rect.w + 2 * margin, rect.h + 2 * margin);
+        }
+
+        template <typename F>
+        float invokeSweepCallback(void* me, Collidable* obj)
+        {
+            return (*static_cast<F*>(me))(obj);
+        }
+    }
+
+    constexpr int collision_maxlayers = 32;
+    constexpr int collision_nolayer = -1;
+    constexpr unsigned int collision_alllayers = ~0u;
+    constexpr const char* collision_defaultlayer = "default";
+
+    enum TraceMode
+    {
+        TraceAll,       // Test every object in the area covered by the trace
+        TraceNearest    // Walk along the trace and stop when the nearest hit is found
+    };
+
     class TraceResult
     {
         public:
@@ -30,68 +91,215 @@ namespace gamelib
             Intersection isec;
     };
 
-    class CollisionSystem : public Subsystem<CollisionSystem>
+    struct TraceQuery
     {
+        math::AABBf rect;
+        math::Vec2f vel;
+        const Collidable* self;
+        unsigned int flags;
+        unsigned int layers = collision_alllayers;
+    };
+
+    struct IntersectQuery
+    {
+        math::AABBf rect;
+        const Collidable* self;
+        unsigned int flags;
+        unsigned int layers = collision_alllayers;
+    };
+
+    class CollisionSystem : public Subsystem<CollisionSystem>,
+                            public JsonSerializer
+    {
+        friend class Collidable;
+
         public:
             ASSIGN_NAMETAG("CollisionSystem");
 
         public:
+            CollisionSystem();
+            CollisionSystem(std::unique_ptr<Broadphase> broadphase);
+            virtual ~CollisionSystem();
+
             auto add(Collidable* col)    -> void;
             auto remove(Collidable* col) -> void;
             auto destroy()               -> void;
             auto size() const            -> size_t;
 
+            // Replaces the broadphase of each layer with a new one of the
+            // given type and reinserts all objects
+            auto setBroadphase(std::unique_ptr<Broadphase> broadphase) -> void;
+            auto getBroadphase(int layer = 0) const -> const Broadphase&;
+
+            // Returns the existing layer if there is one with the same name.
+            // Returns collision_nolayer if the maximum amount of layers is
+            // reached. New layers collide with all layers.
+            auto createLayer(const std::string& name)            -> int;
+            auto findLayer(const std::string& name) const        -> int;
+            auto getLayerName(int layer) const                   -> const std::string&;
+            auto getNumLayers() const                            -> size_t;
+            auto setLayerMask(int layer, unsigned int mask)      -> void;
+            auto getLayerMask(int layer) const                   -> unsigned int;
+
+            auto loadFromJson(const Json::Value& node) -> bool final override;
+            auto writeToJson(Json::Value& node) const  -> void final override;
+
+            // While deferred, broadphase updates of moving objects are queued
+            // and applied in insertion order by endDeferredRefit().
+            // This allows moving objects from multiple threads while querying.
+            // Objects can't be added or removed in the meantime.
+            // Objects moving outside their proxies aren't found by queries
+            // until refits are applied, so the area they might move in should
+            // be reserved first.
+            auto beginDeferredRefit() -> void;
+            auto endDeferredRefit()   -> void;
+
+            // Enlarges the object's broadphase proxy to cover the given area.
+            // Does nothing if the object is not registered.
+            auto reserve(const Collidable* col, const math::AABBf& area) -> void;
+
+            // Returns the nearest object hit by the given line or box moving
+            // along vel.
             auto trace(const math::Line2f& line,
-                    const Collidable* self = nullptr, unsigned int flags = 0) const -> TraceResult;
+                    const Collidable* self = nullptr, unsigned int flags = 0,
+                    unsigned int layers = collision_alllayers) const -> TraceResult;
 
             auto trace(const math::AABBf& rect, const math::Vec2f& vel,
-                    const Collidable* self = nullptr, unsigned int flags = 0) const -> TraceResult;
+                    const Collidable* self = nullptr, unsigned int flags = 0,
+                    unsigned int layers = collision_alllayers) const -> TraceResult;
 
             // Same as normal trace but calls a filter function for each found object.
             // Signature: bool(Collidable*, const Intersection&)
             // If the function returns false, the object will be skipped
+            //
+            // In TraceAll mode, the callback is called for every hit object.
+            // In TraceNearest mode, the broadphase is walked along the trace
+            // and objects that can't be reached before the nearest hit found
+            // so far are skipped. Cost then depends on the trace length rather
+            // than on the amount of objects, but the callback is not
+            // guaranteed to see hits behind the nearest one. The callback
+            // must not move or resize objects in this mode.
+            // Unbounded lines (rays, infinite lines) always use TraceAll.
             template <typename F>
             auto trace(const math::Line2f& line, F callback,
-                    const Collidable* self = nullptr, unsigned int flags = 0) const -> TraceResult;
+                    const Collidable* self = nullptr, unsigned int flags = 0,
+                    TraceMode mode = TraceAll, unsigned int layers = collision_alllayers) const -> TraceResult;
 
             template <typename F>
             auto trace(const math::AABBf& rect, const math::Vec2f& vel, F callback,
-                    const Collidable* self = nullptr, unsigned int flags = 0) const -> TraceResult;
+                    const Collidable* self = nullptr, unsigned int flags = 0,
+                    TraceMode mode = TraceAll, unsigned int layers = collision_alllayers) const -> TraceResult;
 
             // Returns the colliding object if there is a collison at the
             // given point/rect, otherwise nullptr.
-            auto intersect(const math::Point2f& point, const Collidable* self = nullptr, unsigned int flags = 0) const -> Collidable*;
-            auto intersect(const math::AABBf& rect, const Collidable* self = nullptr, unsigned int flags = 0) const    -> Collidable*;
+            auto intersect(const math::Point2f& point, const Collidable* self = nullptr, unsigned int flags = 0,
+                    unsigned int layers = collision_alllayers) const -> Collidable*;
+            auto intersect(const math::AABBf& rect, const Collidable* self = nullptr, unsigned int flags = 0,
+                    unsigned int layers = collision_alllayers) const -> Collidable*;
 
             // Calls a function for each colliding object at the given point/rect.
             // Signature: bool(Collidable*)
             // If the function returns true, the loop will break and return that object.
             template <typename F>
-            auto intersectAll(const math::Point2f& point, const Collidable* self, unsigned int flags, F f) const -> Collidable*;
+            auto intersectAll(const math::Point2f& point, const Collidable* self, unsigned int flags, F f,
+                    unsigned int layers = collision_alllayers) const -> Collidable*;
+
+            template <typename F>
+            auto intersectAll(const math::AABBf& rect, const Collidable* self, unsigned int flags, F f,
+                    unsigned int layers = collision_alllayers) const -> Collidable*;
 
+            // Same as intersectAll(), but calls the function for each object
+            // whose broadphase proxy overlaps the given rect, without testing
+            // bounding boxes or shapes. Proxies can be larger than their
+            // objects, e.g. after reserve(). These are all objects a query
+            // inside the rect might look at.
             template <typename F>
-            auto intersectAll(const math::AABBf& rect, const Collidable* self, unsigned int flags, F f) const -> Collidable*;
+            auto queryProxies(const math::AABBf& rect, F f,
+                    unsigned int layers = collision_alllayers) const -> Collidable*;
+
+            // Performs num queries at once and writes the results to the
+            // given array, which must have space for num elements.
+            // Results are the same as calling trace()/intersect() for each
+            // query, but nearby queries share their broadphase lookups and
+            // candidate bounding boxes. Useful when many independent queries
+            // are known in advance.
+            auto traceBatch(const TraceQuery* queries, size_t num, TraceResult* results) const         -> void;
+            auto intersectBatch(const IntersectQuery* queries, size_t num, Collidable** results) const -> void;
+
+        private:
+            struct Layer
+            {
+                std::string name;
+                unsigned int mask;
+                std::unique_ptr<Broadphase> broadphase;
+            };
 
         private:
+            // Sorts the given query areas spatially and calls
+            // callback(index, candidates, boxes) for each query, where
+            // candidates are shared with nearby queries and boxes contains
+            // the bounding box of each candidate. Candidates can be in any
+            // of the layers of the queries they are shared with.
+            template <typename F>
+            auto _batch(const math::AABBf* areas, const unsigned int* layers, size_t num, F callback) const -> void;
+
+            // Packs the cached bounding boxes of the given objects into buffer
+            auto _gather(const std::vector<Collidable*>& candidates, std::vector<float>* buffer) const -> BBoxRef;
+
             template <typename Shape, typename F>
-            auto _intersectAll(const Shape& shape, F f, const Collidable* self, unsigned int flags) const -> Collidable*;
+            auto _intersectAll(const Shape& shape, F f, const Collidable* self, unsigned int flags,
+                    unsigned int layers) const -> Collidable*;
+
+            // Returns the layers a query on behalf of self has to search
+            auto _queryLayers(const Collidable* self, unsigned int layers) const -> unsigned int;
+
+            // Collects all candidates in the given area and layers, newest first
+            auto _query(const math::AABBf& rect, unsigned int layers, std::vector<Collidable*>* result) const -> void;
+            auto _query(const math::Line2f& line, unsigned int layers, std::vector<Collidable*>* result) const -> void;
+
+            // Sweeps the broadphases of the given layers one after another
+            auto _sweep(const math::AABBf& rect, const math::Vec2f& vel, unsigned int layers,
+                    SweepCallback callback, void* me) const -> void;
+
+            // Called by Collidable when its bounding box or layer changed
+            auto _refit(const Collidable* col)         -> void;
+            auto _setLayer(Collidable* col, int layer) -> void;
+
+            // Returns true if isec is nearer than the current nearest hit.
+            // Equally near objects are ordered by insertion, newest first.
+            static auto _isNearer(const Intersection& isec, const Collidable* obj, const TraceResult& nearest) -> bool;
 
         private:
             std::vector<Collidable*> _objs;
+            BBoxArray _bboxes;      // same order as _objs
+            std::vector<const Collidable*> _deferred;
+            std::vector<Layer> _layers;
+            std::mutex _deferlock;
+            size_t _counter;
+            bool _defer;
     };
 
     template <typename Shape, typename F>
-    Collidable* CollisionSystem::_intersectAll(const Shape& shape, F f, const Collidable* self, unsigned int flags) const
+    Collidable* CollisionSystem::_intersectAll(const Shape& shape, F f, const Collidable* self, unsigned int flags,
+            unsigned int layers) const
     {
-        // Use rbegin so that newly added object are "on top"
-        for (auto it = _objs.rbegin(), end = _objs.rend(); it != end; ++it)
+        ScratchBuffer<Collidable*> candidates;
+        ScratchBuffer<float> boxbuffer;
+        ScratchBuffer<uint8_t> mask;
+
+        _query(detail::queryBBox(shape), _queryLayers(self, layers), &candidates.get());
+        const BBoxRef boxes = _gather(*candidates, &boxbuffer.get());
+        mask->resize(boxes.size);
+        overlapBoxes(boxes, detail::prefilterBBox(detail::queryBBox(shape)), mask->data());
+
+        for (size_t i = 0; i < candidates->size(); ++i)
         {
-            Collidable* c = (*it);
-            if (c != self && (!flags || c->flags & flags))
+            Collidable* c = (*candidates)[i];
+            if ((*mask)[i] && c != self && (!flags || c->flags & flags))
             {
                 if (c->flags & collision_noprecise)
                 {
-                    if (!math::intersect(c->getBBox(), shape))
+                    if (!math::intersect(_bboxes.get(c->_colindex), shape))
                         continue;
                 }
                 else
@@ -108,29 +316,50 @@ namespace gamelib
     }
 
     template <typename F>
-    Collidable* CollisionSystem::intersectAll(const math::Point2f& point, const Collidable* self, unsigned int flags, F f) const
+    Collidable* CollisionSystem::intersectAll(const math::Point2f& point, const Collidable* self, unsigned int flags, F f,
+            unsigned int layers) const
     {
-        return _intersectAll(point, f, self, flags);
+        return _intersectAll(point, f, self, flags, layers);
     }
 
     template <typename F>
-    Collidable* CollisionSystem::intersectAll(const math::AABBf& rect, const Collidable* self, unsigned int flags, F f) const
+    Collidable* CollisionSystem::intersectAll(const math::AABBf& rect, const Collidable* self, unsigned int flags, F f,
+            unsigned int layers) const
+    {
+        return _intersectAll(rect, f, self, flags, layers);
+    }
+
+    template <typename F>
+    Collidable* CollisionSystem::queryProxies(const math::AABBf& rect, F f, unsigned int layers) const
+    {
+        ScratchBuffer<Collidable*> candidates;
+        _query(rect, layers, &candidates.get());
+
+        for (Collidable* c : *candidates)
+            if (f(c))
+                return c;
+        return nullptr;
+    }
+
+    inline bool CollisionSystem::_isNearer(const Intersection& isec, const Collidable* obj, const TraceResult& nearest)
     {
-        return _intersectAll(rect, f, self, flags);
+        return !nearest || isec.near < nearest.isec.near
+            || (isec.near == nearest.isec.near && obj->_colorder > nearest.obj->_colorder);
     }
 
     template <typename F>
-    TraceResult CollisionSystem::trace(const math::Line2f& line, F callback, const Collidable* self, unsigned int flags) const
+    TraceResult CollisionSystem::trace(const math::Line2f& line, F callback, const Collidable* self,
+            unsigned int flags, TraceMode mode, unsigned int layers) const
     {
         TraceResult nearest;
-        for (auto it = _objs.rbegin(), end = _objs.rend(); it != end; ++it)
-        {
-            Collidable* i = (*it);
+        layers = _queryLayers(self, layers);
+
+        auto test = [&](Collidable* i) {
             if (i != self && (!flags || i->flags & flags))
             {
                 Intersection isec;
                 if (i->flags & collision_noprecise)
-                    isec = math::intersect(line, i->getBBox());
+                    isec = math::intersect(line, _bboxes.get(i->_colindex));
                 else
                 {
                     isec = i->intersect(line);
@@ -138,39 +367,91 @@ namespace gamelib
                         std::swap(isec.near, isec.far);
                 }
 
-                if (isec && callback(i, isec) && (!nearest || isec.near < nearest.isec.near))
+                if (isec && callback(i, isec) && _isNearer(isec, i, nearest))
                 {
                     nearest.obj = i;
                     nearest.isec = isec;
                 }
             }
+
+            // Objects overlapping the start point must always be checked
+            return nearest ? std::max(nearest.isec.near, 0.f) : 1.f;
+        };
+
+        const math::AABBf start(line.p.x, line.p.y, 0, 0);
+
+        if (mode == TraceNearest && line.type == math::Segment)
+            _sweep(start, line.d, layers, detail::invokeSweepCallback<decltype(test)>, &test);
+        else if (line.type == math::Segment)
+        {
+            ScratchBuffer<Collidable*> candidates;
+            ScratchBuffer<float> boxbuffer, times;
+
+            _query(line, layers, &candidates.get());
+            const BBoxRef boxes = _gather(*candidates, &boxbuffer.get());
+            times->resize(boxes.size);
+            sweepBoxes(boxes, detail::prefilterBBox(start), line.d, 1, times->data());
+
+            for (size_t i = 0; i < candidates->size(); ++i)
+                if ((*times)[i] != bbox_nohit)
+                    test((*candidates)[i]);
+        }
+        else
+        {
+            // Unbounded lines can't be prefiltered
+            ScratchBuffer<Collidable*> candidates;
+            _query(line, layers, &candidates.get());
+            for (Collidable* i : *candidates)
+                test(i);
         }
+
         return nearest;
     }
 
     template <typename F>
     TraceResult CollisionSystem::trace(const math::AABBf& rect, const math::Vec2f& vel, F callback,
-            const Collidable* self, unsigned int flags) const
+            const Collidable* self, unsigned int flags, TraceMode mode, unsigned int layers) const
     {
         TraceResult nearest;
-        for (auto it = _objs.rbegin(), end = _objs.rend(); it != end; ++it)
-        {
-            Collidable* i = (*it);
+        layers = _queryLayers(self, layers);
+
+        auto test = [&](Collidable* i) {
             if (i != self && (!flags || i->flags & flags))
             {
                 Intersection isec;
                 if (i->flags & collision_noprecise)
-                    isec = math::sweep(rect, vel, i->getBBox());
+                    isec = math::sweep(rect, vel, _bboxes.get(i->_colindex));
                 else
                     isec = i->sweep(rect, vel);
 
-                if (isec && callback(i, isec) && (!nearest || isec.near < nearest.isec.near))
+                if (isec && callback(i, isec) && _isNearer(isec, i, nearest))
                 {
                     nearest.obj = i;
                     nearest.isec = isec;
                 }
             }
+
+            // Objects overlapping the start position must always be checked
+            return nearest ? std::max(nearest.isec.near, 0.f) : 1.f;
+        };
+
+        if (mode == TraceNearest)
+            _sweep(rect, vel, layers, detail::invokeSweepCallback<decltype(test)>, &test);
+        else
+        {
+            ScratchBuffer<Collidable*> candidates;
+            ScratchBuffer<float> boxbuffer, times;
+
+            _query(sweptBBox(rect, vel), layers, &candidates.get());
+            const BBoxRef boxes = _gather(*candidates, &boxbuffer.get());
+            times->resize(boxes.size);
+            sweepBoxes(boxes, detail::prefilterBBox(rect), vel, 1, times->data());
+
+            for (size_t i = 0; i < candidates->size(); ++i)
+                if ((*times)[i] != bbox_nohit)
+                    test((*candidates)[i]);
         }
+
         return nearest;
     }
 }
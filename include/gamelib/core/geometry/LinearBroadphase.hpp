@@ -0,0 +1,41 @@
+#ifndef GAMELIB_LINEAR_BROADPHASE_HPP
+#define GAMELIB_LINEAR_BROADPHASE_HPP
+
+#include "Broadphase.hpp"
+
+/*
+ * Trivial broadphase that tests every object's bounding box.
+ * Useful as reference implementation and for very small scenes.
+ */
+
+namespace gamelib
+{
+    class LinearBroadphase : public Broadphase
+    {
+        public:
+            LinearBroadphase();
+            virtual ~LinearBroadphase() {};
+
+            auto add(Collidable* col, const math::AABBf& bbox) -> int final override;
+            auto remove(int proxy)                             -> void final override;
+            auto update(int proxy, const math::AABBf& bbox)    -> void final override;
+            auto clear()                                       -> void final override;
+            auto size() const                                  -> size_t final override;
+            auto create() const                                -> std::unique_ptr<Broadphase> final override;
+
+            auto query(const math::AABBf& rect, std::vector<Collidable*>* result) const -> void final override;
+
+        private:
+            struct Proxy
+            {
+                math::AABBf bbox;
+                Collidable* obj;    // nullptr if unused
+            };
+
+        private:
+            std::vector<Proxy> _proxies;
+            std::vector<int> _free;
+    };
+}
+
+#endif
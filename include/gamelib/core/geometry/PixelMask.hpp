@@ -0,0 +1,94 @@
+#ifndef GAMELIB_PIXELMASK_HPP
+#define GAMELIB_PIXELMASK_HPP
+
+#include <vector>
+#include <cstdint>
+#include "math/geometry/Vector.hpp"
+
+/*
+ * Precomputed collision data of a pixel image.
+ *
+ * Solid pixels are stored as a packed 1-bit mask (64 pixels per word, one
+ * padded row after another), so rect tests only need a few AND operations
+ * per row. Each row additionally stores the span [begin, end) containing
+ * all its solid pixels to skip empty parts quickly.
+ *
+ * The signed distance field stores for each pixel the euclidean distance
+ * between its center and the center of the nearest pixel of the opposite
+ * state: positive outside solid areas, negative inside. Everything outside
+ * the image counts as empty.
+ *
+ * Coordinates are in pixels relative to the top left corner.
+ */
+
+namespace gamelib
+{
+    class PixelMask
+    {
+        public:
+            PixelMask();
+
+            // Builds the mask from a predicate: bool(int x, int y)
+            template <typename F>
+            auto create(int w, int h, F solid) -> void;
+
+            auto clear() -> void;
+
+            auto getWidth() const  -> int;
+            auto getHeight() const -> int;
+
+            // Returns true if the pixel is solid. Pixels outside are empty.
+            auto test(int x, int y) const -> bool;
+
+            // Returns true if any pixel in [x0, x1) x [y0, y1) is solid.
+            auto testRect(int x0, int y0, int x1, int y1) const -> bool;
+
+            // Same as testRect, but also returns the first solid pixel,
+            // scanning rows bottom to top and pixels left to right.
+            auto findRect(int x0, int y0, int x1, int y1, math::Vec2i* pixel) const -> bool;
+
+            // Returns the signed distance of the given pixel. For pixels
+            // outside the image a lower bound is returned.
+            auto getDistance(int x, int y) const -> float;
+
+            // Returns the normalized distance field gradient at the given
+            // position, i.e. the direction pointing away from solid pixels.
+            auto getNormal(float x, float y) const -> math::Vec2f;
+
+        private:
+            struct Span
+            {
+                int begin;
+                int end;    // begin == end if the row is empty
+            };
+
+        private:
+            // Computes spans and the distance field from the bitmask
+            auto _build() -> void;
+
+        private:
+            std::vector<uint64_t> _bits;
+            std::vector<Span> _spans;
+            std::vector<float> _sdf;
+            int _w, _h;
+            int _stride;    // words per row
+    };
+
+    template <typename F>
+    void PixelMask::create(int w, int h, F solid)
+    {
+        _w = w;
+        _h = h;
+        _stride = (w + 63) / 64;
+        _bits.assign(_stride * h, 0);
+
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                if (solid(x, y))
+                    _bits[y * _stride + x / 64] |= uint64_t(1) << (x % 64);
+
+        _build();
+    }
+}
+
+#endif
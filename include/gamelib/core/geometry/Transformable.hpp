@@ -5,6 +5,7 @@
 #include "math/geometry/Vector.hpp"
 #include "math/geometry/AABB.hpp"
 #include <SFML/Graphics/Transform.hpp>
+#include <vector>
 
 namespace gamelib
 {
@@ -95,11 +96,24 @@ namespace gamelib
             auto operator-=(const TransformData& rhs) -> Transformable&;
             auto operator+=(const TransformData& rhs) -> Transformable&;
 
+            // Dependents are objects whose bounding box is derived from this
+            // object's bounding box (e.g. AABBMask). Their _markDirty() is
+            // called whenever this object's bounding box changes and their
+            // _onSourceDestroyed() when this object is destroyed.
+            auto addDependent(Transformable* dep) const    -> void;
+            auto removeDependent(Transformable* dep) const -> void;
+
         protected:
             virtual auto _onChanged(UNUSED const sf::Transform& old) -> void {};
 
-            // Tell parent to update its bounding box
-            auto _markDirty() const -> void;
+            // Called when an object this object depends on is destroyed.
+            // The dependency is already removed at that point.
+            virtual auto _onSourceDestroyed(UNUSED const Transformable* src) -> void {};
+
+            // Tell parent to update its bounding box.
+            // Can be overridden to react to bounding box changes, but
+            // must call the base implementation.
+            virtual auto _markDirty() const -> void;
             auto _setSupportedOps(bool movable, bool scalable, bool rotatable) -> void;
 
         private:
@@ -121,6 +135,7 @@ namespace gamelib
                 _GlobalData() : scale(1, 1), angle(0) {}
             } _global;
             sf::Transform _matrix;
+            mutable std::vector<Transformable*> _dependents;
     };
 }
 
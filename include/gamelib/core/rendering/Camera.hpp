@@ -31,6 +31,7 @@ namespace gamelib
 
             auto getView() const                               -> sf::View;
             auto getView(const sf::RenderTarget& target) const -> sf::View;
+            auto getView(const sf::Vector2u& targetsize) const -> sf::View;
 
             // Shortcut for target.setView(getView(target))
             auto apply(sf::RenderTarget& target) const -> void;
@@ -7,10 +7,12 @@
 #include <vector>
 #include "gamelib/core/Subsystem.hpp"
 #include "Camera.hpp"
+#include "RenderStructs.hpp"
 
 namespace gamelib
 {
     class RenderSystem;
+    class RenderBackend;
 
     class CameraSystem : public Subsystem<CameraSystem>
     {
@@ -38,12 +40,17 @@ namespace gamelib
 
             auto render(sf::RenderTarget& target) const                                -> size_t;
             auto render(const RenderSystem* rendersys, sf::RenderTarget& target) const -> size_t;
+            auto render(RenderBackend& backend) const                                  -> size_t;
+            auto render(const RenderSystem* rendersys, RenderBackend& backend) const   -> size_t;
             auto getNumRendered() const                                                -> size_t;
 
         private:
             mutable size_t _numrendered;
             mutable const Camera* _currentcam;
             std::vector<Camera*> _cams;
+            mutable std::vector<const Camera*> _active;
+            mutable std::vector<math::AABBf> _rects;
+            mutable std::vector<RenderList> _lists;    // one per active camera, keeps its visible set between frames
     };
 }
 
@@ -0,0 +1,45 @@
+#ifndef GAMELIB_RENDERBACKEND_HPP
+#define GAMELIB_RENDERBACKEND_HPP
+
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/View.hpp>
+#include "RenderStructs.hpp"
+
+namespace gamelib
+{
+    // Receives the draw calls of RenderSystem and CameraSystem.
+    // Views and batches use SFML's conventions: batch vertices are in world
+    // space, the view maps world space to the viewport of the target.
+    class RenderBackend
+    {
+        public:
+            virtual ~RenderBackend() {};
+
+            virtual auto getSize() const -> sf::Vector2u = 0;
+            virtual auto getView() const -> sf::View = 0;
+            virtual auto setView(const sf::View& view) -> void = 0;
+            virtual auto draw(const RenderBatch& batch) -> void = 0;
+
+            // If false, baked static geometry is not uploaded to vertex
+            // buffers, see RenderSystem::prepareRender().
+            virtual auto supportsVertexBuffers() const -> bool = 0;
+    };
+
+    // Draws to an SFML render target
+    class SFMLRenderBackend : public RenderBackend
+    {
+        public:
+            explicit SFMLRenderBackend(sf::RenderTarget& target);
+
+            auto getSize() const -> sf::Vector2u final override;
+            auto getView() const -> sf::View final override;
+            auto setView(const sf::View& view) -> void final override;
+            auto draw(const RenderBatch& batch) -> void final override;
+            auto supportsVertexBuffers() const -> bool final override;
+
+        private:
+            sf::RenderTarget& _target;
+    };
+}
+
+#endif
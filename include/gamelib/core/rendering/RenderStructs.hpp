@@ -1,8 +1,12 @@
 #ifndef GAMELIB_RENDERSTRUCTS_HPP
 #define GAMELIB_RENDERSTRUCTS_HPP
 
+#include <cstdint>
+#include <vector>
 #include <SFML/Graphics/RenderStates.hpp>
 #include <SFML/Graphics/PrimitiveType.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
 #include "gamelib/utils/BatchAllocator.hpp"
 #include "gamelib/utils/SlotMap.hpp"
 #include "gamelib/core/res/TextureResource.hpp"
@@ -11,8 +15,9 @@
 namespace gamelib
 {
     class Component;
+    class RenderSystem;
 
-    typedef SlotKeyShort NodeHandle;
+    typedef HandleKey NodeHandle;
     typedef SlotKeyShort LayerHandle;
 
     // Don't include sf::Transform here because it is updated and cached separately
@@ -26,6 +31,8 @@ namespace gamelib
 
             auto isVisible() const -> bool;
 
+            static auto isVisible(unsigned int flags) -> bool;
+
         public:
             unsigned int flags;
             float parallax;
@@ -56,6 +63,72 @@ namespace gamelib
         Mesh();
     };
 
+    // Range [begin, end) of vertices in RenderSystem's vertex allocator
+    struct VertexRange
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    // A single draw call generated by RenderSystem.
+    // Batches of multiple nodes contain their vertices with the node
+    // transforms already applied and are converted to sf::Points, sf::Lines
+    // or sf::Triangles.
+    // Baked static geometry is drawn from buffer instead of vertices once it
+    // was uploaded.
+    struct RenderBatch
+    {
+        const sf::Vertex* vertices;
+        const sf::VertexBuffer* buffer;
+        size_t size;
+        sf::PrimitiveType primitiveType;
+        sf::RenderStates states;
+        size_t numnodes;
+
+        RenderBatch();
+    };
+
+    // Draw calls for one view, built by RenderSystem::buildRenderList() and
+    // drawn by RenderSystem::draw().
+    // Building doesn't need a render target, so lists can be built on
+    // worker threads and drawn by the thread owning the target afterwards.
+    // A list remembers which nodes were visible. Rebuilding it for the same
+    // or a slightly moved view reuses that set, so keep one list per view.
+    class RenderList
+    {
+        friend class RenderSystem;
+
+        public:
+            RenderList();
+
+            auto clear() -> void;   // Also drops the cached visible set
+
+        public:
+            std::vector<RenderBatch> batches;
+            std::vector<math::AABBf> debugboxes;    // parallax bboxes if RenderSystem::renderBoxes is set
+            size_t numrendered;
+
+        private:
+            std::vector<sf::Vertex> _vertices;      // vertices of merged batches
+            std::vector<size_t> _offsets;           // per batch offset into _vertices, npos if not merged
+            std::vector<size_t> _indices;           // visited queue indices when culling
+            std::vector<uint8_t> _items;            // per visited node, see RenderSystem.cpp
+            std::vector<sf::Transform> _transforms; // per visited node, including parallax
+            std::vector<math::AABBf> _bboxes;       // per visited node, including parallax
+            std::vector<size_t> _drawn;             // visited nodes that are drawn
+            std::vector<size_t> _drawnoffsets;      // per drawn node offset into _vertices, npos if not merged
+
+            // Visible set cache, _indices are valid for _region, _items,
+            // _transforms and _bboxes for _view
+            const RenderSystem* _system;    // built by, nullptr if invalid
+            uint64_t _generation;           // RenderSystem::_visgeneration at build time
+            uint64_t _moved;                // RenderSystem moved bbox log position at build time
+            math::AABBf _region;
+            math::AABBf _view;
+            bool _hasview;                  // false if built for the whole scene
+            bool _renderboxes;
+    };
+
     class RenderNode
     {
         friend class RenderSystem;
@@ -72,9 +145,35 @@ namespace gamelib
             Component* owner;
 
         private:
+            // Resolved options, updated when node, layer or root options change
+            sf::RenderStates _states;   // transform is unused
+            unsigned int _flags;
+            float _parallax;
+
             mutable math::AABBf _globalBBox;
             mutable bool _bboxdirty;    // used for bbox updates
+            int _chunk;     // index of the baked static chunk or -1
+            bool _bakedirty;    // mesh, transform or options changed since baking
+            int _proxy;     // spatial grid proxy or -1
+            uint64_t _sortkey;  // packed layer and node depth, ascending in render order
+            uint64_t _sequence; // insertion order, breaks ties between equal sort keys
+            bool _reorder;      // waiting to be (re)inserted into the render queue
+            size_t _queueindex; // position in the render queue and draw data, npos if not queued
     };
+
+
+    // Conversion of meshes to list types (sf::Points, sf::Lines or
+    // sf::Triangles), used for batching and by software rendering.
+
+    // The list type strips and fans are converted to
+    auto getBatchPrimitiveType(sf::PrimitiveType type) -> sf::PrimitiveType;
+
+    // Returns the amount of vertices writeBatchVertices() produces
+    auto getBatchVertexCount(size_t size, sf::PrimitiveType type) -> size_t;
+
+    // Writes the transformed vertices converted to getBatchPrimitiveType(type)
+    auto writeBatchVertices(sf::Vertex* out, const sf::Vertex* vertices, size_t size,
+            sf::PrimitiveType type, const sf::Transform& trans) -> void;
 }
 
 #endif
@@ -2,9 +2,14 @@
 #define GAMELIB_RENDERSYSTEM_HPP
 
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
 #include <SFML/Graphics.hpp>
 #include "gamelib/utils/SlotMap.hpp"
 #include "gamelib/utils/BatchAllocator.hpp"
+#include "gamelib/utils/SpatialGrid.hpp"
+#include "gamelib/utils/ThreadPool.hpp"
 #include "gamelib/core/Subsystem.hpp"
 #include "gamelib/json/JsonSerializer.hpp"
 #include "RenderStructs.hpp"
@@ -18,10 +23,75 @@
 // the only parents a node can have.
 // Layers don't have a transform because there would be two transform
 // hierachies otherwise.
+//
+// Static geometry:
+// Consecutive visible nodes in the render queue with the render_static flag
+// and equal render states are baked into one vertex buffer per run, with
+// their transforms applied. Parallax transforms depend on the view, so
+// nodes with parallax are never baked.
+// Runs are split into chunks of nodes with equal render states. When a
+// static node's mesh, transform or options change, or the order of static
+// nodes in the queue changes, the chunk layout is recomputed, which is
+// cheap. Only chunks whose nodes or states differ or that contain a changed
+// node are rebaked, the others keep their vertices and vertex buffer.
+//
+// Render queue:
+// The queue is kept sorted by a packed (layer depth, node depth) key, so
+// nodes of a layer form a contiguous range. New or reordered nodes are
+// inserted into the sorted queue on the next update, removed nodes are
+// dropped lazily. Only changing a layer's depth requires a full sort.
+// Nodes with equal keys stay in the order their meshes were created, also
+// after being reordered.
+//
+// Draw data:
+// Everything the render loop needs is kept in parallel arrays in render
+// queue order, including render states resolved from node, layer and root
+// options. The arrays are rebuilt when the queue or options change, moved
+// nodes are updated in place. Rendering therefore neither touches the
+// RenderNodes nor copies RenderOptions.
+//
+// Render lists:
+// Rendering is split into building a list of draw calls and drawing it.
+// Building culls nodes, composes parallax transforms and merges batches.
+// It only reads the RenderSystem and is split over a thread pool in
+// ranges of the render queue, with the same result as building it on one
+// thread. Lists for multiple cameras can be built at once using
+// buildRenderLists(). Only draw() needs the render target.
+//
+// Culling:
+// Global bounding boxes are kept in a spatial grid, so culling and picking
+// only visit nodes near the view rect or cursor. Candidates are sorted by
+// their position in the render queue to keep the layer/depth order.
+// Parallax moves nodes depending on the view, so nodes with parallax are
+// always considered.
+//
+// Visible set cache:
+// Render lists keep their candidates from a query extended by cullMargin
+// and their culling results. As long as the view stays inside the extended
+// rect and no node moved inside of it, the candidates are reused, and if
+// the view didn't change at all, the culling results, too. Only batches
+// and merged vertices are rebuilt in that case. Moved bboxes are logged
+// for this purpose, structural changes (queue, options, baking) invalidate
+// all cached sets.
+//
+// Vertex compaction:
+// Freed meshes leave gaps in the vertex allocator. Each update moves up to
+// compactBudget vertices down to close them and patches the moved mesh
+// handles and draw data. Vertex contents don't change, so neither baked
+// geometry nor cached visible sets are affected.
+//
+// Mesh updates:
+// Positions, UVs and colors are updated as separate streams, only changed
+// vertices count. The mesh bbox is only recalculated if a vertex on its
+// border moved, otherwise it is extended by the changed vertices.
+// Changed vertex ranges are collected for backends that keep a copy of
+// the vertices on the GPU, see getDirtyVertexRanges().
 
 
 namespace gamelib
 {
+    class RenderBackend;
+
     class RenderSystem : public Subsystem<RenderSystem>,
                          public JsonSerializer
     {
@@ -30,6 +100,7 @@ namespace gamelib
 
             typedef SlotMapShort<RenderLayer> LayerCollection;
             typedef std::vector<NodeHandle> RenderQueue;
+            typedef std::vector<RenderBatch> BatchList;
 
         public:
             RenderSystem();
@@ -70,6 +141,12 @@ namespace gamelib
                     const sf::Color* colors = nullptr,
                     bool updateSize = true)
                 -> void;
+            auto updateNodeMeshVertices(
+                    NodeHandle handle,
+                    size_t size, size_t offset,
+                    const sf::Vertex* vertices,
+                    bool updateSize = true)
+                -> void;
 
             auto getRootOptions() const                       -> const RenderOptions&;
             auto setRootOptions(const RenderOptions& options) -> void;
@@ -102,9 +179,36 @@ namespace gamelib
             auto forceUpdate() const -> void;   // NOTE: Debatable if this should be const, but makes things simpler
             auto render(sf::RenderTarget& target, const math::AABBf* rect = nullptr) const -> size_t;
             auto render(sf::RenderTarget& target, const math::AABBf& rect) const           -> size_t;
+            auto render(RenderBackend& backend, const math::AABBf* rect = nullptr) const   -> size_t;
+
+            // Calls forceUpdate() and uploads baked geometry, which requires
+            // a GL context. Call before building lists that will be drawn.
+            // Pass false for backends without vertex buffers, see
+            // RenderBackend::supportsVertexBuffers().
+            auto prepareRender(bool upload = true) const -> void;
+
+            // Builds the draw calls for the given view rect(s) without
+            // drawing anything. Requires forceUpdate() or prepareRender().
+            // Lists are valid until the next update or until a mesh is changed.
+            auto buildRenderList(RenderList* list, const math::AABBf* rect = nullptr) const     -> void;
+            auto buildRenderLists(RenderList* lists, const math::AABBf* rects, size_t num) const -> void;
+            auto draw(sf::RenderTarget& target, const RenderList& list) const                    -> size_t;
+            auto draw(RenderBackend& backend, const RenderList& list) const                      -> size_t;
+
+            // Builds the draw calls render() would issue for the given
+            // view rect without drawing anything. Valid until the next call
+            // to render() or updateBatches() or until a mesh is changed.
+            auto updateBatches(const math::AABBf* rect = nullptr) const -> const BatchList&;
 
             auto getNodeAtPosition(const math::Point2f& pos) const -> NodeHandle;
             auto getNumObjectsRendered() const                     -> size_t;
+            auto getNumDrawCalls() const                           -> size_t;
+            auto getVertexAllocator() const                        -> const BatchAllocator<sf::Vertex>&;
+
+            // Vertex ranges changed, moved or allocated since the last call
+            // to clearDirtyVertexRanges(), sorted and merged.
+            auto getDirtyVertexRanges() const -> const std::vector<VertexRange>&;
+            auto clearDirtyVertexRanges()     -> void;
 
             auto loadFromJson(const Json::Value& node) -> bool final override;
             auto writeToJson(Json::Value& node) const  -> void final override;
@@ -113,27 +217,106 @@ namespace gamelib
             auto begin() const -> RenderQueue::const_iterator;
             auto end() const   -> RenderQueue::const_iterator;
 
+        private:
+            struct StaticChunk
+            {
+                std::vector<sf::Vertex> vertices;   // cleared after uploading
+                sf::VertexBuffer buffer;
+                sf::PrimitiveType primitiveType;
+                sf::RenderStates states;
+                math::AABBf bbox;
+                std::vector<NodeHandle> nodes;  // in queue order
+            };
+
+            // Hot render data of queued nodes in render queue order
+            struct DrawData
+            {
+                std::vector<sf::RenderStates> states;   // resolved states including the node transform
+                std::vector<math::AABBf> bboxes;        // global bboxes
+                std::vector<size_t> vertices;           // index of the first vertex in _vertices
+                std::vector<size_t> sizes;
+                std::vector<sf::PrimitiveType> types;
+                std::vector<unsigned int> flags;
+                std::vector<float> parallax;
+                std::vector<int> chunks;
+            };
+
         private:
             auto _updateDirty()                                 -> void;
             auto _updateQueue()                                 -> void;
+            auto _queueNode(NodeHandle handle)                  -> void;
+            auto _queueLess(NodeHandle a, NodeHandle b) const   -> bool;
+            auto _getSortKey(const RenderNode& node) const      -> uint64_t;
             auto _updateMeshBBox(NodeHandle handle)             -> void;
+            auto _clipMeshUpdate(const Mesh& mesh, size_t size, size_t offset) const -> size_t;
+            auto _finishMeshUpdate(NodeHandle handle, size_t first, size_t last, size_t size, bool moved, bool border) -> void;
+            auto _markVerticesDirty(size_t begin, size_t end)   -> void;
+            auto _mergeDirtyRanges() const                      -> void;
             auto _updateNodeGlobalBBox(NodeHandle handle) const -> void;
             auto _markBBoxDirty(NodeHandle handle)              -> void;
             auto _freeMesh(NodeHandle handle)                   -> void;
+            auto _isNodeStatic(const RenderNode& node) const    -> bool;
+            auto _markStaticDirty(NodeHandle handle)            -> void;
+            auto _bakeStatic()                                  -> void;
+            auto _uploadStatic() const                          -> void;
+            auto _updateParallax()                              -> void;
+            auto _updateOptions()                               -> void;
+            auto _resolveOptions(NodeHandle handle)             -> void;
+            auto _updateDrawData()                              -> void;
+            auto _compactVertices()                             -> void;
+            auto _syncDrawData(const RenderNode& node)          -> void;
+            auto _getThreadPool() const                         -> ThreadPool*;
+            auto _buildRenderList(RenderList* list, const math::AABBf* rect, bool parallel) const -> void;
+            auto _cullNode(size_t index, const math::AABBf* rect, sf::Transform* trans, math::AABBf* bbox) const -> uint8_t;
+            auto _isVisibleSetValid(const RenderList* list, const math::AABBf* rect) const -> bool;
+            auto _markMoved(const RenderNode& node, const math::AABBf& oldbbox) -> void;
+            auto _invalidateVisibleSets()                                       -> void;
 
         public:
             bool renderBoxes;   // Render bounding boxes
+            bool batching;      // Merge consecutive nodes with equal render states into one draw call
+            size_t threads;     // Worker threads used to build render lists, 0 to only use the calling thread
+            float cullMargin;   // View movement up to which render lists reuse their visible set
+            size_t compactBudget;   // Vertices moved per update to close gaps left by freed meshes, 0 to disable
 
         private:
             BatchAllocator<sf::Vertex> _vertices;
             RenderOptions _root;
             LayerCollection _layers;
-            SlotMapShort<RenderNode> _nodes;
+            HandleSlotMap<RenderNode> _nodes;
             std::vector<NodeHandle> _renderqueue;
+            std::vector<NodeHandle> _queuepending;  // new or reordered nodes to insert into the queue
+            uint64_t _nextsequence;
             mutable size_t _numrendered;
+            mutable size_t _numdrawcalls;
+
+            mutable RenderList _list;   // used by render() and updateBatches()
+            mutable std::unique_ptr<ThreadPool> _pool;  // created on first use
+
+            DrawData _draw;
+            bool _drawdirty;        // queue, options or meshes changed, draw data has to be rebuilt
+            bool _optionsdirty;     // layer or root options changed, all nodes have to be resolved again
+
+            mutable std::vector<StaticChunk> _chunks;
+            std::vector<NodeHandle> _staticruns;    // baked nodes in queue order, runs separated by null handles
+            std::atomic<bool> _staticdirty;         // a baked mesh, transform or options changed
+            bool _staticorderdirty;                 // queue changed, static runs might be different
+
+            SpatialGrid<NodeHandle> _grid;          // global bboxes of all nodes with a mesh
+            std::vector<NodeHandle> _parallaxnodes; // nodes that can't be culled using the grid
+            bool _parallaxdirty;
 
             mutable std::vector<NodeHandle> _dirtylist; // used for global bbox updates
-            bool _orderdirty;    // used to sort and filter render list
+            std::vector<BatchRelocation> _relocations;  // used by _compactVertices()
+            mutable std::vector<VertexRange> _dirtyranges;
+            mutable bool _dirtymerged;  // _dirtyranges is sorted and merged
+            std::mutex _dirtylock;  // nodes may be moved from multiple threads, e.g. by parallel physics
+            bool _queuedirty;   // nodes were removed or reordered and have to be dropped from the queue
+            bool _orderdirty;   // layer depths changed, the whole queue has to be sorted
+
+            uint64_t _visgeneration;                // incremented when all cached visible sets become invalid
+            uint64_t _movedbase;                    // log position of _movedboxes[0]
+            std::vector<math::AABBf> _movedboxes;   // old and new bboxes of moved nodes
     };
 }
 
@@ -0,0 +1,109 @@
+#ifndef GAMELIB_SOFTWARERENDERER_HPP
+#define GAMELIB_SOFTWARERENDERER_HPP
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include "gamelib/utils/ThreadPool.hpp"
+#include "RenderBackend.hpp"
+
+/*
+ * Render backend rasterizing on the CPU into an RGBA framebuffer, e.g. for
+ * benchmarks and pixel comparisons on machines without a GPU.
+ *
+ * draw() only transforms and records primitives. display() bins them into
+ * screen tiles and rasterizes the tiles on a thread pool. Each tile draws
+ * its primitives in submission order, so the result does not depend on the
+ * amount of threads.
+ *
+ * Supported: points, lines and triangles (strips, fans and quads are
+ * converted), vertex colors, textures (nearest sampling, repeat or clamp),
+ * sf::BlendMode and clipping against the view's viewport.
+ * Not supported: shaders and vertex buffers. Textures live on the GPU, so
+ * their pixels have to be given as images using setTextureImage(). Batches
+ * with unknown textures are drawn untextured.
+ * Pixel centers are sampled with a top-left fill rule, lines and points
+ * are 1 pixel wide, so results can differ slightly from OpenGL's.
+ */
+
+namespace gamelib
+{
+    class SoftwareRenderer : public RenderBackend
+    {
+        public:
+            SoftwareRenderer();
+            SoftwareRenderer(unsigned int width, unsigned int height);
+
+            auto create(unsigned int width, unsigned int height) -> void;
+            auto clear(const sf::Color& color = sf::Color::Black) -> void;
+
+            // The image is used when a batch uses the texture. Pass nullptr
+            // to remove it. The image must outlive the renderer or the call
+            // to display().
+            auto setTextureImage(const sf::Texture* texture, const sf::Image* image) -> void;
+
+            // Rasterizes all pending draw calls
+            auto display() -> void;
+
+            // RGBA pixels, row by row. Pending draw calls are not included.
+            auto getPixels() const   -> const sf::Uint8*;
+            auto copyToImage() const -> sf::Image;
+
+            auto getSize() const -> sf::Vector2u final override;
+            auto getView() const -> sf::View final override;
+            auto setView(const sf::View& view) -> void final override;
+            auto draw(const RenderBatch& batch) -> void final override;
+            auto supportsVertexBuffers() const -> bool final override;
+
+        public:
+            size_t threads; // Worker threads used for rasterizing, 0 to only use the calling thread
+
+        private:
+            struct DrawCall
+            {
+                const sf::Image* image;
+                bool repeated;
+                sf::BlendMode blendMode;
+                int numvertices;    // per primitive, 1, 2 or 3
+            };
+
+            struct Bounds
+            {
+                int minx, miny, maxx, maxy; // inclusive
+            };
+
+            struct Primitive
+            {
+                size_t vertex;  // first vertex in _vertices
+                size_t call;
+                Bounds bounds;  // pixels possibly covered, clipped
+            };
+
+        private:
+            auto _getThreadPool() -> ThreadPool*;
+            auto _rasterizeTile(size_t tile) -> void;
+            auto _drawPoint(const Primitive& prim, const Bounds& rect) -> void;
+            auto _drawLine(const Primitive& prim, const Bounds& rect) -> void;
+            auto _drawTriangle(const Primitive& prim, const Bounds& rect) -> void;
+            auto _blend(const DrawCall& call, int x, int y, sf::Color color) -> void;
+
+        private:
+            sf::Vector2u _size;
+            std::vector<sf::Uint8> _pixels;
+            sf::View _view;
+            sf::Transform _viewtransform;   // world to pixel coordinates
+            sf::IntRect _clip;              // viewport in pixels, clipped to the framebuffer
+            std::unordered_map<const sf::Texture*, const sf::Image*> _images;
+
+            std::vector<DrawCall> _calls;
+            std::vector<Primitive> _primitives;
+            std::vector<sf::Vertex> _vertices;  // in pixel coordinates
+            std::vector<std::vector<size_t>> _bins;  // primitives per tile
+            size_t _tilesx, _tilesy;
+            std::unique_ptr<ThreadPool> _pool;  // created on first use
+    };
+}
+
+#endif
@@ -11,6 +11,8 @@ namespace gamelib
     constexpr unsigned int render_hidden        = 1 << 2;  // same as invisible but can be toggled using render_drawhidden
     constexpr unsigned int render_drawhidden    = 1 << 3;  // render render_hidden entities
     constexpr unsigned int render_scaleparallax = 1 << 4;  // Scale objects by their parallax values to create a 3D effect
+    constexpr unsigned int render_nobatch       = 1 << 5;  // Always draw this entity with its own draw call
+    constexpr unsigned int render_static        = 1 << 6;  // Entity rarely changes and is baked into vertex buffers
 
     constexpr const char* str_renderflags[] = {
         "Invisible",
@@ -18,6 +20,8 @@ namespace gamelib
         "Hidden",
         "Draw hidden",
         "Scale parallax",
+        "No batch",
+        "Static",
     };
 
     constexpr unsigned int num_renderflags = ARRAY_SIZE(str_renderflags);
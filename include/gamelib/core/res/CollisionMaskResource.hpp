@@ -0,0 +1,84 @@
+#ifndef GAMELIB_COLLISIONMASK_RESOURCE_HPP
+#define GAMELIB_COLLISIONMASK_RESOURCE_HPP
+
+#include <map>
+#include <mutex>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Color.hpp>
+#include "Resource.hpp"
+#include "TextureResource.hpp"
+#include "gamelib/core/geometry/PixelMask.hpp"
+
+/*
+ * Pixel collision data of a texture. Pixels with alpha 0 or the mask color
+ * are empty, everything else is solid.
+ *
+ * Masks are usually created with getCollisionMask(), which shares one mask
+ * per texture and mask color as long as it is referenced. Shared masks are
+ * kept in the CollisionMaskCache of the active ResourceManager.
+ *
+ * Config file structure (*.colmask):
+ * {
+ *     "texture": "texture",
+ *     "mask": [ r, g, b, a ]
+ * }
+ */
+
+namespace gamelib
+{
+    class ResourceManager;
+
+    void registerCollisionMaskLoader(ResourceManager& resmgr);
+
+    BaseResourceHandle collisionMaskLoader(const std::string& fname, ResourceManager* resmgr);
+
+    struct CollisionMaskData
+    {
+        TextureResource::Handle tex;    // Null if created from an image
+        sf::Color color;
+        PixelMask mask;
+    };
+
+    typedef Resource<CollisionMaskData, 0x3c1a9e57> CollisionMaskResource;
+
+    // Weak references to shared masks by texture and mask color.
+    // Expired entries are removed lazily, once the cache has doubled in size
+    // since the last cleanup, so lookups stay O(log n).
+    class CollisionMaskCache
+    {
+        public:
+            CollisionMaskCache();
+
+            // Returns the mask of the given texture and mask color and
+            // creates it if it doesn't exist.
+            auto get(TextureResource::Handle tex, sf::Color color) -> CollisionMaskResource::Handle;
+
+            // Removes expired entries
+            auto clean() -> void;
+            auto clear() -> void;
+            auto size() const -> size_t;
+
+        private:
+            typedef std::pair<const sf::Texture*, sf::Uint32> Key;
+
+            auto _clean() -> void;
+
+        private:
+            // Keyed by address. Live masks hold a handle to their texture,
+            // so the address can only be reused after the entry expired.
+            std::map<Key, std::weak_ptr<CollisionMaskResource>> _masks;
+            mutable std::mutex _lock;
+            size_t _cleansize;  // size that triggers the next cleanup
+    };
+
+    // Returns the shared mask of the given texture and mask color and
+    // creates it if it doesn't exist.
+    // Uses the active ResourceManager's cache. Without a ResourceManager
+    // the mask isn't shared.
+    auto getCollisionMask(TextureResource::Handle tex, sf::Color color) -> CollisionMaskResource::Handle;
+
+    // Creates a new mask that is not shared.
+    auto createCollisionMask(const sf::Image& img, sf::Color color) -> CollisionMaskResource::Handle;
+}
+
+#endif
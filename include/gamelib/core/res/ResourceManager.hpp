@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <boost/filesystem.hpp>
 #include "Resource.hpp"
+#include "CollisionMaskResource.hpp"
 #include "gamelib/core/Subsystem.hpp"
 #include "gamelib/json/JsonSerializer.hpp"
 
@@ -35,6 +36,10 @@
 // 
 // To prevent possible segfaults after calling clean(), objects should store
 // the corresponding resource handle to keep up the reference count.
+//
+// Shared collision masks (see getCollisionMask()) aren't files, so they are
+// kept in a separate cache that only holds weak references. clean(),
+// clear() and destroy() also clean or clear the cache.
 
 // Config file structure:
 // (Lines starting with # are comments and are not valid json.)
@@ -64,6 +69,15 @@
 //         ...
 //     }
 //
+//     # Optional, packs the textures of all preloaded sprites into atlases
+//     # (see packSpriteAtlases()). Happens after "preload" and before "once".
+//     "atlas": {
+//         # Optional, relative to cwd
+//         "cache": "<cache file>",
+//         "pagesize": <size>,     # Default is 2048
+//         "padding": <padding>    # Default is 1
+//     },
+//
 //     # Files to load but without caching them.
 //     # Useful for config files that are only applied once
 //     "once": {
@@ -135,6 +149,8 @@ namespace gamelib
             // Free all resources, clear searchpath and remove loader callbacks
             auto destroy() -> void;
 
+            auto getCollisionMasks() -> CollisionMaskCache&;
+
             // Calls a callback for each resource (of the given type).
             // Loop breaks when the callback returns true.
             // Callback signature: bool(const std::string&, BaseResourceHandle)
@@ -158,6 +174,8 @@ namespace gamelib
             std::unordered_map<std::string, BaseResourceHandle> _res;
             std::unordered_map<std::string, LoaderCallback> _typemap;
             std::vector<boost::filesystem::path> _searchpaths;
+            CollisionMaskCache _masks;
+            Json::Value _atlas;     // atlas config, written back by writeToJson()
     };
 }
 
@@ -31,9 +31,11 @@ namespace gamelib
     {
         TextureResource::Handle tex;
         AnimationData ani;
-        math::AABBi rect;
+        math::AABBi rect;       // first frame, relative to region
+        math::AABBi region;     // area of tex containing the frames, e.g. in an atlas
         math::Point2f origin;
 
+        // Returns the frame's texture coordinates as (left, top, right, bottom)
         auto getFrameRect(int index) -> math::AABBi;
     };
 
@@ -0,0 +1,56 @@
+#ifndef GAMELIB_TEXTURE_ATLAS_HPP
+#define GAMELIB_TEXTURE_ATLAS_HPP
+
+#include <string>
+
+/*
+ * Packs the textures of all loaded sprites into a few large atlas textures,
+ * so sprites from different sheets share a texture and can be batched by
+ * the RenderSystem.
+ *
+ * Sprites are changed to use the atlas page and the region of their sheet
+ * in it (see SpriteResourceData::region). Textures larger than a page are
+ * left alone, as are other resources using the original textures.
+ * Call it after loading resources and before creating sprite components,
+ * because components copy the sprite's texture. ResourceManager calls it
+ * after preloading if its config has an "atlas" entry.
+ *
+ * If a cache file is given, the pages are saved as png next to it and the
+ * layout is stored in the file. Later calls load the pages instead of
+ * packing, as long as the set of textures and their sizes and modification
+ * times didn't change.
+ *
+ * Cache file structure:
+ * {
+ *     "pagesize": size,
+ *     "padding": padding,
+ *     "pages": [ "<cache file name>.0.png", ... ],    # relative to the cache file
+ *     "textures": {
+ *         "<texture path>": {
+ *             "page": index,
+ *             "pos": [ x, y ],
+ *             "size": [ w, h ],
+ *             "mtime": time
+ *         },
+ *         ...
+ *     }
+ * }
+ */
+
+namespace gamelib
+{
+    class ResourceManager;
+
+    // Returns the number of sprites moved to an atlas.
+    // padding is the amount of pixels the textures' edges are extended by
+    // to prevent bleeding when filtering.
+    auto packSpriteAtlases(
+            ResourceManager& resmgr,
+            const std::string& cachefile = "",
+            int pagesize = 2048,
+            int padding = 1,
+            bool forcepack = false)
+        -> size_t;
+}
+
+#endif
@@ -1,7 +1,8 @@
 #ifndef GAMELIB_UPDATE_SYSTEM_HPP
 #define GAMELIB_UPDATE_SYSTEM_HPP
 
-#include "gamelib/utils/SlotMap.hpp"
+#include <vector>
+#include "gamelib/utils/DenseSlotMap.hpp"
 #include "gamelib/core/Subsystem.hpp"
 #include "Updatable.hpp"
 
@@ -9,6 +10,16 @@
  * Updates all registered UpdateComponents in the given intervals.
  * The frametime between individual updates is saved and passed to the object
  * when it's time to update again.
+ *
+ * Components that return an UpdateScheduler in getScheduler() are not
+ * updated immediately. Instead, all due components of a hook that use the
+ * same scheduler are collected and passed to it at the end of the hook, so
+ * they can be updated in a batch, e.g. in parallel.
+ *
+ * Components are stored packed, so iterating costs O(registered components).
+ * Components removed during update() are skipped immediately but only
+ * destroyed at the end of update(), because destroying moves other
+ * components while the hook is being iterated.
  */
 
 namespace gamelib
@@ -34,14 +45,27 @@ namespace gamelib
     };
 
 
+    class UpdateScheduler
+    {
+        public:
+            virtual ~UpdateScheduler() {}
+
+            // Must call update() on every given component with the
+            // respective elapsed time.
+            virtual auto update(UpdateComponent* const* objs, const float* elapsed, size_t num) -> void = 0;
+    };
+
+
     class UpdateSystem : public Updatable, public Subsystem<UpdateSystem>
     {
         public:
-            typedef SlotKeyShort Handle;
+            typedef HandleKey Handle;
 
             ASSIGN_NAMETAG("UpdateSystem");
 
         public:
+            UpdateSystem();
+
             Handle add(UpdateComponent* obj, UpdateHookType hook);
             void remove(Handle handle, UpdateHookType hook);
             void destroy();
@@ -57,7 +81,9 @@ namespace gamelib
             };
 
         private:
-            SlotMapShort<Data> _objs[NumFrameHooks];
+            HandleDenseSlotMap<Data> _objs[NumFrameHooks];
+            std::vector<Handle> _removed[NumFrameHooks]; // removed during update()
+            bool _updating;
     };
 }
 
@@ -2,7 +2,11 @@
 #define GAMELIB_BATCHALLOCATOR_HPP
 
 #include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
 #include <cassert>
+#include <type_traits>
 
 /*
  * BatchAllocator uses std::vector internally to allocate a resizable, continuous
@@ -21,6 +25,28 @@
  *
  * As BatchAllocator uses std::vector internally, reallocations invalidate all pointers.
  * It is therefore not advised to use pointers to access elements if a reallocate could happen.
+ * Indices stay valid until the block is freed.
+ *
+ * Free blocks are kept in segregated lists (TLSF-like): the first level
+ * splits sizes by powers of two, the second level splits each power of two
+ * into sl_count ranges. Bitmaps mark non-empty lists, so finding a fitting
+ * block is O(1): every block in a list after the request's own list fits,
+ * of the request's own list only the first block is checked.
+ * A side array tags the first and past-the-end index of every free block
+ * (boundary tags), so free() merges neighbouring free blocks in O(1).
+ * Neighbouring free blocks are always merged, so one tag per index suffices.
+ * Free blocks at the end are released.
+ *
+ * compact() incrementally closes the gaps left by free(): it moves the
+ * live elements after the lowest free block down, so the free block
+ * bubbles up until it reaches the end and is released. Each relocation is
+ * a range of consecutive live blocks. Every handle with an index inside a
+ * range has to be adjusted by the caller, e.g. using BatchRelocation::apply().
+ * The amount of elements moved per call is limited to spread the work
+ * over multiple frames. To not split blocks when the budget runs out, the
+ * first index of every live block is marked in a bitmap.
+ * Relocations invalidate pointers, but not indices of blocks outside the
+ * reported ranges.
  */
 
 namespace gamelib
@@ -41,30 +67,116 @@ namespace gamelib
         }
     };
 
+    // A range of live elements moved by BatchAllocator::compact()
+    struct BatchRelocation
+    {
+        size_t from;
+        size_t to;
+        size_t size;
+
+        // Updates the index if it is inside the moved range.
+        // Returns true if it was.
+        inline bool apply(size_t* index) const
+        {
+            if (*index < from || *index >= from + size)
+                return false;
+            *index = *index - from + to;
+            return true;
+        }
+    };
+
     template <typename T>
     class BatchAllocator
     {
         public:
+            BatchAllocator();
+
             BatchHandle allocate(size_t size);
             void        free(BatchHandle handle);
             void        clear();
             T*          get(size_t index);
             const T*    get(size_t index) const;
 
+            // Moves up to maxelements live elements down to fill free
+            // blocks and appends the moved ranges to relocations, ordered
+            // by their old index. Blocks are never split, so if the first
+            // block to move is larger than maxelements, only this block
+            // is moved. Returns the number of moved elements.
+            size_t compact(std::vector<BatchRelocation>* relocations, size_t maxelements);
+
+            size_t getSize() const;         // Allocated elements including free blocks
+            size_t getFreeSize() const;     // Elements in free blocks
+            size_t getNumFreeBlocks() const;
+            float  getFragmentation() const; // Free share of the size, 0 if compact
+
+        private:
+            static constexpr int sl_bits = 3;
+            static constexpr int sl_count = 1 << sl_bits;
+            static constexpr int fl_count = 64 - sl_bits + 1;
+
+            struct FreeBlock
+            {
+                size_t index;
+                size_t size;
+                int prev;   // in the size list
+                int next;   // in the size list or the list of unused blocks
+            };
+
+        private:
+            static int  _lowestBit(uint64_t word);
+            static int  _highestBit(uint64_t word);
+            static void _mapping(size_t size, int* fl, int* sl);
+
+            int  _findFree(size_t size) const;
+            int  _freeBegin(size_t index) const;
+            int  _freeEnd(size_t index) const;
+            int  _lowestFree();
+            void _insertFree(size_t index, size_t size);
+            void _removeFree(int block);
+
         private:
             std::vector<T> _data;
-            std::vector<BatchHandle> _freelist;
+            std::vector<FreeBlock> _blocks;
+            std::vector<int> _tags;             // index -> free block starting or ending there, size + 1
+            std::vector<bool> _starts;          // index -> a live block starts there
+            std::vector<size_t> _gaps;          // min-heap of free block indices, may contain stale entries
+            int _unusedblocks;                  // unused entries in _blocks
+            size_t _numfree;
+            size_t _freesize;
+            uint64_t _flbitmap;
+            uint32_t _slbitmap[fl_count];
+            int _heads[fl_count][sl_count];
     };
 }
 
 // Implementation
 namespace gamelib
 {
+    template <typename T>
+    BatchAllocator<T>::BatchAllocator()
+    {
+        clear();
+    }
+
     template <typename T>
     void BatchAllocator<T>::clear()
     {
         _data.clear();
-        _freelist.clear();
+        _blocks.clear();
+        _starts.clear();
+        _tags.assign(1, -1);
+        _gaps.clear();
+        _unusedblocks = -1;
+        _numfree = 0;
+        _freesize = 0;
+        _flbitmap = 0;
+
+        for (int fl = 0; fl < fl_count; ++fl)
+        {
+            _slbitmap[fl] = 0;
+            for (int sl = 0; sl < sl_count; ++sl)
+                _heads[fl][sl] = -1;
+        }
     }
 
     template <typename T>
@@ -75,44 +187,26 @@ namespace gamelib
         BatchHandle handle;
         handle.size = size;
 
-        if (!_freelist.empty())
+        const int block = _findFree(size);
+        if (block == -1)
         {
-            size_t candidate = -1;
-            for (size_t i = 0; i < _freelist.size(); ++i)
-            {
-                size_t chunksize = _freelist[i].size;
-                if (chunksize == size)
-                {
-                    candidate = i;
-                    break;
-                }
-                else if (chunksize > size)
-                {
-                    // TODO: find good policy
-                    if (candidate == (size_t)-1)
-                        candidate = i;
-                }
-            }
-
-            if (candidate != (size_t)-1)
-            {
-                handle.index = _freelist[candidate].index;
-                size_t sizediff = _freelist[candidate].size - size;
+            handle.index = _data.size();
+            _data.insert(_data.end(), size, T());
+            _tags.resize(_data.size() + 1, -1);
+            _starts.resize(_data.size());
+            _starts[handle.index] = true;
+            return handle;
+        }
 
-                if (sizediff == 0)
-                    _freelist.erase(_freelist.begin() + candidate);
-                else
-                {
-                    _freelist[candidate].index += size;
-                    _freelist[candidate].size = sizediff;
-                }
+        const size_t index = _blocks[block].index;
+        const size_t sizediff = _blocks[block].size - size;
+        _removeFree(block);
 
-                return handle;
-            }
-        }
+        if (sizediff > 0)
+            _insertFree(index + size, sizediff);
 
-        handle.index = _data.size();
-        _data.insert(_data.end(), size, T());
+        _starts[index] = true;
+        handle.index = index;
         return handle;
     }
 
@@ -121,63 +215,42 @@ namespace gamelib
     {
         assert(handle.index < _data.size() && "Index out of bounds");
         assert(handle.size > 0 && "Size should not be zero");
+        assert(_starts[handle.index] && "Not the start of a block");
 
+        size_t index = handle.index;
         size_t end = handle.index + handle.size;
+        _starts[index] = false;
 
-        // Simple erase if chunk is at the end
-        if (end == _data.size())
+        // Merge with neighbouring free blocks
+        const int left = _freeEnd(index);
+        if (left != -1)
         {
-            auto begin = _data.begin() + handle.index;
-            if (!_freelist.empty() && _freelist.back().index + _freelist.back().size == handle.index)
-            {
-                begin = _data.begin() + _freelist.back().index;
-                _freelist.pop_back();
-            }
-
-            _data.erase(begin, _data.end());
-            return;
+            index = _blocks[left].index;
+            _removeFree(left);
         }
 
-        if (_freelist.empty() || handle.index > _freelist.back().index + _freelist.back().size)
+        const int right = _freeBegin(end);
+        if (right != -1)
         {
-            _freelist.push_back(handle);
+            end += _blocks[right].size;
+            _removeFree(right);
         }
-        else
+
+        // Simple erase if chunk is at the end
+        if (end == _data.size())
         {
-            // Search and merge connected chunks
-            for (size_t i = 0; i < _freelist.size(); ++i)
-            {
-                size_t freeend = _freelist[i].index + _freelist[i].size;
-                if (end == _freelist[i].index)
-                {
-                    _freelist[i].index = handle.index;
-                    _freelist[i].size += handle.size;
-                    break;
-                }
-                else if (freeend == handle.index)
-                {
-                    _freelist[i].size += handle.size;
-                    // check if next block is also mergeable (current block is in between these two)
-                    if (i + 1 < _freelist.size() && _freelist[i + 1].index == freeend + handle.size)
-                    {
-                        _freelist[i].size += _freelist[i + 1].size;
-                        _freelist.erase(_freelist.begin() + i + 1);
-                    }
-                    break;
-                }
-                else if (_freelist[i].index > end)
-                {
-                    // if unconnected, insert new free node
-                    _freelist.insert(_freelist.begin() + i, handle);
-                    break;
-                }
-            }
+            _data.erase(_data.begin() + index, _data.end());
+            _tags.resize(_data.size() + 1);
+            _starts.resize(_data.size());
+            return;
         }
 
         // destruct/overwrite objects if neccesesary
         if (!std::is_trivially_destructible<T>::value)
             for (size_t i = handle.index; i < handle.index + handle.size; ++i)
                 _data[i] = T();
+
+        _insertFree(index, end - index);
     }
 
     template <typename T>
@@ -192,6 +265,311 @@ namespace gamelib
     {
         return const_cast<T*>(const_cast<const BatchAllocator<T>*>(this)->get(index));
     }
+
+    template <typename T>
+    size_t BatchAllocator<T>::compact(std::vector<BatchRelocation>* relocations, size_t maxelements)
+    {
+        size_t moved = 0;
+
+        while (moved < maxelements)
+        {
+            const int block = _lowestFree();
+            if (block == -1)
+                break;
+
+            const size_t index = _blocks[block].index;
+            const size_t size = _blocks[block].size;
+
+            // Drop it from the heap (including duplicates) to find the next one
+            while (!_gaps.empty() && _gaps.front() == index)
+            {
+                std::pop_heap(_gaps.begin(), _gaps.end(), std::greater<size_t>());
+                _gaps.pop_back();
+            }
+            const int next = _lowestFree();
+
+            // Free blocks are always followed by live elements up to the
+            // next free block or the end, otherwise they would be merged
+            // or released.
+            const size_t livebegin = index + size;
+            const size_t liveend = next == -1 ? _data.size() : _blocks[next].index;
+            const size_t budget = maxelements - moved;
+            size_t livesize = liveend - livebegin;
+
+            // Move only the blocks that fit into the budget, or the first
+            // block if it is larger than the whole budget
+            if (livesize > budget)
+            {
+                size_t blockend = livebegin + budget;
+                while (blockend > livebegin && !_starts[blockend])
+                    --blockend;
+
+                if (blockend == livebegin)
+                {
+                    if (moved > 0)
+                    {
+                        // Keep it for the next call
+                        _gaps.push_back(index);
+                        std::push_heap(_gaps.begin(), _gaps.end(), std::greater<size_t>());
+                        break;
+                    }
+
+                    blockend = livebegin + budget + 1;
+                    while (blockend < liveend && !_starts[blockend])
+                        ++blockend;
+                }
+
+                livesize = blockend - livebegin;
+            }
+
+            const size_t newindex = index + livesize;
+            const size_t moveend = livebegin + livesize;
+
+            std::move(_data.begin() + livebegin, _data.begin() + moveend, _data.begin() + index);
+            for (size_t i = 0; i < livesize; ++i)
+                _starts[index + i] = _starts[livebegin + i];
+            std::fill(_starts.begin() + newindex, _starts.begin() + moveend, false);
+
+            relocations->push_back({ livebegin, index, livesize });
+            moved += livesize;
+
+            _removeFree(block);
+
+            if (moveend == _data.size())
+            {
+                _data.erase(_data.begin() + newindex, _data.end());
+                _tags.resize(_data.size() + 1);
+                _starts.resize(_data.size());
+                break;
+            }
+
+            if (!std::is_trivially_destructible<T>::value)
+                for (size_t i = newindex; i < moveend; ++i)
+                    _data[i] = T();
+
+            // Budget exhausted, the gap moved up by the moved blocks
+            if (moveend != liveend)
+            {
+                _insertFree(newindex, size);
+                break;
+            }
+
+            // Merge with the next free block
+            const size_t nextsize = _blocks[next].size;
+            _removeFree(next);
+            _insertFree(newindex, size + nextsize);
+        }
+
+        return moved;
+    }
+
+    template <typename T>
+    size_t BatchAllocator<T>::getSize() const
+    {
+        return _data.size();
+    }
+
+    template <typename T>
+    size_t BatchAllocator<T>::getFreeSize() const
+    {
+        return _freesize;
+    }
+
+    template <typename T>
+    size_t BatchAllocator<T>::getNumFreeBlocks() const
+    {
+        return _numfree;
+    }
+
+    template <typename T>
+    float BatchAllocator<T>::getFragmentation() const
+    {
+        return _data.empty() ? 0 : (float)_freesize / _data.size();
+    }
+
+    template <typename T>
+    int BatchAllocator<T>::_lowestBit(uint64_t word)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(word);
+#else
+        int i = 0;
+        while (!(word & 1))
+        {
+            word >>= 1;
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+    template <typename T>
+    int BatchAllocator<T>::_highestBit(uint64_t word)
+    {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(word);
+#else
+        int i = 0;
+        while (word >>= 1)
+            ++i;
+        return i;
+#endif
+    }
+
+    template <typename T>
+    void BatchAllocator<T>::_mapping(size_t size, int* fl, int* sl)
+    {
+        // Sizes below sl_count map linearly to the first list
+        const int msb = _highestBit(size);
+        if (msb < sl_bits)
+        {
+            *fl = 0;
+            *sl = size;
+        }
+        else
+        {
+            *fl = msb - sl_bits + 1;
+            *sl = (size >> (msb - sl_bits)) - sl_count;
+        }
+    }
+
+    template <typename T>
+    int BatchAllocator<T>::_findFree(size_t size) const
+    {
+        int fl, sl;
+        _mapping(size, &fl, &sl);
+
+        // The first block of the size's own list might fit, too
+        const int head = _heads[fl][sl];
+        if (head != -1 && _blocks[head].size >= size)
+            return head;
+
+        // Search the lists of larger sizes
+        uint32_t slmap = sl + 1 < sl_count ? _slbitmap[fl] & (~0u << (sl + 1)) : 0;
+        if (!slmap)
+        {
+            const uint64_t flmap = fl + 1 < 64 ? _flbitmap & (~uint64_t(0) << (fl + 1)) : 0;
+            if (!flmap)
+                return -1;
+
+            fl = _lowestBit(flmap);
+            slmap = _slbitmap[fl];
+        }
+
+        return _heads[fl][_lowestBit(slmap)];
+    }
+
+    template <typename T>
+    int BatchAllocator<T>::_freeBegin(size_t index) const
+    {
+        const int block = index < _tags.size() ? _tags[index] : -1;
+        return block != -1 && _blocks[block].index == index ? block : -1;
+    }
+
+    template <typename T>
+    int BatchAllocator<T>::_freeEnd(size_t index) const
+    {
+        const int block = _tags[index];
+        return block != -1 && _blocks[block].index != index ? block : -1;
+    }
+
+    template <typename T>
+    int BatchAllocator<T>::_lowestFree()
+    {
+        while (!_gaps.empty())
+        {
+            const int block = _freeBegin(_gaps.front());
+            if (block != -1)
+                return block;
+
+            std::pop_heap(_gaps.begin(), _gaps.end(), std::greater<size_t>());
+            _gaps.pop_back();
+        }
+        return -1;
+    }
+
+    template <typename T>
+    void BatchAllocator<T>::_insertFree(size_t index, size_t size)
+    {
+        int block;
+        if (_unusedblocks != -1)
+        {
+            block = _unusedblocks;
+            _unusedblocks = _blocks[block].next;
+        }
+        else
+        {
+            block = _blocks.size();
+            _blocks.emplace_back();
+        }
+
+        int fl, sl;
+        _mapping(size, &fl, &sl);
+
+        FreeBlock& b = _blocks[block];
+        b.index = index;
+        b.size = size;
+        b.prev = -1;
+        b.next = _heads[fl][sl];
+
+        if (b.next != -1)
+            _blocks[b.next].prev = block;
+
+        _heads[fl][sl] = block;
+        _slbitmap[fl] |= 1u << sl;
+        _flbitmap |= uint64_t(1) << fl;
+        _tags[index] = block;
+        _tags[index + size] = block;
+        ++_numfree;
+        _freesize += size;
+
+        // Rebuild when stale entries dominate, amortized O(1)
+        if (_gaps.size() > 2 * _numfree + 16)
+        {
+            _gaps.clear();
+            for (int fl = 0; fl < fl_count; ++fl)
+                for (int sl = 0; sl < sl_count; ++sl)
+                    for (int i = _heads[fl][sl]; i != -1; i = _blocks[i].next)
+                        _gaps.push_back(_blocks[i].index);
+            std::make_heap(_gaps.begin(), _gaps.end(), std::greater<size_t>());
+        }
+        else
+        {
+            _gaps.push_back(index);
+            std::push_heap(_gaps.begin(), _gaps.end(), std::greater<size_t>());
+        }
+    }
+
+    template <typename T>
+    void BatchAllocator<T>::_removeFree(int block)
+    {
+        FreeBlock& b = _blocks[block];
+
+        int fl, sl;
+        _mapping(b.size, &fl, &sl);
+
+        if (b.prev != -1)
+            _blocks[b.prev].next = b.next;
+        else
+            _heads[fl][sl] = b.next;
+
+        if (b.next != -1)
+            _blocks[b.next].prev = b.prev;
+
+        if (_heads[fl][sl] == -1)
+        {
+            _slbitmap[fl] &= ~(1u << sl);
+            if (!_slbitmap[fl])
+                _flbitmap &= ~(uint64_t(1) << fl);
+        }
+
+        _tags[b.index] = -1;
+        _tags[b.index + b.size] = -1;
+        --_numfree;
+        _freesize -= b.size;
+        b.next = _unusedblocks;
+        _unusedblocks = block;
+    }
 }
 
 #endif
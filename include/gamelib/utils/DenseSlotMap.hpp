@@ -0,0 +1,136 @@
+#ifndef GAMELIB_DENSESLOTMAP_HPP
+#define GAMELIB_DENSESLOTMAP_HPP
+
+#include <vector>
+#include "SlotMap.hpp"
+
+/*
+ * A SlotMap that keeps its objects packed in one contiguous array.
+ *
+ * Keys are the same as in SlotMap, but a slot only stores the position of
+ * its object in the dense value array. destroy() moves the last object into
+ * the freed position (swap-remove), so the values array never has holes:
+ * iterating costs O(live objects) regardless of how many objects existed
+ * before, and size() is O(1).
+ * A second packed array stores the slot index of each object, which is used
+ * to fix the moved object's slot and to get the key of an object while
+ * iterating.
+ *
+ * Differences to SlotMap:
+ *  - destroy() destructs the object instead of overwriting it with T().
+ *  - destroy() moves another object, which invalidates pointers to it and
+ *    changes the iteration order. Destroying objects while iterating skips
+ *    the object moved into the current position, so defer it if needed.
+ *  - Pointers are invalidated by acquire() like with a vector SlotMap.
+ *
+ * Objects acquired while iterating are iterated as well, like in SlotMap.
+ * Slots are retired before their version wraps around, like in SlotMap.
+ */
+
+namespace gamelib
+{
+    // MapType is the DenseSlotMap to iterate over, const for const iterators
+    template <typename MapType, typename ValueType>
+    class DenseSlotMapIterator : public std::iterator<std::forward_iterator_tag, ValueType>
+    {
+        public:
+            typedef DenseSlotMapIterator<MapType, ValueType> type;
+            typedef DenseSlotMapIterator<const MapType, const ValueType> const_iterator;
+            typedef typename MapType::Handle Handle;
+            typedef typename MapType::size_type IndexType;
+
+        public:
+            DenseSlotMapIterator();
+            DenseSlotMapIterator(MapType& map, IndexType i);
+
+            auto operator++() -> type&;
+            auto operator++(int) -> type;
+
+            // All iterators past the last object compare equal
+            auto operator==(const type& rhs) const -> bool;
+            auto operator!=(const type& rhs) const -> bool;
+
+            auto operator*() -> ValueType&;
+            ValueType* operator->();
+
+            auto handle() const -> Handle;
+
+            operator const_iterator() const;
+
+        private:
+            IndexType _index;
+            MapType* _map;
+    };
+
+
+    template <typename T, typename IndexType = unsigned int, typename VersionType = unsigned int>
+    class DenseSlotMap
+    {
+        private:
+            struct Slot
+            {
+                VersionType version;
+                IndexType nextempty;
+                IndexType dense;    // position in _values
+
+                Slot() : version(0), nextempty(-1), dense(-1) {}
+            };
+
+        public:
+            typedef DenseSlotMap<T, IndexType, VersionType> selftype;
+            typedef SlotKey<IndexType, VersionType> Handle;
+
+            typedef std::ptrdiff_t difference_type;
+            typedef IndexType size_type;
+            typedef T value_type;
+            typedef T* pointer;
+            typedef T& reference;
+            typedef DenseSlotMapIterator<selftype, T> iterator;
+            typedef typename iterator::const_iterator const_iterator;
+
+        public:
+            DenseSlotMap();
+            DenseSlotMap(IndexType size);
+
+            auto acquire()                 -> Handle;
+            auto destroy(Handle key)       -> void;
+            auto isValid(Handle key) const -> bool;
+            auto clear()                   -> void;
+            auto size() const              -> IndexType;
+            auto empty() const             -> bool;
+
+            auto get(Handle key) const -> const T*;
+            auto get(Handle key)       -> T*;
+
+            // Packed objects, size() elements
+            auto data() const -> const T*;
+            auto data()       -> T*;
+
+            // Key of the object at the given position in data()
+            auto handle(IndexType i) const -> Handle;
+
+            auto begin()       -> iterator;
+            auto begin() const -> const_iterator;
+            auto end()         -> iterator;
+            auto end() const   -> const_iterator;
+
+            auto operator[](Handle key) const -> const T&;
+            auto operator[](Handle key)       -> T&;
+
+        private:
+            IndexType _firstempty;
+            std::vector<Slot> _slots;
+            std::vector<T> _values;
+            std::vector<IndexType> _owners; // slot index of each value
+    };
+
+    template <typename T>
+    using DenseSlotMapShort = DenseSlotMap<T, unsigned short, unsigned short>;
+
+    template <typename T>
+    using HandleDenseSlotMap = DenseSlotMap<T, handle_index_type, handle_version_type>;
+}
+
+#include "DenseSlotMap.inl"
+
+#endif
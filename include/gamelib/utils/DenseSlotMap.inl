@@ -0,0 +1,256 @@
+#ifndef GAMELIB_DENSESLOTMAP_INL
+#define GAMELIB_DENSESLOTMAP_INL
+
+#include "DenseSlotMap.hpp"
+#include <cassert>
+#include <utility>
+
+namespace gamelib
+{
+    template <typename T, typename IT, typename VT>
+    DenseSlotMap<T, IT, VT>::DenseSlotMap() :
+        _firstempty(-1)
+    { }
+
+    template <typename T, typename IT, typename VT>
+    DenseSlotMap<T, IT, VT>::DenseSlotMap(IT size) :
+        _firstempty(-1)
+    {
+        _slots.reserve(size);
+        _values.reserve(size);
+        _owners.reserve(size);
+    }
+
+    template <typename T, typename IT, typename VT>
+    typename DenseSlotMap<T, IT, VT>::Handle DenseSlotMap<T, IT, VT>::acquire()
+    {
+        IT i = _firstempty;
+        if (i == (IT)-1)
+        {
+            assert(_slots.size() < (IT)-1 && "DenseSlotMap is full");
+            i = _slots.size();
+            _slots.emplace_back();
+        }
+        else
+        {
+            if (i == _slots[i].nextempty)
+                _firstempty = -1;
+            else
+                _firstempty = _slots[i].nextempty;
+            _slots[i].nextempty = -1;
+        }
+
+        _slots[i].dense = _values.size();
+        _values.emplace_back();
+        _owners.push_back(i);
+        return Handle(i, _slots[i].version);
+    }
+
+    template <typename T, typename IT, typename VT>
+    void DenseSlotMap<T, IT, VT>::destroy(Handle key)
+    {
+        if (!isValid(key))
+            return;
+
+        Slot& slot = _slots[key.index];
+        const IT last = _values.size() - 1;
+
+        if (slot.dense != last)
+        {
+            _values[slot.dense] = std::move(_values[last]);
+            _owners[slot.dense] = _owners[last];
+            _slots[_owners[last]].dense = slot.dense;
+        }
+
+        _values.pop_back();
+        _owners.pop_back();
+
+        slot.dense = -1;
+        ++slot.version;
+
+        // Retire the slot instead of letting the version wrap around
+        if (slot.version == (VT)-1)
+            slot.nextempty = key.index;
+        else
+        {
+            if (_firstempty == (IT)-1)
+                slot.nextempty = key.index;
+            else
+                slot.nextempty = _firstempty;
+
+            _firstempty = key.index;
+        }
+    }
+
+    template <typename T, typename IT, typename VT>
+    bool DenseSlotMap<T, IT, VT>::isValid(Handle key) const
+    {
+        return key.index < _slots.size() &&
+            key.version == _slots[key.index].version &&
+            _slots[key.index].nextempty == (IT)-1;
+    }
+
+    template <typename T, typename IT, typename VT>
+    void DenseSlotMap<T, IT, VT>::clear()
+    {
+        _slots.clear();
+        _values.clear();
+        _owners.clear();
+        _firstempty = -1;
+    }
+
+    template <typename T, typename IT, typename VT>
+    IT DenseSlotMap<T, IT, VT>::size() const
+    {
+        return _values.size();
+    }
+
+    template <typename T, typename IT, typename VT>
+    bool DenseSlotMap<T, IT, VT>::empty() const
+    {
+        return _values.empty();
+    }
+
+    template <typename T, typename IT, typename VT>
+    const T* DenseSlotMap<T, IT, VT>::get(Handle key) const
+    {
+        return isValid(key) ? &_values[_slots[key.index].dense] : nullptr;
+    }
+
+    template <typename T, typename IT, typename VT>
+    T* DenseSlotMap<T, IT, VT>::get(Handle key)
+    {
+        return isValid(key) ? &_values[_slots[key.index].dense] : nullptr;
+    }
+
+    template <typename T, typename IT, typename VT>
+    const T* DenseSlotMap<T, IT, VT>::data() const
+    {
+        return _values.data();
+    }
+
+    template <typename T, typename IT, typename VT>
+    T* DenseSlotMap<T, IT, VT>::data()
+    {
+        return _values.data();
+    }
+
+    template <typename T, typename IT, typename VT>
+    typename DenseSlotMap<T, IT, VT>::Handle DenseSlotMap<T, IT, VT>::handle(IT i) const
+    {
+        assert(i < _owners.size() && "Index out of range");
+        return Handle(_owners[i], _slots[_owners[i]].version);
+    }
+
+    template <typename T, typename IT, typename VT>
+    typename DenseSlotMap<T, IT, VT>::iterator DenseSlotMap<T, IT, VT>::begin()
+    {
+        return iterator(*this, 0);
+    }
+
+    template <typename T, typename IT, typename VT>
+    typename DenseSlotMap<T, IT, VT>::const_iterator DenseSlotMap<T, IT, VT>::begin() const
+    {
+        return const_iterator(*this, 0);
+    }
+
+    template <typename T, typename IT, typename VT>
+    typename DenseSlotMap<T, IT, VT>::iterator DenseSlotMap<T, IT, VT>::end()
+    {
+        return iterator(*this, -1);
+    }
+
+    template <typename T, typename IT, typename VT>
+    typename DenseSlotMap<T, IT, VT>::const_iterator DenseSlotMap<T, IT, VT>::end() const
+    {
+        return const_iterator(*this, -1);
+    }
+
+    template <typename T, typename IT, typename VT>
+    const T& DenseSlotMap<T, IT, VT>::operator[](Handle key) const
+    {
+        assert(isValid(key) && "Key is not valid (anymore)");
+        return _values[_slots[key.index].dense];
+    }
+
+    template <typename T, typename IT, typename VT>
+    T& DenseSlotMap<T, IT, VT>::operator[](Handle key)
+    {
+        assert(isValid(key) && "Key is not valid (anymore)");
+        return _values[_slots[key.index].dense];
+    }
+
+
+    // Iterator
+
+    template <typename MapType, typename ValueType>
+    DenseSlotMapIterator<MapType, ValueType>::DenseSlotMapIterator() :
+        _index(-1),
+        _map(nullptr)
+    { };
+
+    template <typename MapType, typename ValueType>
+    DenseSlotMapIterator<MapType, ValueType>::DenseSlotMapIterator(MapType& map, IndexType i) :
+        _index(i),
+        _map(&map)
+    { };
+
+    template <typename MapType, typename ValueType>
+    DenseSlotMapIterator<MapType, ValueType>& DenseSlotMapIterator<MapType, ValueType>::operator++()
+    {
+        ++_index;
+        return *this;
+    }
+
+    template <typename MapType, typename ValueType>
+    DenseSlotMapIterator<MapType, ValueType> DenseSlotMapIterator<MapType, ValueType>::operator++(int)
+    {
+        auto tmp = *this;
+        this->operator++();
+        return tmp;
+    }
+
+    template <typename MapType, typename ValueType>
+    bool DenseSlotMapIterator<MapType, ValueType>::operator==(const type& rhs) const
+    {
+        if (_map != rhs._map)
+            return false;
+
+        // The end is evaluated lazily, so objects added while iterating are included
+        const bool atend = !_map || _index >= _map->size();
+        const bool rhsatend = !_map || rhs._index >= _map->size();
+        return atend == rhsatend && (atend || _index == rhs._index);
+    }
+
+    template <typename MapType, typename ValueType>
+    bool DenseSlotMapIterator<MapType, ValueType>::operator!=(const type& rhs) const
+    {
+        return !this->operator==(rhs);
+    }
+
+    template <typename MapType, typename ValueType>
+    ValueType& DenseSlotMapIterator<MapType, ValueType>::operator*()
+    {
+        return _map->data()[_index];
+    }
+
+    template <typename MapType, typename ValueType>
+    ValueType* DenseSlotMapIterator<MapType, ValueType>::operator->()
+    {
+        return &(this->operator*());
+    }
+
+    template <typename MapType, typename ValueType>
+    DenseSlotMapIterator<MapType, ValueType>::operator const_iterator() const
+    {
+        return _map ? const_iterator(*_map, _index) : const_iterator();
+    }
+
+    template <typename MapType, typename ValueType>
+    typename DenseSlotMapIterator<MapType, ValueType>::Handle DenseSlotMapIterator<MapType, ValueType>::handle() const
+    {
+        return _map->handle(_index);
+    }
+}
+
+#endif
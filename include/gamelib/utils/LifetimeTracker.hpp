@@ -5,7 +5,7 @@
 
 namespace gamelib
 {
-    typedef SlotKeyShort LifetimeHandle;
+    typedef HandleKey LifetimeHandle;
 
     class LifetimeTrackerManager
     {
@@ -18,7 +18,7 @@ namespace gamelib
             static auto update(LifetimeHandle handle, void* newptr) -> void;
 
         private:
-            static SlotMapShort<void*> _data;
+            static HandleSlotMap<void*> _data;
     };
 
     template <typename T>
@@ -0,0 +1,118 @@
+#ifndef GAMELIB_OBJECTPOOL_HPP
+#define GAMELIB_OBJECTPOOL_HPP
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Pool allocator for small objects that are created and destroyed often,
+ * like entities and components.
+ *
+ * Memory is handed out in size classes of `granularity` bytes, up to
+ * `max_size` bytes. New memory is taken sequentially from large chunks,
+ * so objects created in a row end up next to each other. Freed memory is
+ * put on a free list of its size class and reused by the next allocation
+ * of that class. Once the pool has grown, spawning and destroying objects
+ * doesn't touch the global allocator anymore. Chunks are only freed by
+ * release().
+ *
+ * Classes opt in using GAMELIB_POOL_ALLOCATED, which overloads operator
+ * new and delete to use allocateObject() and freeObject(). Sizes larger
+ * than max_size are forwarded to the global operator new.
+ * Objects are allocated from the global pool or, if set, the active arena.
+ * An arena is any other ObjectPool instance. It can be released at once,
+ * e.g. when a level is unloaded (see EntityManager::setLevelArena()).
+ * Memory is always returned to the pool it came from, even if its arena
+ * isn't active anymore. If an arena is destroyed while some of its objects
+ * are still alive, its chunks are handed over to the global pool.
+ *
+ * Not thread-safe, like the rest of the entity system.
+ */
+
+#define GAMELIB_POOL_ALLOCATED  \
+    static void* operator new(std::size_t size) \
+    {   \
+        return ::gamelib::ObjectPool::allocateObject(size); \
+    }   \
+    \
+    static void operator delete(void* ptr, std::size_t size)   \
+    {   \
+        ::gamelib::ObjectPool::freeObject(ptr, size);   \
+    }
+
+namespace gamelib
+{
+    class ObjectPool
+    {
+        public:
+            static constexpr size_t granularity = 16;
+            static constexpr size_t max_size = 1024;
+            static constexpr size_t chunk_size = 64 * 1024;
+
+        public:
+            ObjectPool();
+            ~ObjectPool();
+
+            ObjectPool(const ObjectPool&) = delete;
+            auto operator=(const ObjectPool&) -> ObjectPool& = delete;
+
+            // size must be in range [1, max_size]
+            auto allocate(size_t size)         -> void*;
+            auto free(void* ptr, size_t size)  -> void;
+            auto owns(const void* ptr) const   -> bool;
+
+            // Frees all chunks at once.
+            // Fails and returns false if objects are still alive.
+            auto release() -> bool;
+
+            auto size() const         -> size_t;  // Live objects
+            auto getNumChunks() const -> size_t;
+
+        public:
+            static auto allocateObject(size_t size)        -> void*;
+            static auto freeObject(void* ptr, size_t size) -> void;
+
+            static auto getGlobal() -> ObjectPool&;
+
+            // Sets the pool new objects are allocated from, nullptr for the
+            // global pool
+            static auto setArena(ObjectPool* arena) -> void;
+            static auto getArena()                  -> ObjectPool*;
+
+            // Activates an arena until the end of the scope and restores
+            // the previous one afterwards. Does nothing for nullptr.
+            class ScopedArena
+            {
+                public:
+                    explicit ScopedArena(ObjectPool* arena);
+                    ~ScopedArena();
+
+                    ScopedArena(const ScopedArena&) = delete;
+                    auto operator=(const ScopedArena&) -> ScopedArena& = delete;
+
+                private:
+                    ObjectPool* _arena;
+                    ObjectPool* _prev;
+            };
+
+        private:
+            static constexpr size_t num_classes = max_size / granularity;
+
+            struct GlobalTag {};
+            ObjectPool(GlobalTag);
+
+            auto _adopt(ObjectPool* pool) -> void;
+
+            static auto _arenas() -> std::vector<ObjectPool*>&;
+
+        private:
+            std::vector<char*> _chunks;  // sorted by address
+            void* _free[num_classes];    // free lists, the next pointer is stored in the object's memory
+            char* _cursor;               // free space in the last allocated chunk
+            char* _end;
+            size_t _size;
+            static ObjectPool* _active;
+    };
+}
+
+#endif
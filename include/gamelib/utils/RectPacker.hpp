@@ -0,0 +1,67 @@
+#ifndef GAMELIB_RECTPACKER_HPP
+#define GAMELIB_RECTPACKER_HPP
+
+#include <vector>
+#include "math/geometry/Vector.hpp"
+
+/*
+ * Packs rectangles into a fixed size area using the skyline bottom-left
+ * heuristic.
+ *
+ * The top edge of the packed rects is kept as a list of horizontal segments
+ * (the skyline). A new rect is placed on the segment where its top edge
+ * ends up lowest, so rows of similar height are filled first. Inserting
+ * rects sorted by height descending gives the best results.
+ *
+ * Space below the skyline is never reused, which is fine for sprite sheets
+ * and keeps insertion cheap.
+ *
+ * Example:
+ *     RectPacker packer(1024, 1024);
+ *     math::Vec2i pos;
+ *     if (packer.insert(32, 64, &pos))
+ *         image.copy(src, pos.x, pos.y);
+ */
+
+namespace gamelib
+{
+    class RectPacker
+    {
+        public:
+            RectPacker(int width = 0, int height = 0);
+
+            // Removes all rects and changes the size
+            auto reset(int width, int height) -> void;
+
+            // Finds a place for a w x h rect and reserves it.
+            // Returns false if it doesn't fit anymore.
+            auto insert(int w, int h, math::Vec2i* pos) -> bool;
+
+            auto getWidth() const  -> int;
+            auto getHeight() const -> int;
+
+            // Returns the size of the area actually covered by rects
+            auto getUsedSize() const -> math::Vec2i;
+
+            // Returns the ratio of covered to total area
+            auto getOccupancy() const -> float;
+
+        private:
+            struct Segment
+            {
+                int x, y, w;
+            };
+
+        private:
+            auto _fit(size_t index, int w, int h, int* y) const -> bool;
+
+        private:
+            std::vector<Segment> _skyline;
+            int _width;
+            int _height;
+            long _usedarea;
+            math::Vec2i _usedsize;
+    };
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef GAMELIB_SCRATCHBUFFER_HPP
+#define GAMELIB_SCRATCHBUFFER_HPP
+
+#include <vector>
+#include <memory>
+
+/*
+ * Provides a temporary std::vector from a thread-local pool to avoid
+ * allocations in frequently called functions.
+ * Buffers are stacked, so it's safe to create a ScratchBuffer while another
+ * one of the same type is still in use (e.g. in recursive calls or
+ * callbacks).
+ * The buffer is empty on construction and returned to the pool on
+ * destruction, keeping its capacity.
+ *
+ * Example:
+ *     ScratchBuffer<int> buf;
+ *     buf->push_back(42);
+ */
+
+namespace gamelib
+{
+    template <typename T>
+    class ScratchBuffer
+    {
+        public:
+            ScratchBuffer()
+            {
+                auto& pool = _pool();
+                size_t& depth = _depth();
+
+                // unique_ptr, so growing the pool doesn't invalidate borrowed buffers
+                if (depth == pool.size())
+                    pool.emplace_back(new std::vector<T>());
+                _buf = pool[depth++].get();
+                _buf->clear();
+            }
+
+            ~ScratchBuffer()
+            {
+                --_depth();
+            }
+
+            ScratchBuffer(const ScratchBuffer&) = delete;
+            auto operator=(const ScratchBuffer&) -> ScratchBuffer& = delete;
+
+            auto get()        -> std::vector<T>& { return *_buf; }
+            auto operator*()  -> std::vector<T>& { return *_buf; }
+            auto operator->() -> std::vector<T>* { return _buf; }
+
+        private:
+            static auto _pool() -> std::vector<std::unique_ptr<std::vector<T>>>&
+            {
+                thread_local std::vector<std::unique_ptr<std::vector<T>>> pool;
+                return pool;
+            }
+
+            static auto _depth() -> size_t&
+            {
+                thread_local size_t depth = 0;
+                return depth;
+            }
+
+        private:
+            std::vector<T>* _buf;
+    };
+}
+
+#endif
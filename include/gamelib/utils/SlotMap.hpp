@@ -54,6 +54,14 @@
  *     SlotMap<X, unsigned short, unsigned short> map;
  * This is useful to make the key smaller in exchange for less adressable
  * space.
+ *
+ * Iterating skips free slots, so it costs O(highest used slot). Use
+ * DenseSlotMap if maps are iterated often and shrink a lot.
+ *
+ * Versions never wrap around. A slot whose version reaches the maximum is
+ * retired and not reused until clear(), so stale keys never become valid
+ * again. The index -1 is reserved for null keys, so a map holds at most
+ * (IndexType)-1 slots including retired ones.
  */
 
 namespace gamelib
@@ -199,7 +207,7 @@ namespace gamelib
             auto destroy(Handle key)       -> void;
             auto isValid(Handle key) const -> bool;
             auto clear()                   -> void;
-            // auto size() const               -> unsigned int;
+            auto size() const              -> IndexType;
 
             auto get(Handle key) const -> const T*;
             auto get(Handle key)       -> T*;
@@ -214,6 +222,7 @@ namespace gamelib
 
         private:
             IndexType _firstempty;
+            IndexType _size;
             ContainerType _data;
     };
 
@@ -227,6 +236,24 @@ namespace gamelib
 
     template <typename T>
     using SlotMapDeque = SlotMap<T, unsigned int, unsigned int, slotmap_container_deque>;
+
+
+    // Key types of engine objects: entities and components (LifetimeHandle),
+    // render nodes and UpdateSystem entries.
+    // 16 bit keys limit these to 65535 live objects, so they are only used
+    // when building with GAMELIB_SHORT_HANDLES.
+#ifdef GAMELIB_SHORT_HANDLES
+    typedef unsigned short handle_index_type;
+    typedef unsigned short handle_version_type;
+#else
+    typedef unsigned int handle_index_type;
+    typedef unsigned int handle_version_type;
+#endif
+
+    using HandleKey = SlotKey<handle_index_type, handle_version_type>;
+
+    template <typename T>
+    using HandleSlotMap = SlotMap<T, handle_index_type, handle_version_type>;
 }
 
 #include "SlotMap.inl"
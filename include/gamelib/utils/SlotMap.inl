@@ -8,12 +8,14 @@ namespace gamelib
 {
     template <typename T, typename IT, typename VT, int C>
     SlotMap<T, IT, VT, C>::SlotMap() :
-        _firstempty(-1)
+        _firstempty(-1),
+        _size(0)
     { }
 
     template <typename T, typename IT, typename VT, int C>
     SlotMap<T, IT, VT, C>::SlotMap(IT size) :
-        _firstempty(-1)
+        _firstempty(-1),
+        _size(0)
     {
         ContainerHelper::reserve(_data, size);
     }
@@ -21,8 +23,10 @@ namespace gamelib
     template <typename T, typename IT, typename VT, int C>
     typename SlotMap<T, IT, VT, C>::Handle SlotMap<T, IT, VT, C>::acquire()
     {
+        ++_size;
         if (_firstempty == (IT)-1)
         {
+            assert(_data.size() < (IT)-1 && "SlotMap is full");
             _data.emplace_back();
             return Handle(_data.size() - 1, 0);
         }
@@ -44,15 +48,24 @@ namespace gamelib
     {
         if (isValid(key))
         {
-            if (_firstempty == (IT)-1)
-                _data[key.index].nextempty = key.index;
-            else
-                _data[key.index].nextempty = _firstempty;
-
-            _firstempty = key.index;
+            --_size;
             ++_data[key.index].version;
             if (!std::is_trivially_destructible<T>::value)
                 _data[key.index].data = T();
+
+            // Retire the slot instead of letting the version wrap around.
+            // Being its own successor marks it as free, but it isn't linked.
+            if (_data[key.index].version == (VT)-1)
+                _data[key.index].nextempty = key.index;
+            else
+            {
+                if (_firstempty == (IT)-1)
+                    _data[key.index].nextempty = key.index;
+                else
+                    _data[key.index].nextempty = _firstempty;
+
+                _firstempty = key.index;
+            }
         }
     }
 
@@ -69,13 +82,14 @@ namespace gamelib
     {
         _data.clear();
         _firstempty = -1;
+        _size = 0;
     }
 
-    // template <typename T, typename IT, typename VT, int C>
-    // unsigned int SlotMap<T, IT, VT, C>::size() const
-    // {
-    //     throw "Not implemented";
-    // }
+    template <typename T, typename IT, typename VT, int C>
+    IT SlotMap<T, IT, VT, C>::size() const
+    {
+        return _size;
+    }
 
     template <typename T, typename IT, typename VT, int C>
     typename SlotMap<T, IT, VT, C>::iterator SlotMap<T, IT, VT, C>::begin()
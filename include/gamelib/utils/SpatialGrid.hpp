@@ -0,0 +1,80 @@
+#ifndef GAMELIB_SPATIALGRID_HPP
+#define GAMELIB_SPATIALGRID_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "math/geometry/intersect.hpp"
+
+/*
+ * Uniform grid over bounding boxes for fast area queries.
+ *
+ * Each element is stored in every cell its bounding box touches. Cells are
+ * kept in a hash map, so the grid is unbounded and only uses memory where
+ * elements exist. Elements covering more than maxcells cells (e.g.
+ * backgrounds) are kept in a separate list that is checked by every query
+ * instead of being inserted into lots of cells.
+ *
+ * add() returns a proxy id, which is used to update or remove the element.
+ * update() only touches cells if the element moved to different cells.
+ * query() returns every matching element once, in unspecified order. It
+ * doesn't modify the grid, so it can be called from multiple threads.
+ *
+ * Example:
+ *     SpatialGrid<int> grid(128);
+ *     int proxy = grid.add(42, math::AABBf(0, 0, 10, 10));
+ *     grid.update(proxy, math::AABBf(500, 0, 10, 10));
+ *     grid.query(math::AABBf(400, -100, 200, 200), &result);
+ *     grid.remove(proxy);
+ */
+
+namespace gamelib
+{
+    template <typename T>
+    class SpatialGrid
+    {
+        public:
+            SpatialGrid(float cellsize = 128, int maxcells = 64);
+
+            auto add(const T& value, const math::AABBf& bbox) -> int;
+            auto remove(int proxy)                            -> void;
+            auto update(int proxy, const math::AABBf& bbox)   -> void;
+            auto clear()                                      -> void;
+            auto size() const                                 -> size_t;
+
+            auto get(int proxy) const     -> const T&;
+            auto getBBox(int proxy) const -> const math::AABBf&;
+
+            // Appends all elements whose bbox overlaps the given rect
+            auto query(const math::AABBf& rect, std::vector<T>* result) const -> void;
+
+        private:
+            struct Proxy
+            {
+                T value;
+                math::AABBf bbox;
+                int x0, y0, x1, y1;     // covered cells, inclusive, x0 > x1 if oversized
+                int next;               // next free proxy, -2 if used
+                int bigindex;           // index in _oversized
+            };
+
+        private:
+            auto _key(int x, int y) const -> uint64_t;
+            auto _cells(const math::AABBf& bbox, int* x0, int* y0, int* x1, int* y1) const -> bool;
+            auto _insert(int proxy) -> void;
+            auto _erase(int proxy)  -> void;
+
+        private:
+            std::vector<Proxy> _proxies;
+            std::unordered_map<uint64_t, std::vector<int>> _cellmap;
+            std::vector<int> _oversized;
+            int _freelist;
+            size_t _size;
+            float _cellsize;
+            int _maxcells;
+    };
+}
+
+#include "SpatialGrid.inl"
+
+#endif
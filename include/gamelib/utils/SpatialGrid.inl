@@ -0,0 +1,219 @@
+#ifndef GAMELIB_SPATIALGRID_INL
+#define GAMELIB_SPATIALGRID_INL
+
+#include "SpatialGrid.hpp"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+namespace gamelib
+{
+    template <typename T>
+    SpatialGrid<T>::SpatialGrid(float cellsize, int maxcells) :
+        _freelist(-1),
+        _size(0),
+        _cellsize(cellsize),
+        _maxcells(maxcells)
+    {
+        assert(cellsize > 0 && "Cell size must be positive");
+    }
+
+    template <typename T>
+    int SpatialGrid<T>::add(const T& value, const math::AABBf& bbox)
+    {
+        int proxy;
+        if (_freelist != -1)
+        {
+            proxy = _freelist;
+            _freelist = _proxies[proxy].next;
+        }
+        else
+        {
+            proxy = _proxies.size();
+            _proxies.emplace_back();
+        }
+
+        Proxy& p = _proxies[proxy];
+        p.value = value;
+        p.bbox = bbox;
+        p.next = -2;
+        _insert(proxy);
+        ++_size;
+        return proxy;
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::remove(int proxy)
+    {
+        assert(proxy >= 0 && proxy < (int)_proxies.size() && _proxies[proxy].next == -2 && "Invalid proxy");
+        _erase(proxy);
+        _proxies[proxy].value = T();
+        _proxies[proxy].next = _freelist;
+        _freelist = proxy;
+        --_size;
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::update(int proxy, const math::AABBf& bbox)
+    {
+        assert(proxy >= 0 && proxy < (int)_proxies.size() && _proxies[proxy].next == -2 && "Invalid proxy");
+
+        Proxy& p = _proxies[proxy];
+        int x0, y0, x1, y1;
+        const bool big = !_cells(bbox, &x0, &y0, &x1, &y1);
+        p.bbox = bbox;
+
+        if (big ? p.x0 > p.x1 : (x0 == p.x0 && y0 == p.y0 && x1 == p.x1 && y1 == p.y1))
+            return;
+
+        _erase(proxy);
+        _insert(proxy);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::clear()
+    {
+        _proxies.clear();
+        _cellmap.clear();
+        _oversized.clear();
+        _freelist = -1;
+        _size = 0;
+    }
+
+    template <typename T>
+    size_t SpatialGrid<T>::size() const
+    {
+        return _size;
+    }
+
+    template <typename T>
+    const T& SpatialGrid<T>::get(int proxy) const
+    {
+        return _proxies[proxy].value;
+    }
+
+    template <typename T>
+    const math::AABBf& SpatialGrid<T>::getBBox(int proxy) const
+    {
+        return _proxies[proxy].bbox;
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::query(const math::AABBf& rect, std::vector<T>* result) const
+    {
+        // Proxies are reported only from the first cell they share with
+        // the query, so no state is needed to avoid duplicates.
+        for (int i : _oversized)
+            if (math::intersect(rect, _proxies[i].bbox))
+                result->push_back(_proxies[i].value);
+
+        int x0, y0, x1, y1;
+        if (!_cells(rect, &x0, &y0, &x1, &y1) || (size_t)(x1 - x0 + 1) * (y1 - y0 + 1) > _cellmap.size())
+        {
+            // Cheaper to visit the occupied cells than all covered ones
+            for (auto& cell : _cellmap)
+            {
+                const int x = (int32_t)(cell.first >> 32),
+                          y = (int32_t)cell.first;
+
+                for (int i : cell.second)
+                {
+                    const Proxy& p = _proxies[i];
+                    if (x == p.x0 && y == p.y0 && math::intersect(rect, p.bbox))
+                        result->push_back(p.value);
+                }
+            }
+            return;
+        }
+
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+            {
+                auto it = _cellmap.find(_key(x, y));
+                if (it == _cellmap.end())
+                    continue;
+
+                for (int i : it->second)
+                {
+                    const Proxy& p = _proxies[i];
+                    if (x == std::max(p.x0, x0) && y == std::max(p.y0, y0) && math::intersect(rect, p.bbox))
+                        result->push_back(p.value);
+                }
+            }
+    }
+
+
+    template <typename T>
+    uint64_t SpatialGrid<T>::_key(int x, int y) const
+    {
+        return (uint64_t)(uint32_t)x << 32 | (uint32_t)y;
+    }
+
+    template <typename T>
+    bool SpatialGrid<T>::_cells(const math::AABBf& bbox, int* x0, int* y0, int* x1, int* y1) const
+    {
+        const float limit = 1 << 30;
+        const float fx0 = std::floor(bbox.x / _cellsize),
+                    fy0 = std::floor(bbox.y / _cellsize),
+                    fx1 = std::floor((bbox.x + bbox.w) / _cellsize),
+                    fy1 = std::floor((bbox.y + bbox.h) / _cellsize);
+
+        if (!(fx0 > -limit && fy0 > -limit && fx1 < limit && fy1 < limit))
+            return false;
+
+        *x0 = fx0;
+        *y0 = fy0;
+        *x1 = fx1;
+        *y1 = fy1;
+        return (int64_t)(*x1 - *x0 + 1) * (*y1 - *y0 + 1) <= _maxcells;
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::_insert(int proxy)
+    {
+        Proxy& p = _proxies[proxy];
+        if (!_cells(p.bbox, &p.x0, &p.y0, &p.x1, &p.y1))
+        {
+            p.x0 = 1;
+            p.x1 = 0;
+            p.bigindex = _oversized.size();
+            _oversized.push_back(proxy);
+            return;
+        }
+
+        for (int y = p.y0; y <= p.y1; ++y)
+            for (int x = p.x0; x <= p.x1; ++x)
+                _cellmap[_key(x, y)].push_back(proxy);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::_erase(int proxy)
+    {
+        Proxy& p = _proxies[proxy];
+        if (p.x0 > p.x1)
+        {
+            const int last = _oversized.back();
+            _oversized[p.bigindex] = last;
+            _proxies[last].bigindex = p.bigindex;
+            _oversized.pop_back();
+            return;
+        }
+
+        for (int y = p.y0; y <= p.y1; ++y)
+            for (int x = p.x0; x <= p.x1; ++x)
+            {
+                auto it = _cellmap.find(_key(x, y));
+                assert(it != _cellmap.end() && "Proxy missing in cell");
+
+                auto& cell = it->second;
+                auto pos = std::find(cell.begin(), cell.end(), proxy);
+                *pos = cell.back();
+                cell.pop_back();
+
+                if (cell.empty())
+                    _cellmap.erase(it);
+            }
+    }
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef GAMELIB_THREADPOOL_HPP
+#define GAMELIB_THREADPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+/*
+ * Simple work-stealing thread pool for parallel loops.
+ *
+ * run() distributes the given amount of tasks over the workers' queues and
+ * blocks until all of them are finished. The calling thread participates as
+ * an additional worker. Workers take tasks from the back of their own queue
+ * and steal from the front of other queues when they run out of work, so
+ * tasks of different sizes are balanced automatically.
+ *
+ * The order in which tasks are executed is unspecified. Callers that need
+ * deterministic results have to make sure tasks don't depend on each other.
+ * run() must not be called from inside a task.
+ *
+ * Example:
+ *     ThreadPool pool;
+ *     pool.run(data.size(), [&](size_t i) { process(data[i]); });
+ */
+
+namespace gamelib
+{
+    class ThreadPool
+    {
+        public:
+            // Signature: void(void* me, size_t task)
+            typedef void (*TaskCallback)(void*, size_t);
+
+        public:
+            // Uses one thread less than the available hardware threads by
+            // default, because the calling thread works, too.
+            ThreadPool(size_t numthreads = getDefaultThreads());
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+            auto run(size_t numtasks, TaskCallback callback, void* me) -> void;
+
+            // Signature: void(size_t task)
+            template <typename F>
+            auto run(size_t numtasks, F f) -> void;
+
+            // Returns the number of worker threads, excluding the caller
+            auto getNumThreads() const -> size_t;
+
+            static auto getDefaultThreads() -> size_t;
+
+        private:
+            struct Queue
+            {
+                std::mutex lock;
+                std::deque<size_t> tasks;
+            };
+
+        private:
+            auto _loop(size_t index) -> void;
+            auto _work(size_t index) -> void;
+            auto _pop(size_t index, size_t* task) -> bool;
+
+        private:
+            std::vector<std::thread> _threads;
+            std::unique_ptr<Queue[]> _queues;   // index 0 belongs to the caller
+            std::mutex _lock;
+            std::condition_variable _wakeup;
+            std::condition_variable _done;
+            TaskCallback _callback;
+            void* _me;
+            std::atomic<size_t> _remaining;
+            size_t _generation;
+            size_t _active;
+            bool _quit;
+    };
+
+    template <typename F>
+    void ThreadPool::run(size_t numtasks, F f)
+    {
+        run(numtasks, [](void* me, size_t task) {
+                (*static_cast<F*>(me))(task);
+            }, &f);
+    }
+}
+
+#endif
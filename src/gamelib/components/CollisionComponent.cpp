@@ -6,6 +6,7 @@ namespace gamelib
     CollisionComponent::CollisionComponent()
     {
         _props.registerProperty("flags", flags, 0, num_colflags, str_colflags);
+        _props.registerProperty("layer", _layername, PROP_METHOD(_layername, setLayerName), this);
     }
 
     CollisionComponent::~CollisionComponent()
@@ -19,6 +20,7 @@ namespace gamelib
         if (!sys)
             return false;
 
+        _updateLayer(sys);
         sys->add(this);
         return true;
     }
@@ -37,4 +39,27 @@ namespace gamelib
     {
         return this;
     }
+
+    void CollisionComponent::setLayerName(const std::string& name)
+    {
+        _layername = name;
+        if (isInitialized())
+            _updateLayer(getSubsystem<CollisionSystem>());
+    }
+
+    const std::string& CollisionComponent::getLayerName() const
+    {
+        return _layername;
+    }
+
+    void CollisionComponent::_updateLayer(CollisionSystem* sys)
+    {
+        int layer = _layername.empty() ? 0 : sys->findLayer(_layername);
+        if (layer == collision_nolayer)
+        {
+            LOG_WARN("Unknown collision layer: ", _layername, " -> using default layer");
+            layer = 0;
+        }
+        setLayer(layer);
+    }
 }
@@ -51,4 +51,9 @@ namespace gamelib
     {
         return _hook;
     }
+
+    UpdateScheduler* UpdateComponent::getScheduler() const
+    {
+        return nullptr;
+    }
 }
@@ -5,17 +5,24 @@
 namespace gamelib
 {
     AABBMask::AABBMask(unsigned int flags_) :
-        _comp(nullptr)
+        _comp(nullptr),
+        _target(nullptr)
     {
         flags = flags_;
         _setSupportedOps(false, false, false);
         registerProperty(_props, "component", _comp, *this, PROP_METHOD(_comp, setComponent));
     }
 
+    AABBMask::~AABBMask()
+    {
+        if (_target)
+            _target->removeDependent(this);
+    }
+
 
     math::AABBf AABBMask::getBBox() const
     {
-        return _comp->getTransform()->getBBox();
+        return _target ? _target->getBBox() : math::AABBf();
     }
 
     bool AABBMask::intersect(const math::Point2f& point) const
@@ -45,16 +52,33 @@ namespace gamelib
             LOG_ERROR("Can't assign self");
             return false;
         }
-        else if (c->getTransform())
-        {
-            _comp = c;
-            return true;
-        }
-        else
+        else if (c && !c->getTransform())
         {
             LOG_ERROR("Component is not a Transformable");
             return false;
         }
+
+        if (_target)
+            _target->removeDependent(this);
+
+        _comp = c;
+        _target = c ? c->getTransform() : nullptr;
+
+        if (_target)
+            _target->addDependent(this);
+
+        _markDirty();
+        return true;
+    }
+
+    void AABBMask::_onSourceDestroyed(const Transformable* src)
+    {
+        if (src != _target)
+            return;
+
+        _comp.reset();
+        _target = nullptr;
+        _markDirty();
     }
 
     BaseCompRef AABBMask::getComponent() const
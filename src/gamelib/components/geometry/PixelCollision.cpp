@@ -1,11 +1,16 @@
 #include "gamelib/components/geometry/PixelCollision.hpp"
+#include "gamelib/core/geometry/Broadphase.hpp"
 #include "gamelib/core/res/ResourceManager.hpp"
 #include "gamelib/utils/conversions.hpp"
 #include "math/geometry/intersect.hpp"
 #include "gamelib/utils/utils.hpp"
+#include <cmath>
 
 namespace gamelib
 {
+    constexpr float pixel_minstep = 0.5;    // Minimum step size when marching, in pixels
+    constexpr int pixel_refinesteps = 8;    // Bisection steps after a hit
+
     PixelCollision::PixelCollision() :
         PixelCollision(0, 0, 0, 0, 0)
     { }
@@ -24,126 +29,141 @@ namespace gamelib
 
     bool PixelCollision::intersect(const math::Point2f& point) const
     {
-        if (math::intersect(_rect, point))
-            return _img.getPixel(point.x - _rect.x, point.y - _rect.y).a != 0;
+        if (_pixels && math::intersect(_rect, point))
+            return _pixels->mask.test(std::floor(point.x - _rect.x), std::floor(point.y - _rect.y));
         return false;
     }
 
     Intersection PixelCollision::intersect(const math::Line2f& line) const
     {
-        // TODO: untested
-
-        auto dir = line.d.normalized();
-        auto len = line.d.abs();
-        auto isec = math::intersect(line, _rect);
-
-        if (!isec)
+        if (!_pixels)
             return Intersection();
 
-        auto sign = math::sign(isec.time);
-        for (int i = isec.time * len + sign; true; i += sign)
+        float tmin, tmax;
+        if (line.type == math::Segment)
         {
-            auto p = isec.p + dir * i;
-
-            if (!math::intersect(_rect, p))
+            if (!sweepTime(math::AABBf(line.p.x, line.p.y, 0, 0), line.d, _rect, 1, &tmin))
                 return Intersection();
-            else if (intersect(p))
-                return Intersection(p, math::Vec2f(i / len, i / len), getNormal(p));
+            tmax = 1;
         }
+        else
+        {
+            auto isec = math::intersect(line, _rect);
+            if (!isec)
+                return Intersection();
+            tmin = isec.near;
+            tmax = isec.far;
+        }
+
+        float time;
+        if (!_march(math::AABBf(line.p.x, line.p.y, 0, 0), line.d, tmin, tmax, &time))
+            return Intersection();
+
+        const math::Point2f p(line.p.x + line.d.x * time, line.p.y + line.d.y * time);
+        return Intersection(p, math::Vec2f(time, time), getNormal(p));
     }
 
     Intersection PixelCollision::intersect(const math::AABBf& rect) const
     {
-        auto isec = math::intersect(rect, _rect);
-        if (isec)
-        {
-            // TODO: check only difference
-
-            for (int y = rect.y + rect.h - 1; y >= rect.y; --y)
-                for (int x = rect.x; x < rect.x + rect.w; ++x)
-                    if (intersect(math::Point2f(x, y)))
-                    {
-                        return math::Intersection<float>(
-                                math::Vec2f((rect.x + rect.w) - x, (rect.y + rect.h) - y),
-                                math::Vec2f());
-                    }
-
-            // for (int y : { rect.y + rect.h, rect.y })
-            //     for (int x = rect.x; x < rect.x + rect.h; ++x)
-            //         if (intersect(x, y))
-            //             return true;
-            //
-            // for (int x : { rect.x, rect.x + rect.h })
-            //     for (int y = rect.y; y < rect.y + rect.h; ++y)
-            //         if (intersect(x, y))
-            //             return true;
-        }
-        return math::Intersection<float>();
-    }
+        math::Vec2i pixel;
+        if (!_findPixel(rect, &pixel))
+            return math::Intersection<float>();
 
+        return math::Intersection<float>(
+                math::Vec2f((rect.x + rect.w) - (_rect.x + pixel.x), (rect.y + rect.h) - (_rect.y + pixel.y)),
+                math::Vec2f());
+    }
 
     Intersection PixelCollision::sweep(const math::AABBf& rect, const math::Vec2f& vel) const
     {
-        math::AABBf rect2(rect.pos.asPoint() + vel, rect.size);
-        auto dir = vel.normalized();
-        float len = vel.abs();
-        int time = ceil(len);
+        float entry, time;
+        if (!_pixels || !sweepTime(rect, vel, _rect, 1, &entry) || !_march(rect, vel, entry, 1, &time))
+            return math::Intersection<float>();
 
-        auto isec = math::intersect(math::Line2f(rect.getCenter(), vel, math::Segment), _rect);
-        if (isec)
-        {
-            for (int i = isec.time * len; i < len; ++i)
-            {
-                auto p = isec.p + dir * i;
-                if (intersect(p))
-                {
-                    time = i;
-                    rect2.center(p);
-                    break;
-                }
-            }
-        }
+        const math::AABBf box(rect.x + vel.x * time, rect.y + vel.y * time, rect.w, rect.h);
+        const math::Point2f center = box.getCenter();
+        return math::Intersection<float>(center, math::Vec2f(time, time), getNormal(center));
+    }
 
-        auto rectisec = intersect(rect2);
-        if (rectisec)
-        {
-            math::Vec2f cp = rect2.pos;
-            while (rectisec)
-            {
-                cp = rect2.pos + (rect2.size - rectisec.delta);
-                rect2.pos -= dir;
-                --time;
-                rectisec = intersect(rect2);
-            }
 
-            return math::Intersection<float>(
-                    rect2.getCenter(),
-                    math::Vec2f(time / len, time / len),
-                    getNormal(cp.x, cp.y)); // normal seems to bug out sometimes
-        }
+    math::Vec2f PixelCollision::getNormal(float x, float y) const
+    {
+        if (!_pixels)
+            return math::Vec2f();
+        return _pixels->mask.getNormal(x - _rect.x, y - _rect.y);
+    }
 
-        return math::Intersection<float>();
+    math::Vec2f PixelCollision::getNormal(const math::Point2f& p) const
+    {
+        return getNormal(p.x, p.y);
     }
 
 
-    math::Vec2f PixelCollision::getNormal(float x, float y) const
+    bool PixelCollision::_findPixel(const math::AABBf& rect, math::Vec2i* pixel) const
     {
-        constexpr int radius = 5;
+        if (!_pixels)
+            return false;
 
-        math::Vec2f avg;
-        for (int w = -radius; w <= radius; ++w)
-            for (int h = -radius; h <= radius; ++h)
-                if (intersect(math::Point2f(x + w, y + h)))
-                    avg -= math::Vec2f(w, h);
+        // All pixels overlapping the rect, but at least one
+        const float x = rect.x - _rect.x,
+                    y = rect.y - _rect.y;
+        const int x0 = std::floor(x),
+                  y0 = std::floor(y),
+                  x1 = std::max<int>(std::ceil(x + rect.w), x0 + 1),
+                  y1 = std::max<int>(std::ceil(y + rect.h), y0 + 1);
 
-        if (avg.x != 0 || avg.y != 0)
-            return avg.normalized();
-        return avg;
+        return _pixels->mask.findRect(x0, y0, x1, y1, pixel);
     }
 
-    math::Vec2f PixelCollision::getNormal(const math::Point2f& p) const
+    bool PixelCollision::_march(const math::AABBf& rect, const math::Vec2f& vel,
+            float tmin, float tmax, float* time) const
     {
-        return getNormal(p.x, p.y);
+        const float len = vel.abs();
+
+        // The distance field is sampled at the pixel containing the rect's
+        // center. Subtract the maximum distance from there to the rect's
+        // corners and from pixel centers to pixel edges.
+        const float radius = std::sqrt(rect.w * rect.w + rect.h * rect.h) / 2 + std::sqrt(2.f);
+
+        math::Vec2i pixel;
+        float t = tmin;
+        float free = tmin;
+
+        while (true)
+        {
+            const math::AABBf box(rect.x + vel.x * t, rect.y + vel.y * t, rect.w, rect.h);
+
+            if (_findPixel(box, &pixel))
+            {
+                if (t == tmin)
+                {
+                    *time = tmin;
+                    return true;
+                }
+
+                float hit = t;
+                for (int i = 0; i < pixel_refinesteps; ++i)
+                {
+                    const float mid = (free + hit) / 2;
+                    if (_findPixel(math::AABBf(rect.x + vel.x * mid, rect.y + vel.y * mid, rect.w, rect.h), &pixel))
+                        hit = mid;
+                    else
+                        free = mid;
+                }
+
+                *time = free;
+                return true;
+            }
+
+            if (t >= tmax || len == 0)
+                return false;
+
+            free = t;
+            const int cx = std::floor(box.x + box.w / 2 - _rect.x),
+                      cy = std::floor(box.y + box.h / 2 - _rect.y);
+            const float dist = _pixels->mask.getDistance(cx, cy) - radius;
+            t = std::min(tmax, t + std::max(dist, pixel_minstep) / len);
+        }
     }
 
 
@@ -162,9 +182,7 @@ namespace gamelib
     {
         CollisionComponent::loadFromJson(node);
 
-        if (node.isMember("texture"))
-            return loadImageFromFile(node["texture"].asString());
-
+        // Needs to be known before the image is loaded
         if (node.isMember("mask"))
         {
             auto& mask = node["mask"];
@@ -176,6 +194,9 @@ namespace gamelib
         else
             _mask = sf::Color::Transparent;
 
+        if (node.isMember("texture"))
+            return loadImageFromFile(node["texture"].asString());
+
         return true;
     }
 
@@ -200,57 +221,77 @@ namespace gamelib
         auto resmgr = getSubsystem<ResourceManager>();
         if (resmgr)
         {
-            auto tex = resmgr->get(fname);
-            if (tex)
+            auto res = resmgr->get(fname);
+            if (res)
             {
-                loadImageFromTexture(*tex.as<TextureResource>());
+                if (res.getResource()->getID() == CollisionMaskResource::id)
+                {
+                    auto mask = res.as<CollisionMaskResource>();
+                    _mask = mask->color;
+                    setCollisionMask(mask);
+                }
+                else
+                    loadImageFromTexture(res.as<TextureResource>());
                 _texname = fname;
                 return true;
             }
         }
 
         // Fall back to normal loading
-        if (!_img.loadFromFile(fname))
+        sf::Image img;
+        if (!img.loadFromFile(fname))
             return false;
 
-        _img.createMaskFromColor(_mask);
+        loadImage(img);
         _texname = fname;
-        _rect.size.fill(_img.getSize().x, _img.getSize().y);
-        _markDirty();
-
         return true;
     }
 
+    void PixelCollision::loadImage(const sf::Image& img)
+    {
+        setCollisionMask(createCollisionMask(img, _mask));
+        _texname.clear();
+    }
+
     void PixelCollision::loadImageFromTexture(const sf::Texture& tex)
     {
-        _img = tex.copyToImage();
-        _img.createMaskFromColor(_mask);
-        _rect.size.fill(_img.getSize().x, _img.getSize().y);
-        _markDirty();
+        loadImage(tex.copyToImage());
     }
 
     void PixelCollision::loadImageFromTexture(TextureResource::Handle tex)
     {
         if (tex)
         {
-            loadImageFromTexture(*tex);
+            setCollisionMask(getCollisionMask(tex, _mask));
             _texname = tex.getResource()->getPath();
         }
     }
 
-    const sf::Image& PixelCollision::getImage() const
+    void PixelCollision::setCollisionMask(CollisionMaskResource::Handle mask)
     {
-        return _img;
+        _pixels = mask;
+        _texname.clear();
+        if (_pixels)
+            _rect.size.fill(_pixels->mask.getWidth(), _pixels->mask.getHeight());
+        else
+            _rect.size.fill(0);
+        _markDirty();
     }
 
-    sf::Image& PixelCollision::getImage()
+    const PixelMask* PixelCollision::getMask() const
     {
-        return _img;
+        return _pixels ? &_pixels->mask : nullptr;
     }
 
     void PixelCollision::setMaskColor(sf::Color mask)
     {
+        if (mask == _mask)
+            return;
+
         _mask = mask;
-        _img.createMaskFromColor(mask);
+        if (_pixels && _pixels->tex)
+            loadImageFromTexture(_pixels->tex);
+        else if (!_texname.empty())
+            loadImageFromFile(_texname);
     }
 }
@@ -94,6 +94,7 @@ namespace gamelib
                 else
                     LOG_WARN("Incorrect vertex format: ", node.toStyledString());
             }
+            _markDirty();
         }
         return true;
     }
@@ -0,0 +1,172 @@
+#include "gamelib/components/update/PhysicsScheduler.hpp"
+#include "gamelib/components/update/QPhysics.hpp"
+#include "gamelib/components/CollisionComponent.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+#include "gamelib/core/ecs/Entity.hpp"
+#include <algorithm>
+
+namespace gamelib
+{
+    inline math::AABBf expand(const math::AABBf& box, float dist)
+    {
+        return math::AABBf(box.x - dist, box.y - dist, box.w + 2 * dist, box.h + 2 * dist);
+    }
+
+
+    PhysicsScheduler::PhysicsScheduler(size_t numthreads) :
+        _numthreads(numthreads)
+    { }
+
+    void PhysicsScheduler::update(UpdateComponent* const* objs, const float* elapsed, size_t num)
+    {
+        if (_numthreads == 0)
+        {
+            for (size_t i = 0; i < num; ++i)
+                objs[i]->update(elapsed[i]);
+            return;
+        }
+
+        _actors.clear();
+        _volumes.clear();
+        _lookup.clear();
+
+        // Only QPhysics components return this scheduler
+        for (size_t i = 0; i < num; ++i)
+            _add(static_cast<QPhysics*>(objs[i]), elapsed[i], true);
+
+        // Reserve before linking, so linking sees the same proxies as the
+        // queries during the update
+        auto colsys = getSubsystem<CollisionSystem>();
+        for (auto& vol : _volumes)
+            colsys->reserve(vol.col, vol.area);
+
+        _link();
+        _buildIslands();
+
+        if (_islands.size() < 2)
+        {
+            for (size_t i = 0; i < num; ++i)
+                objs[i]->update(elapsed[i]);
+            return;
+        }
+
+        if (!_pool)
+            _pool.reset(new ThreadPool(_numthreads));
+
+        colsys->beginDeferredRefit();
+        _pool->run(_islands.size(), [this](size_t index) {
+                const Island& island = _islands[index];
+                for (size_t i = island.begin; i < island.end; ++i)
+                {
+                    const Actor& actor = _actors[_members[i]];
+                    if (actor.scheduled)
+                        actor.phys->update(actor.elapsed);
+                }
+            });
+        colsys->endDeferredRefit();
+    }
+
+    size_t PhysicsScheduler::getNumIslands() const
+    {
+        return _islands.size();
+    }
+
+
+    size_t PhysicsScheduler::_add(QPhysics* phys, float elapsed, bool scheduled)
+    {
+        auto it = _lookup.find(phys);
+        if (it != _lookup.end())
+            return it->second;
+
+        Actor actor;
+        actor.phys = phys;
+        actor.elapsed = elapsed;
+        actor.parent = _actors.size();
+        actor.scheduled = scheduled;
+
+        _lookup[phys] = _actors.size();
+        _actors.push_back(actor);
+
+        // Objects without hull don't move, linked objects aren't updated.
+        // All colliders of the entity move along with the hull.
+        if (scheduled && phys->_hull)
+        {
+            const float reach = phys->getReach(elapsed);
+            phys->getEntity()->findAllByType<CollisionComponent>(
+                    [&](ComponentReference<CollisionComponent> comp) {
+                        _volumes.push_back({ actor.parent, comp.get(), expand(comp->getBBox(), reach) });
+                        return false;
+                    });
+        }
+
+        return actor.parent;
+    }
+
+    size_t PhysicsScheduler::_find(size_t actor)
+    {
+        while (_actors[actor].parent != actor)
+        {
+            _actors[actor].parent = _actors[_actors[actor].parent].parent;
+            actor = _actors[actor].parent;
+        }
+        return actor;
+    }
+
+    void PhysicsScheduler::_unite(size_t a, size_t b)
+    {
+        a = _find(a);
+        b = _find(b);
+        if (a < b)
+            _actors[b].parent = a;
+        else if (b < a)
+            _actors[a].parent = b;
+    }
+
+    void PhysicsScheduler::_link()
+    {
+        auto colsys = getSubsystem<CollisionSystem>();
+
+        // Link objects to the physics objects of all proxies their colliders
+        // might touch. This includes the reserved areas of other objects.
+        // Linked objects are appended, but don't add volumes.
+        for (size_t i = 0; i < _volumes.size(); ++i)
+        {
+            const size_t actor = _volumes[i].actor;
+            colsys->queryProxies(_volumes[i].area, [&](Collidable* col) {
+                    // Objects in the CollisionSystem are always CollisionComponents
+                    auto ent = static_cast<CollisionComponent*>(col)->getEntity();
+                    auto other = ent ? ent->findByName<QPhysics>().get() : nullptr;
+                    if (other && other != _actors[actor].phys)
+                        _unite(actor, _add(other, 0, false));
+                    return false;
+                });
+        }
+    }
+
+    void PhysicsScheduler::_buildIslands()
+    {
+        _members.clear();
+        _islands.clear();
+
+        for (size_t i = 0; i < _actors.size(); ++i)
+            _members.push_back(i);
+
+        // Group by root, keep the update order inside islands
+        std::sort(_members.begin(), _members.end(), [this](size_t a, size_t b) {
+                const size_t roota = _find(a), rootb = _find(b);
+                return roota < rootb || (roota == rootb && a < b);
+            });
+
+        for (size_t i = 0; i < _members.size(); ++i)
+        {
+            if (i == 0 || _find(_members[i]) != _find(_members[i - 1]))
+                _islands.push_back({ i, i });
+            _islands.back().end = i + 1;
+        }
+
+        // Start big islands first for better load balancing
+        std::stable_sort(_islands.begin(), _islands.end(), [](const Island& a, const Island& b) {
+                return a.end - a.begin > b.end - b.begin;
+            });
+    }
+}
@@ -1,4 +1,5 @@
 #include "gamelib/components/update/QPhysics.hpp"
+#include "gamelib/components/update/PhysicsScheduler.hpp"
 #include "gamelib/components/geometry/AABB.hpp"
 #include "gamelib/core/geometry/CollisionSystem.hpp"
 #include "gamelib/core/geometry/flags.hpp"
@@ -18,6 +19,7 @@ namespace gamelib
     float QPhysics::friction = 10;
     float QPhysics::stopFriction = 10;
     float QPhysics::stopSpeed = 70;
+    bool QPhysics::parallel = false;
 
 
     math::Vec2f& subclamp(math::Vec2f* vec, const math::Vec2f& other)
@@ -36,6 +38,7 @@ namespace gamelib
         _props.registerProperty("friction", QPhysics::friction);
         _props.registerProperty("stopFriction", QPhysics::stopFriction);
         _props.registerProperty("stopSpeed", QPhysics::stopSpeed);
+        _props.registerProperty("parallel", QPhysics::parallel);
     }
 
 
@@ -125,7 +128,7 @@ namespace gamelib
                 break;
 
             auto framevel = vel * timeleft;
-            TraceResult trace = colsys->trace(box, framevel, tracecb, _hull, collision_solid | collision_physicsdrag);
+            TraceResult trace = colsys->trace(box, framevel, tracecb, _hull, collision_solid | collision_physicsdrag, TraceNearest);
 
             { // Move objects, flagged to be moved on collision, by current speed
                 for (auto& i : collisions)
@@ -340,6 +343,23 @@ namespace gamelib
         return getSubsystem<CollisionSystem>()->intersect(box, _hull, collision_solid);
     }
 
+    UpdateScheduler* QPhysics::getScheduler() const
+    {
+        return parallel ? getSubsystem<PhysicsScheduler>() : nullptr;
+    }
+
+    float QPhysics::getReach(float elapsed) const
+    {
+        // Gravity can only increase the speed by this amount in one frame
+        float speed = (vel + basevel).abs() + gravity * std::abs(gravMultiplier) * gravityDirection.abs() * elapsed;
+
+        // Moving ground is snapped to before and after moving, ground
+        // snapping and nudging add a bit more.
+        float snap = 2 * movingPlatformSnapDist * gravityDirection.abs() + snapDist + 1;
+
+        return speed * elapsed * std::max(overbounce, 1.f) + snap;
+    }
+
     math::AABBf QPhysics::getHull() const
     {
         return _hull->getBBox();
@@ -408,21 +428,29 @@ namespace gamelib
 
     bool QPhysics::_nudge(math::AABBf* box, float size)
     {
+        // Test all nudge directions at once
+        IntersectQuery queries[9];
+        Collidable* results[9];
+        for (int i = 0; i < 9; ++i)
+        {
+            queries[i] = { *box, _hull, collision_solid };
+            queries[i].rect.pos += math::Vec2f(i % 3 - 1, i / 3 - 1) * size;
+        }
+        getSubsystem<CollisionSystem>()->intersectBatch(queries, 9, results);
+
         math::Vec2f alt;
         for (int y : { -1, 0, 1 })
         {
             for (int x : { -1, 0, 1 })
             {
                 auto offset = math::Vec2f(x, y) * size;
-                math::AABBf newbox(*box);
-                newbox.pos += offset;
-                if (!isStuck(newbox))
+                if (!results[(y + 1) * 3 + x + 1])
                 {
                     // Prioritize nudges along x or y axis over diagonals
                     if (x == 0 ^ y == 0)
                     {
                         // LOG_DEBUG("nudged by x: ", offset.x, " y: ", offset.y);
-                        box->pos = newbox.pos;
+                        box->pos += offset;
                         return true;
                     }
                     else
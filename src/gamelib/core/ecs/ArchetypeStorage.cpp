@@ -0,0 +1,189 @@
+#include "gamelib/core/ecs/ArchetypeStorage.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace gamelib
+{
+    constexpr size_t no_archetype = -1;
+
+    ArchetypeStorage::ArchetypeStorage() :
+        _size(0)
+    { }
+
+    ArchetypeStorage::~ArchetypeStorage()
+    {
+        clear();
+    }
+
+    void ArchetypeStorage::add(Entity* ent)
+    {
+        if (!ent)
+            return;
+
+        if (ent->_storage != this)
+        {
+            if (ent->_storage)
+                ent->_storage->remove(ent);
+
+            ent->_storage = this;
+            ent->_archetype = no_archetype;
+            ++_size;
+        }
+
+        _update(ent);
+    }
+
+    void ArchetypeStorage::addSubtree(Entity* ent)
+    {
+        if (!ent)
+            return;
+
+        ent->iterSubtree([this](Entity* child) {
+                add(child);
+                return false;
+            });
+    }
+
+    void ArchetypeStorage::remove(Entity* ent)
+    {
+        if (!ent || ent->_storage != this)
+            return;
+
+        _removeRow(ent);
+        ent->_storage = nullptr;
+        --_size;
+    }
+
+    void ArchetypeStorage::clear()
+    {
+        for (auto& arch : _archetypes)
+            for (auto ent : arch.entities)
+            {
+                ent->_storage = nullptr;
+                ent->_archetype = no_archetype;
+            }
+
+        _archetypes.clear();
+        _lookup.clear();
+        _size = 0;
+    }
+
+    size_t ArchetypeStorage::size() const
+    {
+        return _size;
+    }
+
+    auto ArchetypeStorage::getArchetypes() const -> const std::vector<Archetype>&
+    {
+        return _archetypes;
+    }
+
+    auto ArchetypeStorage::getArena(TypeIndex type) -> ObjectPool*
+    {
+        assert(type != invalidTypeIndex && "Invalid type index");
+
+        if (type >= _arenas.size())
+            _arenas.resize(type + 1);
+
+        if (!_arenas[type])
+            _arenas[type].reset(new ObjectPool());
+
+        return _arenas[type].get();
+    }
+
+    auto ArchetypeStorage::findArena(TypeIndex type) -> ObjectPool*
+    {
+        auto storage = findActive();
+        if (!storage || ObjectPool::getArena() || type == invalidTypeIndex)
+            return nullptr;
+        return storage->getArena(type);
+    }
+
+    void ArchetypeStorage::_update(Entity* ent)
+    {
+        _signature.clear();
+        for (auto& i : *ent)
+            if (i.ptr)
+                _signature.push_back(i.type);
+
+        std::sort(_signature.begin(), _signature.end());
+        _signature.erase(std::unique(_signature.begin(), _signature.end()), _signature.end());
+
+        // Move to the new archetype, if it changed
+        if (ent->_archetype == no_archetype || _archetypes[ent->_archetype].types != _signature)
+        {
+            _removeRow(ent);
+
+            ent->_archetype = _findArchetype(std::vector<TypeIndex>(_signature));
+            Archetype& arch = _archetypes[ent->_archetype];
+            ent->_archetyperow = arch.entities.size();
+            arch.entities.push_back(ent);
+            for (auto& col : arch.columns)
+                col.push_back(nullptr);
+        }
+
+        // (Re)fill the row, the first component of each type wins
+        Archetype& arch = _archetypes[ent->_archetype];
+        const size_t row = ent->_archetyperow;
+
+        for (auto& col : arch.columns)
+            col[row] = nullptr;
+
+        for (auto& i : *ent)
+        {
+            if (!i.ptr)
+                continue;
+
+            auto& cell = arch.columns[_findColumn(arch, i.type)][row];
+            if (!cell)
+                cell = i.ptr.get();
+        }
+    }
+
+    void ArchetypeStorage::_removeRow(Entity* ent)
+    {
+        if (ent->_archetype == no_archetype)
+            return;
+
+        Archetype& arch = _archetypes[ent->_archetype];
+        const size_t row = ent->_archetyperow;
+        const size_t last = arch.entities.size() - 1;
+
+        // Swap-remove, the last entity takes the row
+        if (row != last)
+        {
+            arch.entities[row] = arch.entities[last];
+            arch.entities[row]->_archetyperow = row;
+            for (auto& col : arch.columns)
+                col[row] = col[last];
+        }
+
+        arch.entities.pop_back();
+        for (auto& col : arch.columns)
+            col.pop_back();
+
+        ent->_archetype = no_archetype;
+    }
+
+    size_t ArchetypeStorage::_findArchetype(std::vector<TypeIndex>&& types)
+    {
+        auto it = _lookup.find(types);
+        if (it != _lookup.end())
+            return it->second;
+
+        Archetype arch;
+        arch.columns.resize(types.size());
+        arch.types = std::move(types);
+        _lookup[arch.types] = _archetypes.size();
+        _archetypes.push_back(std::move(arch));
+        return _archetypes.size() - 1;
+    }
+
+    size_t ArchetypeStorage::_findColumn(const Archetype& arch, TypeIndex type)
+    {
+        auto it = std::lower_bound(arch.types.begin(), arch.types.end(), type);
+        if (it == arch.types.end() || *it != type)
+            return no_archetype;
+        return it - arch.types.begin();
+    }
+}
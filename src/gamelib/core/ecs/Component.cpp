@@ -1,9 +1,41 @@
 #include "gamelib/core/ecs/Component.hpp"
 #include "gamelib/json/json-transformable.hpp"
 #include "gamelib/properties/PropDummy.hpp"
+#include <unordered_map>
+#include <mutex>
 
 namespace gamelib
 {
+    // Function-local statics, because indices might be requested during
+    // static initialization
+    static auto typeRegistry() -> std::unordered_map<std::string, TypeIndex>&
+    {
+        static std::unordered_map<std::string, TypeIndex> types;
+        return types;
+    }
+
+    static auto typeMutex() -> std::mutex&
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    auto getTypeIndex(const std::string& name) -> TypeIndex
+    {
+        std::lock_guard<std::mutex> lock(typeMutex());
+        auto& types = typeRegistry();
+        return types.emplace(name, types.size()).first->second;
+    }
+
+    auto findTypeIndex(const std::string& name) -> TypeIndex
+    {
+        std::lock_guard<std::mutex> lock(typeMutex());
+        auto& types = typeRegistry();
+        auto it = types.find(name);
+        return it == types.end() ? invalidTypeIndex : it->second;
+    }
+
+
     Component::Component() :
         _initialized(false)
     {
@@ -1,7 +1,9 @@
 #include "gamelib/core/ecs/Entity.hpp"
 #include "gamelib/core/ecs/Component.hpp"
+#include "gamelib/core/ecs/ArchetypeStorage.hpp"
 #include "gamelib/utils/log.hpp"
 #include <cassert>
+#include <algorithm>
 
 namespace gamelib
 {
@@ -13,12 +15,17 @@ namespace gamelib
         flags(0),
         _name(name),
         _clearing(false),
-        _parent(nullptr)
+        _parent(nullptr),
+        _storage(nullptr),
+        _archetype(-1),
+        _archetyperow(0)
     { }
 
     Entity::~Entity()
     {
         _quit();
+        if (_storage)
+            _storage->remove(this);
         LOG_DEBUG("Entity destroyed: ", getName());
     }
 
@@ -178,14 +185,23 @@ namespace gamelib
             getTransform().add(comp->getTransform());
 
         // Find highest id of these component types
+        const TypeIndex type = getTypeIndex(comp->getName());
         unsigned int id = 0;
         for (auto& i : _components)
-            if (i.ptr->getName() == comp->getName())
+            if (i.type == type)
                 id = std::max(id, i.id);
         ++id;
 
         auto ptr = comp.get();
-        _components.push_back({ id, std::move(comp) });
+        _components.push_back({ id, type, std::move(comp) });
+
+        assert(_components.size() < (unsigned short)-1 && "Too many components");
+        if (type >= _typeslots.size())
+            _typeslots.resize(type + 1, 0);
+        if (!_typeslots[type])
+            _typeslots[type] = _components.size();
+
+        _updateArchetype(true);
         _refresh(ComponentAdded, ptr);
         return ptr;
     }
@@ -204,7 +220,11 @@ namespace gamelib
                 it->ptr.reset();
 
                 if (!_clearing)
+                {
                     _components.erase(it);
+                    _updateTypeSlots();
+                    _updateArchetype(false);
+                }
                 return;
             }
     }
@@ -221,7 +241,17 @@ namespace gamelib
 
     BaseCompRef Entity::find(const std::string& name) const
     {
-        return findAll(name, [](BaseCompRef) { return true; });
+        const size_t i = _findFirst(findTypeIndex(name));
+        return i < _components.size() ? _components[i].ptr.get() : nullptr;
+    }
+
+    BaseCompRef Entity::find(const std::string& name, unsigned int id) const
+    {
+        const TypeIndex type = findTypeIndex(name);
+        for (size_t i = _findFirst(type); i < _components.size(); ++i)
+            if (_components[i].type == type && _components[i].id == id)
+                return _components[i].ptr.get();
+        return nullptr;
     }
 
     size_t Entity::size() const
@@ -244,7 +274,9 @@ namespace gamelib
             if (i.ptr)
                 i.ptr->quit();
         _components.clear();
+        _typeslots.clear();
         _clearing = false;
+        _updateArchetype(false);
     }
 
     void Entity::_quit()
@@ -260,6 +292,39 @@ namespace gamelib
                 i.ptr->_refresh(type, comp);
     }
 
+    void Entity::_updateTypeSlots()
+    {
+        std::fill(_typeslots.begin(), _typeslots.end(), 0);
+
+        // Backwards, so the first component of each type wins
+        for (size_t i = _components.size(); i-- > 0;)
+            _typeslots[_components[i].type] = i + 1;
+    }
+
+    size_t Entity::_findFirst(TypeIndex type) const
+    {
+        if (type < _typeslots.size() && _typeslots[type])
+            return _typeslots[type] - 1;
+        return _components.size();
+    }
+
+    ObjectPool* Entity::_findArena(TypeIndex type)
+    {
+        return ArchetypeStorage::findArena(type);
+    }
+
+    void Entity::_updateArchetype(bool registerself)
+    {
+        if (_storage)
+            _storage->_update(this);
+        else if (registerself)
+        {
+            auto storage = ArchetypeStorage::findActive();
+            if (storage)
+                storage->add(this);
+        }
+    }
+
 
     Entity::ComponentList::const_iterator Entity::begin() const
     {
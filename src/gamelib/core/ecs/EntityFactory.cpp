@@ -1,6 +1,7 @@
 #include "gamelib/core/ecs/EntityFactory.hpp"
 #include "gamelib/core/ecs/EntityManager.hpp"
 #include "gamelib/core/ecs/serialization.hpp"
+#include "gamelib/core/ecs/ArchetypeStorage.hpp"
 #include "gamelib/core/res/ResourceManager.hpp"
 #include "gamelib/utils/log.hpp"
 
@@ -85,6 +86,7 @@ namespace gamelib
 
     ComponentPtr EntityFactory::createComponent(const std::string& name)
     {
+        ObjectPool::ScopedArena arena(ArchetypeStorage::findArena(getTypeIndex(name)));
         return _compfactory.create(name);
     }
 
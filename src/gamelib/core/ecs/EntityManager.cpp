@@ -1,4 +1,5 @@
 #include "gamelib/core/ecs/EntityManager.hpp"
+#include "gamelib/utils/log.hpp"
 
 namespace gamelib
 {
@@ -27,6 +28,28 @@ namespace gamelib
     void EntityManager::clear()
     {
         _root.destroy();
+
+        if (_arena && !_arena->release())
+            LOG_WARN("Level arena not released, ", _arena->size(), " objects are still alive");
+    }
+
+    void EntityManager::setLevelArena(bool enable)
+    {
+        if (enable == (bool)_arena)
+            return;
+
+        if (enable)
+        {
+            _arena.reset(new ObjectPool());
+            ObjectPool::setArena(_arena.get());
+        }
+        else
+            _arena.reset();
+    }
+
+    auto EntityManager::getLevelArena() const -> const ObjectPool*
+    {
+        return _arena.get();
     }
 
     auto EntityManager::getRoot() const -> EntityReference
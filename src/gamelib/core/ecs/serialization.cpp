@@ -189,18 +189,12 @@ namespace gamelib
                 // This assures that the whole component list is present and an entity is assigned
                 // when a component is loaded.
 
-                bool found = false;
-                for (auto& i : ent)
-                    if (i.ptr->getName() == name && i.id == id)
-                    {
-                        loadlist.push_back({ i.ptr.get(), &(*it) });
-                        found = true;
-                        break;
-                    }
-
                 // Component is already present
-                if (found)
+                if (auto comp = ent.find(name, id))
+                {
+                    loadlist.push_back({ comp.get(), &(*it) });
                     continue;
+                }
 
                 if (!createMissing)
                     LOG_WARN("Couldn't find matching component in entity ", ent.getName(), " for component ", it.key().asString());
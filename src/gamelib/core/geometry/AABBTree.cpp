@@ -0,0 +1,404 @@
+#include "gamelib/core/geometry/AABBTree.hpp"
+#include <cassert>
+#include <algorithm>
+
+namespace gamelib
+{
+    constexpr int null_node = broadphase_nullproxy;
+    constexpr size_t max_stack_size = 256;
+
+    AABBTree::AABBTree(float margin) :
+        _root(null_node),
+        _freelist(null_node),
+        _size(0),
+        _margin(margin)
+    { }
+
+    int AABBTree::add(Collidable* col, const math::AABBf& bbox)
+    {
+        int leaf = _allocate();
+        Node& node = _nodes[leaf];
+        node.obj = col;
+        node.height = 0;
+        node.bbox = math::AABBf(bbox.x - _margin, bbox.y - _margin,
+                bbox.w + 2 * _margin, bbox.h + 2 * _margin);
+        _insertLeaf(leaf);
+        ++_size;
+        return leaf;
+    }
+
+    void AABBTree::remove(int proxy)
+    {
+        assert(proxy >= 0 && proxy < (int)_nodes.size() && _nodes[proxy].isLeaf() && "Invalid proxy");
+        _removeLeaf(proxy);
+        _free(proxy);
+        --_size;
+    }
+
+    void AABBTree::update(int proxy, const math::AABBf& bbox)
+    {
+        assert(proxy >= 0 && proxy < (int)_nodes.size() && _nodes[proxy].isLeaf() && "Invalid proxy");
+
+        if (contains(_nodes[proxy].bbox, bbox))
+            return;
+
+        _removeLeaf(proxy);
+        _nodes[proxy].bbox = math::AABBf(bbox.x - _margin, bbox.y - _margin,
+                bbox.w + 2 * _margin, bbox.h + 2 * _margin);
+        _insertLeaf(proxy);
+    }
+
+    void AABBTree::clear()
+    {
+        _nodes.clear();
+        _root = null_node;
+        _freelist = null_node;
+        _size = 0;
+    }
+
+    size_t AABBTree::size() const
+    {
+        return _size;
+    }
+
+    std::unique_ptr<Broadphase> AABBTree::create() const
+    {
+        return std::unique_ptr<Broadphase>(new AABBTree(_margin));
+    }
+
+    void AABBTree::query(const math::AABBf& rect, std::vector<Collidable*>* result) const
+    {
+        if (_root == null_node)
+            return;
+
+        int stack[max_stack_size];
+        size_t top = 0;
+        stack[top++] = _root;
+
+        while (top > 0)
+        {
+            const Node& node = _nodes[stack[--top]];
+
+            if (!overlaps(node.bbox, rect))
+                continue;
+
+            if (node.isLeaf())
+                result->push_back(node.obj);
+            else
+            {
+                assert(top + 2 <= max_stack_size && "Tree too deep");
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+    }
+
+    void AABBTree::sweep(const math::AABBf& rect, const math::Vec2f& vel,
+            SweepCallback callback, void* me) const
+    {
+        struct Entry
+        {
+            float time;
+            int node;
+
+            // Inverted, so the heap returns the earliest node first
+            bool operator<(const Entry& rhs) const
+            {
+                return time > rhs.time;
+            }
+        };
+
+        if (_root == null_node)
+            return;
+
+        float maxtime = 1;
+        float time;
+
+        if (!sweepTime(rect, vel, _nodes[_root].bbox, maxtime, &time))
+            return;
+
+        ScratchBuffer<Entry> heap;
+        heap->push_back({ time, _root });
+
+        while (!heap->empty())
+        {
+            std::pop_heap(heap->begin(), heap->end());
+            const Entry entry = heap->back();
+            heap->pop_back();
+
+            // Every remaining node is behind the nearest hit
+            if (entry.time > maxtime)
+                break;
+
+            const Node& node = _nodes[entry.node];
+
+            if (node.isLeaf())
+            {
+                maxtime = std::min(maxtime, callback(me, node.obj));
+                continue;
+            }
+
+            for (int child : { node.left, node.right })
+            {
+                if (sweepTime(rect, vel, _nodes[child].bbox, maxtime, &time))
+                {
+                    heap->push_back({ time, child });
+                    std::push_heap(heap->begin(), heap->end());
+                }
+            }
+        }
+    }
+
+    const math::AABBf& AABBTree::getFatBBox(int proxy) const
+    {
+        return _nodes[proxy].bbox;
+    }
+
+    int AABBTree::getHeight() const
+    {
+        return _root == null_node ? 0 : _nodes[_root].height;
+    }
+
+
+    int AABBTree::_allocate()
+    {
+        int index;
+        if (_freelist == null_node)
+        {
+            index = _nodes.size();
+            _nodes.emplace_back();
+        }
+        else
+        {
+            index = _freelist;
+            _freelist = _nodes[index].parent;
+        }
+
+        Node& node = _nodes[index];
+        node.obj = nullptr;
+        node.parent = null_node;
+        node.left = null_node;
+        node.right = null_node;
+        node.height = 0;
+        return index;
+    }
+
+    void AABBTree::_free(int node)
+    {
+        _nodes[node].parent = _freelist;
+        _nodes[node].height = -1;
+        _nodes[node].obj = nullptr;
+        _freelist = node;
+    }
+
+    void AABBTree::_insertLeaf(int leaf)
+    {
+        if (_root == null_node)
+        {
+            _root = leaf;
+            _nodes[leaf].parent = null_node;
+            return;
+        }
+
+        // Find the best sibling using the surface area heuristic.
+        // Perimeter is used instead of the area, because it also works for
+        // degenerated boxes (lines, points).
+        const math::AABBf leafbox = _nodes[leaf].bbox;
+        int index = _root;
+
+        while (!_nodes[index].isLeaf())
+        {
+            const Node& node = _nodes[index];
+            const float area = perimeter(node.bbox);
+            const float combined = perimeter(merged(node.bbox, leafbox));
+
+            // Cost of creating a new parent for this node and the leaf
+            const float cost = 2 * combined;
+
+            // Minimum cost of pushing the leaf further down the tree
+            const float inheritance = 2 * (combined - area);
+
+            float childcost[2];
+            const int children[2] = { node.left, node.right };
+            for (int i = 0; i < 2; ++i)
+            {
+                const Node& child = _nodes[children[i]];
+                const float newarea = perimeter(merged(child.bbox, leafbox));
+                childcost[i] = inheritance + (child.isLeaf() ? newarea : newarea - perimeter(child.bbox));
+            }
+
+            if (cost < childcost[0] && cost < childcost[1])
+                break;
+
+            index = childcost[0] < childcost[1] ? children[0] : children[1];
+        }
+
+        // Create a new parent for the sibling and the leaf
+        const int sibling = index;
+        const int oldparent = _nodes[sibling].parent;
+        const int newparent = _allocate();   // invalidates references
+
+        _nodes[newparent].parent = oldparent;
+        _nodes[newparent].bbox = merged(leafbox, _nodes[sibling].bbox);
+        _nodes[newparent].height = _nodes[sibling].height + 1;
+        _nodes[newparent].left = sibling;
+        _nodes[newparent].right = leaf;
+        _nodes[sibling].parent = newparent;
+        _nodes[leaf].parent = newparent;
+
+        if (oldparent == null_node)
+            _root = newparent;
+        else if (_nodes[oldparent].left == sibling)
+            _nodes[oldparent].left = newparent;
+        else
+            _nodes[oldparent].right = newparent;
+
+        _refitParents(_nodes[leaf].parent);
+    }
+
+    void AABBTree::_removeLeaf(int leaf)
+    {
+        if (leaf == _root)
+        {
+            _root = null_node;
+            return;
+        }
+
+        const int parent = _nodes[leaf].parent;
+        const int grandparent = _nodes[parent].parent;
+        const int sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+
+        _free(parent);
+        _nodes[sibling].parent = grandparent;
+
+        if (grandparent == null_node)
+            _root = sibling;
+        else
+        {
+            if (_nodes[grandparent].left == parent)
+                _nodes[grandparent].left = sibling;
+            else
+                _nodes[grandparent].right = sibling;
+            _refitParents(grandparent);
+        }
+    }
+
+    void AABBTree::_refitParents(int index)
+    {
+        while (index != null_node)
+        {
+            index = _balance(index);
+
+            Node& node = _nodes[index];
+            const Node& left = _nodes[node.left];
+            const Node& right = _nodes[node.right];
+            node.height = 1 + std::max(left.height, right.height);
+            node.bbox = merged(left.bbox, right.bbox);
+
+            index = node.parent;
+        }
+    }
+
+    // Performs a left or right rotation if node a is imbalanced.
+    // Returns the new root of the subtree.
+    int AABBTree::_balance(int a)
+    {
+        Node& nodea = _nodes[a];
+        if (nodea.isLeaf() || nodea.height < 2)
+            return a;
+
+        const int b = nodea.left,
+                  c = nodea.right;
+        Node& nodeb = _nodes[b];
+        Node& nodec = _nodes[c];
+        const int balance = nodec.height - nodeb.height;
+
+        // Rotate c up
+        if (balance > 1)
+        {
+            const int f = nodec.left,
+                      g = nodec.right;
+            Node& nodef = _nodes[f];
+            Node& nodeg = _nodes[g];
+
+            nodec.left = a;
+            nodec.parent = nodea.parent;
+            nodea.parent = c;
+
+            if (nodec.parent == null_node)
+                _root = c;
+            else if (_nodes[nodec.parent].left == a)
+                _nodes[nodec.parent].left = c;
+            else
+                _nodes[nodec.parent].right = c;
+
+            if (nodef.height > nodeg.height)
+            {
+                nodec.right = f;
+                nodea.right = g;
+                nodeg.parent = a;
+                nodea.bbox = merged(nodeb.bbox, nodeg.bbox);
+                nodec.bbox = merged(nodea.bbox, nodef.bbox);
+                nodea.height = 1 + std::max(nodeb.height, nodeg.height);
+                nodec.height = 1 + std::max(nodea.height, nodef.height);
+            }
+            else
+            {
+                nodec.right = g;
+                nodea.right = f;
+                nodef.parent = a;
+                nodea.bbox = merged(nodeb.bbox, nodef.bbox);
+                nodec.bbox = merged(nodea.bbox, nodeg.bbox);
+                nodea.height = 1 + std::max(nodeb.height, nodef.height);
+                nodec.height = 1 + std::max(nodea.height, nodeg.height);
+            }
+
+            return c;
+        }
+
+        // Rotate b up
+        if (balance < -1)
+        {
+            const int d = nodeb.left,
+                      e = nodeb.right;
+            Node& noded = _nodes[d];
+            Node& nodee = _nodes[e];
+
+            nodeb.left = a;
+            nodeb.parent = nodea.parent;
+            nodea.parent = b;
+
+            if (nodeb.parent == null_node)
+                _root = b;
+            else if (_nodes[nodeb.parent].left == a)
+                _nodes[nodeb.parent].left = b;
+            else
+                _nodes[nodeb.parent].right = b;
+
+            if (noded.height > nodee.height)
+            {
+                nodeb.right = d;
+                nodea.left = e;
+                nodee.parent = a;
+                nodea.bbox = merged(nodec.bbox, nodee.bbox);
+                nodeb.bbox = merged(nodea.bbox, noded.bbox);
+                nodea.height = 1 + std::max(nodec.height, nodee.height);
+                nodeb.height = 1 + std::max(nodea.height, noded.height);
+            }
+            else
+            {
+                nodeb.right = e;
+                nodea.left = d;
+                noded.parent = a;
+                nodea.bbox = merged(nodec.bbox, noded.bbox);
+                nodeb.bbox = merged(nodea.bbox, nodee.bbox);
+                nodea.height = 1 + std::max(nodec.height, noded.height);
+                nodeb.height = 1 + std::max(nodea.height, nodee.height);
+            }
+
+            return b;
+        }
+
+        return a;
+    }
+}
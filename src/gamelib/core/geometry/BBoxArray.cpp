@@ -0,0 +1,354 @@
+#include "gamelib/core/geometry/BBoxArray.hpp"
+#include <cassert>
+
+#if defined(__AVX__)
+#   define GAMELIB_BBOX_AVX
+#   include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define GAMELIB_BBOX_SSE
+#   include <emmintrin.h>
+#endif
+
+// The scalar code mirrors the SIMD instructions exactly (operation order,
+// min/max semantics), so both produce the same bits.
+
+namespace gamelib
+{
+    // Same as _mm_min_ps / _mm_max_ps
+    inline float vmin(float a, float b)
+    {
+        return a < b ? a : b;
+    }
+
+    inline float vmax(float a, float b)
+    {
+        return a > b ? a : b;
+    }
+
+    inline void overlapRange(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result,
+            size_t begin, size_t end)
+    {
+        const float rminx = rect.x,
+                    rminy = rect.y,
+                    rmaxx = rect.x + rect.w,
+                    rmaxy = rect.y + rect.h;
+
+        for (size_t i = begin; i < end; ++i)
+            result[i] = boxes.minx[i] <= rmaxx && rminx <= boxes.maxx[i]
+                     && boxes.miny[i] <= rmaxy && rminy <= boxes.maxy[i];
+    }
+
+    inline void sweepRange(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times, size_t begin, size_t end)
+    {
+        const float rminx = rect.x,
+                    rminy = rect.y,
+                    rmaxx = rect.x + rect.w,
+                    rmaxy = rect.y + rect.h;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            // Ray vs. box extended by rect's size
+            const float lox = boxes.minx[i] - rmaxx,
+                        loy = boxes.miny[i] - rmaxy,
+                        hix = boxes.maxx[i] - rminx,
+                        hiy = boxes.maxy[i] - rminy;
+            float tmin = 0, tmax = maxtime;
+            bool hit = true;
+
+            if (vel.x == 0)
+                hit = hit && lox <= 0 && hix >= 0;
+            else
+            {
+                const float t1 = lox / vel.x,
+                            t2 = hix / vel.x;
+                tmin = vmax(tmin, vmin(t1, t2));
+                tmax = vmin(tmax, vmax(t1, t2));
+            }
+
+            if (vel.y == 0)
+                hit = hit && loy <= 0 && hiy >= 0;
+            else
+            {
+                const float t1 = loy / vel.y,
+                            t2 = hiy / vel.y;
+                tmin = vmax(tmin, vmin(t1, t2));
+                tmax = vmin(tmax, vmax(t1, t2));
+            }
+
+            times[i] = hit && tmin <= tmax ? tmin : bbox_nohit;
+        }
+    }
+
+
+    void overlapBoxesScalar(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result)
+    {
+        overlapRange(boxes, rect, result, 0, boxes.size);
+    }
+
+    void sweepBoxesScalar(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times)
+    {
+        sweepRange(boxes, rect, vel, maxtime, times, 0, boxes.size);
+    }
+
+
+#if defined(GAMELIB_BBOX_AVX)
+    void overlapBoxes(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result)
+    {
+        const __m256 rminx = _mm256_set1_ps(rect.x),
+                     rminy = _mm256_set1_ps(rect.y),
+                     rmaxx = _mm256_set1_ps(rect.x + rect.w),
+                     rmaxy = _mm256_set1_ps(rect.y + rect.h);
+
+        size_t i = 0;
+        for (; i + 8 <= boxes.size; i += 8)
+        {
+            const __m256 x = _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_loadu_ps(boxes.minx + i), rmaxx, _CMP_LE_OQ),
+                    _mm256_cmp_ps(rminx, _mm256_loadu_ps(boxes.maxx + i), _CMP_LE_OQ));
+            const __m256 y = _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_loadu_ps(boxes.miny + i), rmaxy, _CMP_LE_OQ),
+                    _mm256_cmp_ps(rminy, _mm256_loadu_ps(boxes.maxy + i), _CMP_LE_OQ));
+            const int mask = _mm256_movemask_ps(_mm256_and_ps(x, y));
+
+            for (int j = 0; j < 8; ++j)
+                result[i + j] = (mask >> j) & 1;
+        }
+
+        overlapRange(boxes, rect, result, i, boxes.size);
+    }
+
+    void sweepBoxes(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times)
+    {
+        const __m256 rminx = _mm256_set1_ps(rect.x),
+                     rminy = _mm256_set1_ps(rect.y),
+                     rmaxx = _mm256_set1_ps(rect.x + rect.w),
+                     rmaxy = _mm256_set1_ps(rect.y + rect.h),
+                     velx = _mm256_set1_ps(vel.x),
+                     vely = _mm256_set1_ps(vel.y),
+                     zero = _mm256_setzero_ps(),
+                     nohit = _mm256_set1_ps(bbox_nohit),
+                     allset = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        size_t i = 0;
+        for (; i + 8 <= boxes.size; i += 8)
+        {
+            const __m256 lox = _mm256_sub_ps(_mm256_loadu_ps(boxes.minx + i), rmaxx),
+                         loy = _mm256_sub_ps(_mm256_loadu_ps(boxes.miny + i), rmaxy),
+                         hix = _mm256_sub_ps(_mm256_loadu_ps(boxes.maxx + i), rminx),
+                         hiy = _mm256_sub_ps(_mm256_loadu_ps(boxes.maxy + i), rminy);
+            __m256 tmin = zero,
+                   tmax = _mm256_set1_ps(maxtime),
+                   hit = allset;
+
+            if (vel.x == 0)
+                hit = _mm256_and_ps(hit, _mm256_and_ps(
+                            _mm256_cmp_ps(lox, zero, _CMP_LE_OQ),
+                            _mm256_cmp_ps(hix, zero, _CMP_GE_OQ)));
+            else
+            {
+                const __m256 t1 = _mm256_div_ps(lox, velx),
+                             t2 = _mm256_div_ps(hix, velx);
+                tmin = _mm256_max_ps(tmin, _mm256_min_ps(t1, t2));
+                tmax = _mm256_min_ps(tmax, _mm256_max_ps(t1, t2));
+            }
+
+            if (vel.y == 0)
+                hit = _mm256_and_ps(hit, _mm256_and_ps(
+                            _mm256_cmp_ps(loy, zero, _CMP_LE_OQ),
+                            _mm256_cmp_ps(hiy, zero, _CMP_GE_OQ)));
+            else
+            {
+                const __m256 t1 = _mm256_div_ps(loy, vely),
+                             t2 = _mm256_div_ps(hiy, vely);
+                tmin = _mm256_max_ps(tmin, _mm256_min_ps(t1, t2));
+                tmax = _mm256_min_ps(tmax, _mm256_max_ps(t1, t2));
+            }
+
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ));
+            _mm256_storeu_ps(times + i, _mm256_blendv_ps(nohit, tmin, hit));
+        }
+
+        sweepRange(boxes, rect, vel, maxtime, times, i, boxes.size);
+    }
+
+    const char* getBBoxKernelName()
+    {
+        return "AVX";
+    }
+
+#elif defined(GAMELIB_BBOX_SSE)
+    void overlapBoxes(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result)
+    {
+        const __m128 rminx = _mm_set1_ps(rect.x),
+                     rminy = _mm_set1_ps(rect.y),
+                     rmaxx = _mm_set1_ps(rect.x + rect.w),
+                     rmaxy = _mm_set1_ps(rect.y + rect.h);
+
+        size_t i = 0;
+        for (; i + 4 <= boxes.size; i += 4)
+        {
+            const __m128 x = _mm_and_ps(
+                    _mm_cmple_ps(_mm_loadu_ps(boxes.minx + i), rmaxx),
+                    _mm_cmple_ps(rminx, _mm_loadu_ps(boxes.maxx + i)));
+            const __m128 y = _mm_and_ps(
+                    _mm_cmple_ps(_mm_loadu_ps(boxes.miny + i), rmaxy),
+                    _mm_cmple_ps(rminy, _mm_loadu_ps(boxes.maxy + i)));
+            const int mask = _mm_movemask_ps(_mm_and_ps(x, y));
+
+            for (int j = 0; j < 4; ++j)
+                result[i + j] = (mask >> j) & 1;
+        }
+
+        overlapRange(boxes, rect, result, i, boxes.size);
+    }
+
+    void sweepBoxes(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times)
+    {
+        const __m128 rminx = _mm_set1_ps(rect.x),
+                     rminy = _mm_set1_ps(rect.y),
+                     rmaxx = _mm_set1_ps(rect.x + rect.w),
+                     rmaxy = _mm_set1_ps(rect.y + rect.h),
+                     velx = _mm_set1_ps(vel.x),
+                     vely = _mm_set1_ps(vel.y),
+                     zero = _mm_setzero_ps(),
+                     nohit = _mm_set1_ps(bbox_nohit),
+                     allset = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        size_t i = 0;
+        for (; i + 4 <= boxes.size; i += 4)
+        {
+            const __m128 lox = _mm_sub_ps(_mm_loadu_ps(boxes.minx + i), rmaxx),
+                         loy = _mm_sub_ps(_mm_loadu_ps(boxes.miny + i), rmaxy),
+                         hix = _mm_sub_ps(_mm_loadu_ps(boxes.maxx + i), rminx),
+                         hiy = _mm_sub_ps(_mm_loadu_ps(boxes.maxy + i), rminy);
+            __m128 tmin = zero,
+                   tmax = _mm_set1_ps(maxtime),
+                   hit = allset;
+
+            if (vel.x == 0)
+                hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(lox, zero), _mm_cmpge_ps(hix, zero)));
+            else
+            {
+                const __m128 t1 = _mm_div_ps(lox, velx),
+                             t2 = _mm_div_ps(hix, velx);
+                tmin = _mm_max_ps(tmin, _mm_min_ps(t1, t2));
+                tmax = _mm_min_ps(tmax, _mm_max_ps(t1, t2));
+            }
+
+            if (vel.y == 0)
+                hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmple_ps(loy, zero), _mm_cmpge_ps(hiy, zero)));
+            else
+            {
+                const __m128 t1 = _mm_div_ps(loy, vely),
+                             t2 = _mm_div_ps(hiy, vely);
+                tmin = _mm_max_ps(tmin, _mm_min_ps(t1, t2));
+                tmax = _mm_min_ps(tmax, _mm_max_ps(t1, t2));
+            }
+
+            hit = _mm_and_ps(hit, _mm_cmple_ps(tmin, tmax));
+            _mm_storeu_ps(times + i, _mm_or_ps(_mm_and_ps(hit, tmin), _mm_andnot_ps(hit, nohit)));
+        }
+
+        sweepRange(boxes, rect, vel, maxtime, times, i, boxes.size);
+    }
+
+    const char* getBBoxKernelName()
+    {
+        return "SSE";
+    }
+
+#else
+    void overlapBoxes(const BBoxRef& boxes, const math::AABBf& rect, uint8_t* result)
+    {
+        overlapBoxesScalar(boxes, rect, result);
+    }
+
+    void sweepBoxes(const BBoxRef& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+            float maxtime, float* times)
+    {
+        sweepBoxesScalar(boxes, rect, vel, maxtime, times);
+    }
+
+    const char* getBBoxKernelName()
+    {
+        return "scalar";
+    }
+#endif
+
+
+    void BBoxArray::add(const math::AABBf& box)
+    {
+        _minx.push_back(box.x);
+        _miny.push_back(box.y);
+        _maxx.push_back(box.x + box.w);
+        _maxy.push_back(box.y + box.h);
+    }
+
+    void BBoxArray::set(size_t index, const math::AABBf& box)
+    {
+        assert(index < size() && "Index out of range");
+        _minx[index] = box.x;
+        _miny[index] = box.y;
+        _maxx[index] = box.x + box.w;
+        _maxy[index] = box.y + box.h;
+    }
+
+    math::AABBf BBoxArray::get(size_t index) const
+    {
+        assert(index < size() && "Index out of range");
+        return math::AABBf(_minx[index], _miny[index],
+                _maxx[index] - _minx[index], _maxy[index] - _miny[index]);
+    }
+
+    void BBoxArray::swapRemove(size_t index)
+    {
+        assert(index < size() && "Index out of range");
+        _minx[index] = _minx.back();
+        _miny[index] = _miny.back();
+        _maxx[index] = _maxx.back();
+        _maxy[index] = _maxy.back();
+        _minx.pop_back();
+        _miny.pop_back();
+        _maxx.pop_back();
+        _maxy.pop_back();
+    }
+
+    void BBoxArray::clear()
+    {
+        _minx.clear();
+        _miny.clear();
+        _maxx.clear();
+        _maxy.clear();
+    }
+
+    size_t BBoxArray::size() const
+    {
+        return _minx.size();
+    }
+
+    BBoxRef BBoxArray::ref() const
+    {
+        return { _minx.data(), _miny.data(), _maxx.data(), _maxy.data(), _minx.size() };
+    }
+
+
+    BBoxRef packBoxes(const math::AABBf* boxes, size_t num, std::vector<float>* buffer)
+    {
+        buffer->resize(4 * num);
+        float* data = buffer->data();
+
+        for (size_t i = 0; i < num; ++i)
+        {
+            data[i] = boxes[i].x;
+            data[num + i] = boxes[i].y;
+            data[2 * num + i] = boxes[i].x + boxes[i].w;
+            data[3 * num + i] = boxes[i].y + boxes[i].h;
+        }
+
+        return { data, data + num, data + 2 * num, data + 3 * num, num };
+    }
+}
@@ -0,0 +1,44 @@
+#include "gamelib/core/geometry/Collidable.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+
+namespace gamelib
+{
+    Collidable::Collidable() :
+        Collidable(0)
+    { }
+
+    Collidable::Collidable(unsigned int flags_) :
+        flags(flags_),
+        _colsys(nullptr),
+        _colindex(0),
+        _colorder(0),
+        _proxy(broadphase_nullproxy),
+        _layer(0)
+    { }
+
+    Collidable::~Collidable()
+    {
+        if (_colsys)
+            _colsys->remove(this);
+    }
+
+    void Collidable::setLayer(int layer)
+    {
+        if (_colsys)
+            _colsys->_setLayer(this, layer);
+        else
+            _layer = layer;
+    }
+
+    int Collidable::getLayer() const
+    {
+        return _layer;
+    }
+
+    void Collidable::_markDirty() const
+    {
+        Transformable::_markDirty();
+        if (_colsys)
+            _colsys->_refit(this);
+    }
+}
@@ -1,23 +1,106 @@
 #include "gamelib/core/geometry/CollisionSystem.hpp"
+#include "gamelib/core/geometry/AABBTree.hpp"
+#include "gamelib/utils/log.hpp"
+#include "json/json.h"
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
 
 namespace gamelib
 {
+    constexpr size_t max_batch_cluster = 32;
+
+    // Interleaves the lower 16 bits of x and y (z-order curve)
+    inline uint32_t morton(uint32_t x, uint32_t y)
+    {
+        auto spread = [](uint32_t v) {
+            v &= 0xffff;
+            v = (v | (v << 8)) & 0x00ff00ff;
+            v = (v | (v << 4)) & 0x0f0f0f0f;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        return spread(x) | (spread(y) << 1);
+    }
+
+
+    CollisionSystem::CollisionSystem() :
+        CollisionSystem(std::unique_ptr<Broadphase>(new AABBTree()))
+    { }
+
+    CollisionSystem::CollisionSystem(std::unique_ptr<Broadphase> broadphase) :
+        _counter(0),
+        _defer(false)
+    {
+        _layers.push_back({ collision_defaultlayer, collision_alllayers, std::move(broadphase) });
+    }
+
+    CollisionSystem::~CollisionSystem()
+    {
+        destroy();
+    }
+
     void CollisionSystem::add(Collidable* col)
     {
+        assert(!_defer && "Can't add objects while refits are deferred");
+
+        if (col->_colsys == this)
+            return;
+
+        if (col->_colsys)
+        {
+            LOG_DEBUG_WARN("Collidable is already registered in a different CollisionSystem -> moving");
+            col->_colsys->remove(col);
+        }
+
+        if (col->_layer < 0 || col->_layer >= (int)_layers.size())
+        {
+            LOG_WARN("Invalid collision layer: ", col->_layer, " -> using default layer");
+            col->_layer = 0;
+        }
+
+        const math::AABBf bbox = col->getBBox();
+        col->_colsys = this;
+        col->_colindex = _objs.size();
+        col->_colorder = _counter++;
+        col->_proxy = _layers[col->_layer].broadphase->add(col, bbox);
         _objs.push_back(col);
+        _bboxes.add(bbox);
     }
 
     void CollisionSystem::remove(Collidable* col)
     {
-        auto it = std::find(_objs.begin(), _objs.end(), col);
-        if (it != _objs.end())
-            _objs.erase(it);
+        assert(!_defer && "Can't remove objects while refits are deferred");
+
+        if (col->_colsys != this)
+            return;
+
+        // Swap and pop, ordering is handled by _colorder
+        Collidable* back = _objs.back();
+        _objs[col->_colindex] = back;
+        back->_colindex = col->_colindex;
+        _objs.pop_back();
+        _bboxes.swapRemove(col->_colindex);
+
+        _layers[col->_layer].broadphase->remove(col->_proxy);
+        col->_colsys = nullptr;
+        col->_proxy = broadphase_nullproxy;
     }
 
     void CollisionSystem::destroy()
     {
+        for (auto i : _objs)
+        {
+            i->_colsys = nullptr;
+            i->_proxy = broadphase_nullproxy;
+        }
         _objs.clear();
+        _bboxes.clear();
+
+        _layers.resize(1);
+        _layers[0].mask = collision_alllayers;
+        _layers[0].broadphase->clear();
     }
 
     size_t CollisionSystem::size() const
@@ -25,24 +108,421 @@ namespace gamelib
         return _objs.size();
     }
 
-    Collidable* CollisionSystem::intersect(const math::Point2f& point, const Collidable* self, unsigned int flags) const
+    void CollisionSystem::setBroadphase(std::unique_ptr<Broadphase> broadphase)
+    {
+        for (size_t i = 1; i < _layers.size(); ++i)
+            _layers[i].broadphase = broadphase->create();
+        _layers[0].broadphase = std::move(broadphase);
+        _layers[0].broadphase->clear();
+
+        for (auto i : _objs)
+            i->_proxy = _layers[i->_layer].broadphase->add(i, i->getBBox());
+    }
+
+    const Broadphase& CollisionSystem::getBroadphase(int layer) const
+    {
+        assert(layer >= 0 && layer < (int)_layers.size() && "Invalid layer");
+        return *_layers[layer].broadphase;
+    }
+
+
+    int CollisionSystem::createLayer(const std::string& name)
+    {
+        int layer = findLayer(name);
+        if (layer != collision_nolayer)
+        {
+            LOG_DEBUG_WARN("Collision layer already exists: ", name, " -> using existing one");
+            return layer;
+        }
+
+        if (_layers.size() >= (size_t)collision_maxlayers)
+        {
+            LOG_ERROR("Can't create collision layer ", name, ": maximum amount of layers reached");
+            return collision_nolayer;
+        }
+
+        _layers.push_back({ name, collision_alllayers, _layers[0].broadphase->create() });
+        return _layers.size() - 1;
+    }
+
+    int CollisionSystem::findLayer(const std::string& name) const
     {
-        return intersectAll(point, self, flags, [](Collidable*) { return true; });
+        for (size_t i = 0; i < _layers.size(); ++i)
+            if (_layers[i].name == name)
+                return i;
+        return collision_nolayer;
     }
 
-    Collidable* CollisionSystem::intersect(const math::AABBf& rect, const Collidable* self, unsigned int flags) const
+    const std::string& CollisionSystem::getLayerName(int layer) const
     {
-        return intersectAll(rect, self, flags, [](Collidable*) { return true; });
+        assert(layer >= 0 && layer < (int)_layers.size() && "Invalid layer");
+        return _layers[layer].name;
     }
 
-    TraceResult CollisionSystem::trace(const math::Line2f& line, const Collidable* self, unsigned int flags) const
+    size_t CollisionSystem::getNumLayers() const
     {
-        return trace(line, [](Collidable*, const Intersection&) { return true; }, self, flags);
+        return _layers.size();
     }
 
-    TraceResult CollisionSystem::trace(const math::AABBf& rect, const math::Vec2f& vel, const Collidable* self, unsigned int flags) const
+    void CollisionSystem::setLayerMask(int layer, unsigned int mask)
     {
-        return trace(rect, vel, [](Collidable*, const Intersection&) { return true; }, self, flags);
+        assert(layer >= 0 && layer < (int)_layers.size() && "Invalid layer");
+        _layers[layer].mask = mask;
+    }
+
+    unsigned int CollisionSystem::getLayerMask(int layer) const
+    {
+        assert(layer >= 0 && layer < (int)_layers.size() && "Invalid layer");
+        return _layers[layer].mask;
+    }
+
+    bool CollisionSystem::loadFromJson(const Json::Value& node)
+    {
+        if (!node.isMember("layers"))
+            return true;
+
+        const auto& layers = node["layers"];
+        if (!layers.isArray())
+        {
+            LOG_ERROR("Collision layers must be an array");
+            return false;
+        }
+
+        // Create all layers first, so masks can refer to layers defined later
+        for (const auto& i : layers)
+            if (findLayer(i["name"].asString()) == collision_nolayer)
+                createLayer(i["name"].asString());
+
+        for (const auto& i : layers)
+        {
+            if (!i.isMember("collides"))
+                continue;
+
+            const int layer = findLayer(i["name"].asString());
+            if (layer == collision_nolayer)
+                continue;
+
+            unsigned int mask = 0;
+            for (const auto& other : i["collides"])
+            {
+                const int otherlayer = findLayer(other.asString());
+                if (otherlayer == collision_nolayer)
+                    LOG_WARN("Unknown collision layer: ", other.asString());
+                else
+                    mask |= 1u << otherlayer;
+            }
+            setLayerMask(layer, mask);
+        }
+
+        return true;
+    }
+
+    void CollisionSystem::writeToJson(Json::Value& node) const
+    {
+        const unsigned int existing = collision_alllayers >> (collision_maxlayers - _layers.size());
+        auto& layers = node["layers"];
+        layers = Json::Value(Json::arrayValue);
+
+        for (const auto& i : _layers)
+        {
+            Json::Value& layer = layers.append(Json::Value(Json::objectValue));
+            layer["name"] = i.name;
+
+            // Omit the mask if the layer collides with everything
+            if ((i.mask & existing) == existing)
+                continue;
+
+            auto& collides = layer["collides"];
+            collides = Json::Value(Json::arrayValue);
+            for (size_t j = 0; j < _layers.size(); ++j)
+                if (i.mask & (1u << j))
+                    collides.append(_layers[j].name);
+        }
+    }
+
+    void CollisionSystem::beginDeferredRefit()
+    {
+        _defer = true;
+    }
+
+    void CollisionSystem::endDeferredRefit()
+    {
+        _defer = false;
+
+        // Apply in a fixed order, so the broadphase ends up in the same state
+        // regardless of the order objects were moved in.
+        std::sort(_deferred.begin(), _deferred.end(), [](const Collidable* a, const Collidable* b) {
+                return a->_colorder < b->_colorder;
+            });
+        _deferred.erase(std::unique(_deferred.begin(), _deferred.end()), _deferred.end());
+
+        for (auto i : _deferred)
+            _refit(i);
+        _deferred.clear();
+    }
+
+    void CollisionSystem::reserve(const Collidable* col, const math::AABBf& area)
+    {
+        if (col->_colsys == this)
+            _layers[col->_layer].broadphase->update(col->_proxy, merged(col->getBBox(), area));
+    }
+
+    Collidable* CollisionSystem::intersect(const math::Point2f& point, const Collidable* self, unsigned int flags,
+            unsigned int layers) const
+    {
+        return intersectAll(point, self, flags, [](Collidable*) { return true; }, layers);
+    }
+
+    Collidable* CollisionSystem::intersect(const math::AABBf& rect, const Collidable* self, unsigned int flags,
+            unsigned int layers) const
+    {
+        return intersectAll(rect, self, flags, [](Collidable*) { return true; }, layers);
+    }
+
+    TraceResult CollisionSystem::trace(const math::Line2f& line, const Collidable* self, unsigned int flags,
+            unsigned int layers) const
+    {
+        return trace(line, [](Collidable*, const Intersection&) { return true; }, self, flags, TraceNearest, layers);
+    }
+
+    TraceResult CollisionSystem::trace(const math::AABBf& rect, const math::Vec2f& vel, const Collidable* self,
+            unsigned int flags, unsigned int layers) const
+    {
+        return trace(rect, vel, [](Collidable*, const Intersection&) { return true; }, self, flags, TraceNearest, layers);
+    }
+
+
+    template <typename F>
+    void CollisionSystem::_batch(const math::AABBf* areas, const unsigned int* layers, size_t num, F callback) const
+    {
+        if (num == 0)
+            return;
+
+        math::AABBf bounds = areas[0];
+        for (size_t i = 1; i < num; ++i)
+            bounds = merged(bounds, areas[i]);
+
+        // Sort along a z-order curve, so that nearby queries end up next to each other
+        const float scalex = bounds.w > 0 ? 0xffff / bounds.w : 0,
+                    scaley = bounds.h > 0 ? 0xffff / bounds.h : 0;
+
+        ScratchBuffer<std::pair<uint32_t, size_t>> order;
+        for (size_t i = 0; i < num; ++i)
+        {
+            const math::Point2f center = areas[i].getCenter();
+            order->emplace_back(morton((center.x - bounds.x) * scalex, (center.y - bounds.y) * scaley), i);
+        }
+        std::sort(order->begin(), order->end());
+
+        ScratchBuffer<Collidable*> candidates;
+        ScratchBuffer<float> boxbuffer;
+        size_t begin = 0;
+
+        while (begin < num)
+        {
+            // Grow the cluster as long as the queries are close to each other
+            math::AABBf area = areas[(*order)[begin].second];
+            unsigned int arealayers = layers[(*order)[begin].second];
+            size_t end = begin + 1;
+            for (; end < num && end - begin < max_batch_cluster; ++end)
+            {
+                const math::AABBf& next = areas[(*order)[end].second];
+                const math::AABBf combined = merged(area, next);
+                if (perimeter(combined) > perimeter(area) + perimeter(next))
+                    break;
+                area = combined;
+                arealayers |= layers[(*order)[end].second];
+            }
+
+            candidates->clear();
+            _query(area, arealayers, &candidates.get());
+            const BBoxRef boxes = _gather(*candidates, &boxbuffer.get());
+
+            for (size_t i = begin; i < end; ++i)
+                callback((*order)[i].second, candidates.get(), boxes);
+
+            begin = end;
+        }
+    }
+
+
+    void CollisionSystem::traceBatch(const TraceQuery* queries, size_t num, TraceResult* results) const
+    {
+        ScratchBuffer<math::AABBf> areas;
+        ScratchBuffer<unsigned int> layers;
+        for (size_t i = 0; i < num; ++i)
+        {
+            areas->push_back(sweptBBox(queries[i].rect, queries[i].vel));
+            layers->push_back(_queryLayers(queries[i].self, queries[i].layers));
+        }
+
+        ScratchBuffer<float> times;
+        _batch(areas->data(), layers->data(), num, [&](size_t index, const std::vector<Collidable*>& candidates,
+                    const BBoxRef& boxes) {
+                const TraceQuery& query = queries[index];
+                const unsigned int querylayers = (*layers)[index];
+                TraceResult& nearest = results[index];
+                nearest = TraceResult();
+
+                times->resize(boxes.size);
+                sweepBoxes(boxes, detail::prefilterBBox(query.rect), query.vel, 1, times->data());
+
+                for (size_t i = 0; i < candidates.size(); ++i)
+                {
+                    Collidable* c = candidates[i];
+                    if ((*times)[i] == bbox_nohit || c == query.self || (query.flags && !(c->flags & query.flags))
+                            || !(querylayers & (1u << c->_layer)))
+                        continue;
+
+                    Intersection isec;
+                    if (c->flags & collision_noprecise)
+                        isec = math::sweep(query.rect, query.vel, _bboxes.get(c->_colindex));
+                    else
+                        isec = c->sweep(query.rect, query.vel);
+
+                    if (isec && _isNearer(isec, c, nearest))
+                    {
+                        nearest.obj = c;
+                        nearest.isec = isec;
+                    }
+                }
+            });
+    }
+
+    void CollisionSystem::intersectBatch(const IntersectQuery* queries, size_t num, Collidable** results) const
+    {
+        ScratchBuffer<math::AABBf> areas;
+        ScratchBuffer<unsigned int> layers;
+        for (size_t i = 0; i < num; ++i)
+        {
+            areas->push_back(queries[i].rect);
+            layers->push_back(_queryLayers(queries[i].self, queries[i].layers));
+        }
+
+        ScratchBuffer<uint8_t> mask;
+        _batch(areas->data(), layers->data(), num, [&](size_t index, const std::vector<Collidable*>& candidates,
+                    const BBoxRef& boxes) {
+                const IntersectQuery& query = queries[index];
+                const unsigned int querylayers = (*layers)[index];
+                results[index] = nullptr;
+
+                mask->resize(boxes.size);
+                overlapBoxes(boxes, detail::prefilterBBox(query.rect), mask->data());
+
+                // Candidates are sorted newest first, like in intersect()
+                for (size_t i = 0; i < candidates.size(); ++i)
+                {
+                    Collidable* c = candidates[i];
+                    if (!(*mask)[i] || c == query.self || (query.flags && !(c->flags & query.flags))
+                            || !(querylayers & (1u << c->_layer)))
+                        continue;
+
+                    if (c->flags & collision_noprecise
+                            ? math::intersect(_bboxes.get(c->_colindex), query.rect)
+                            : c->intersect(query.rect))
+                    {
+                        results[index] = c;
+                        break;
+                    }
+                }
+            });
+    }
+
+
+    unsigned int CollisionSystem::_queryLayers(const Collidable* self, unsigned int layers) const
+    {
+        if (self && self->_colsys == this)
+            return layers & _layers[self->_layer].mask;
+        return layers;
+    }
+
+    void CollisionSystem::_query(const math::AABBf& rect, unsigned int layers, std::vector<Collidable*>* result) const
+    {
+        for (size_t i = 0; i < _layers.size(); ++i)
+            if (layers & (1u << i))
+                _layers[i].broadphase->query(rect, result);
+
+        std::sort(result->begin(), result->end(), [](const Collidable* a, const Collidable* b) {
+                return a->_colorder > b->_colorder;
+            });
+    }
+
+    void CollisionSystem::_query(const math::Line2f& line, unsigned int layers, std::vector<Collidable*>* result) const
+    {
+        if (line.type == math::Segment)
+            return _query(sweptBBox(math::AABBf(line.p.x, line.p.y, 0, 0), line.d), layers, result);
+
+        // Rays and infinite lines can't be bounded -> test everything
+        for (auto i : _objs)
+            if (layers & (1u << i->_layer))
+                result->push_back(i);
+
+        std::sort(result->begin(), result->end(), [](const Collidable* a, const Collidable* b) {
+                return a->_colorder > b->_colorder;
+            });
+    }
+
+    void CollisionSystem::_sweep(const math::AABBf& rect, const math::Vec2f& vel, unsigned int layers,
+            SweepCallback callback, void* me) const
+    {
+        // The callback keeps track of the nearest hit, so later layers are
+        // still pruned by hits found in earlier ones.
+        for (size_t i = 0; i < _layers.size(); ++i)
+            if (layers & (1u << i))
+                _layers[i].broadphase->sweep(rect, vel, callback, me);
+    }
+
+    BBoxRef CollisionSystem::_gather(const std::vector<Collidable*>& candidates, std::vector<float>* buffer) const
+    {
+        const BBoxRef all = _bboxes.ref();
+        const size_t num = candidates.size();
+        buffer->resize(4 * num);
+        float* data = buffer->data();
+
+        for (size_t i = 0; i < num; ++i)
+        {
+            const size_t index = candidates[i]->_colindex;
+            data[i] = all.minx[index];
+            data[num + i] = all.miny[index];
+            data[2 * num + i] = all.maxx[index];
+            data[3 * num + i] = all.maxy[index];
+        }
+
+        return { data, data + num, data + 2 * num, data + 3 * num, num };
+    }
+
+    void CollisionSystem::_refit(const Collidable* col)
+    {
+        const math::AABBf bbox = col->getBBox();
+
+        // Different objects use different slots, so this is safe while deferred
+        _bboxes.set(col->_colindex, bbox);
+
+        if (_defer)
+        {
+            std::lock_guard<std::mutex> guard(_deferlock);
+            _deferred.push_back(col);
+            return;
+        }
+        _layers[col->_layer].broadphase->update(col->_proxy, bbox);
+    }
+
+    void CollisionSystem::_setLayer(Collidable* col, int layer)
+    {
+        assert(!_defer && "Can't change layers while refits are deferred");
+
+        if (layer < 0 || layer >= (int)_layers.size())
+        {
+            LOG_WARN("Invalid collision layer: ", layer, " -> using default layer");
+            layer = 0;
+        }
+
+        if (col->_layer == layer)
+            return;
+
+        _layers[col->_layer].broadphase->remove(col->_proxy);
+        col->_layer = layer;
+        col->_proxy = _layers[layer].broadphase->add(col, col->getBBox());
     }
 
 
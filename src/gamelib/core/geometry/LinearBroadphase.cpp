@@ -0,0 +1,63 @@
+#include "gamelib/core/geometry/LinearBroadphase.hpp"
+#include <cassert>
+
+namespace gamelib
+{
+    LinearBroadphase::LinearBroadphase()
+    { }
+
+    int LinearBroadphase::add(Collidable* col, const math::AABBf& bbox)
+    {
+        int proxy;
+        if (_free.empty())
+        {
+            proxy = _proxies.size();
+            _proxies.emplace_back();
+        }
+        else
+        {
+            proxy = _free.back();
+            _free.pop_back();
+        }
+
+        _proxies[proxy].bbox = bbox;
+        _proxies[proxy].obj = col;
+        return proxy;
+    }
+
+    void LinearBroadphase::remove(int proxy)
+    {
+        assert(proxy >= 0 && proxy < (int)_proxies.size() && _proxies[proxy].obj && "Invalid proxy");
+        _proxies[proxy].obj = nullptr;
+        _free.push_back(proxy);
+    }
+
+    void LinearBroadphase::update(int proxy, const math::AABBf& bbox)
+    {
+        assert(proxy >= 0 && proxy < (int)_proxies.size() && _proxies[proxy].obj && "Invalid proxy");
+        _proxies[proxy].bbox = bbox;
+    }
+
+    void LinearBroadphase::clear()
+    {
+        _proxies.clear();
+        _free.clear();
+    }
+
+    size_t LinearBroadphase::size() const
+    {
+        return _proxies.size() - _free.size();
+    }
+
+    std::unique_ptr<Broadphase> LinearBroadphase::create() const
+    {
+        return std::unique_ptr<Broadphase>(new LinearBroadphase());
+    }
+
+    void LinearBroadphase::query(const math::AABBf& rect, std::vector<Collidable*>* result) const
+    {
+        for (auto& i : _proxies)
+            if (i.obj && overlaps(i.bbox, rect))
+                result->push_back(i.obj);
+    }
+}
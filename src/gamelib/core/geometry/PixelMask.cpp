@@ -0,0 +1,238 @@
+#include "gamelib/core/geometry/PixelMask.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gamelib
+{
+    constexpr float sdf_infinity = 1e20;
+
+    // Index of the lowest set bit, word must not be 0
+    inline int lowestBit(uint64_t word)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(word);
+#else
+        int i = 0;
+        while (!(word & 1))
+        {
+            word >>= 1;
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+    // Bits [begin, end) of the word containing begin, end is relative to the word start
+    inline uint64_t rangeMask(int begin, int end)
+    {
+        const uint64_t lo = ~uint64_t(0) << begin;
+        return end >= 64 ? lo : lo & ((uint64_t(1) << end) - 1);
+    }
+
+    // 1D squared euclidean distance transform (Felzenszwalb & Huttenlocher).
+    // f contains 0 for source cells and sdf_infinity otherwise.
+    static void distanceTransform(const float* f, float* d, int n, int* v, float* z)
+    {
+        int k = 0;
+        v[0] = 0;
+        z[0] = -sdf_infinity;
+        z[1] = sdf_infinity;
+
+        for (int q = 1; q < n; ++q)
+        {
+            float s;
+            do
+            {
+                const int p = v[k];
+                s = ((f[q] + float(q) * q) - (f[p] + float(p) * p)) / (2 * q - 2 * p);
+            } while (s <= z[k] && k-- > 0);
+
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = sdf_infinity;
+        }
+
+        k = 0;
+        for (int q = 0; q < n; ++q)
+        {
+            while (z[k + 1] < q)
+                ++k;
+            d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+        }
+    }
+
+    // 2D squared euclidean distance transform, in place
+    static void distanceTransform(std::vector<float>* grid, int w, int h)
+    {
+        const int n = std::max(w, h);
+        std::vector<float> f(n), d(n), z(n + 1);
+        std::vector<int> v(n);
+
+        for (int x = 0; x < w; ++x)
+        {
+            for (int y = 0; y < h; ++y)
+                f[y] = (*grid)[y * w + x];
+            distanceTransform(f.data(), d.data(), h, v.data(), z.data());
+            for (int y = 0; y < h; ++y)
+                (*grid)[y * w + x] = d[y];
+        }
+
+        for (int y = 0; y < h; ++y)
+        {
+            distanceTransform(&(*grid)[y * w], d.data(), w, v.data(), z.data());
+            std::copy(d.begin(), d.begin() + w, grid->begin() + y * w);
+        }
+    }
+
+
+    PixelMask::PixelMask() :
+        _w(0),
+        _h(0),
+        _stride(0)
+    { }
+
+    void PixelMask::clear()
+    {
+        _bits.clear();
+        _spans.clear();
+        _sdf.clear();
+        _w = _h = _stride = 0;
+    }
+
+    int PixelMask::getWidth() const
+    {
+        return _w;
+    }
+
+    int PixelMask::getHeight() const
+    {
+        return _h;
+    }
+
+    bool PixelMask::test(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= _w || y >= _h)
+            return false;
+        return _bits[y * _stride + x / 64] >> (x % 64) & 1;
+    }
+
+    bool PixelMask::testRect(int x0, int y0, int x1, int y1) const
+    {
+        math::Vec2i pixel;
+        return findRect(x0, y0, x1, y1, &pixel);
+    }
+
+    bool PixelMask::findRect(int x0, int y0, int x1, int y1, math::Vec2i* pixel) const
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, _w);
+        y1 = std::min(y1, _h);
+
+        for (int y = y1 - 1; y >= y0; --y)
+        {
+            const Span& span = _spans[y];
+            const int begin = std::max(x0, span.begin),
+                      end = std::min(x1, span.end);
+            if (begin >= end)
+                continue;
+
+            const uint64_t* row = &_bits[y * _stride];
+            for (int word = begin / 64, last = (end - 1) / 64; word <= last; ++word)
+            {
+                const int base = word * 64;
+                const uint64_t bits = row[word] & rangeMask(std::max(begin - base, 0), end - base);
+                if (bits)
+                {
+                    pixel->x = base + lowestBit(bits);
+                    pixel->y = y;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    float PixelMask::getDistance(int x, int y) const
+    {
+        if (_w == 0 || _h == 0)
+            return sdf_infinity;
+
+        const int cx = std::min(std::max(x, 0), _w - 1),
+                  cy = std::min(std::max(y, 0), _h - 1);
+        const float dist = _sdf[cy * _w + cx];
+
+        if (cx == x && cy == y)
+            return dist;
+
+        // Outside: at least the distance to the image and at least the
+        // distance of the nearest border pixel minus the way to it.
+        const float border = std::sqrt(float((x - cx) * (x - cx) + (y - cy) * (y - cy)));
+        return std::max(border, dist - border);
+    }
+
+    math::Vec2f PixelMask::getNormal(float x, float y) const
+    {
+        const int cx = std::floor(x),
+                  cy = std::floor(y);
+        math::Vec2f grad(getDistance(cx + 1, cy) - getDistance(cx - 1, cy),
+                         getDistance(cx, cy + 1) - getDistance(cx, cy - 1));
+
+        if (grad.x != 0 || grad.y != 0)
+            return grad.normalized();
+        return grad;
+    }
+
+    void PixelMask::_build()
+    {
+        _spans.assign(_h, { 0, 0 });
+        for (int y = 0; y < _h; ++y)
+        {
+            const uint64_t* row = &_bits[y * _stride];
+            Span& span = _spans[y];
+
+            int first = 0;
+            while (first < _stride && !row[first])
+                ++first;
+            if (first == _stride)
+                continue;
+
+            int last = _stride - 1;
+            while (!row[last])
+                --last;
+
+            int highest = 63;
+            while (!(row[last] >> highest & 1))
+                --highest;
+
+            span.begin = first * 64 + lowestBit(row[first]);
+            span.end = last * 64 + highest + 1;
+        }
+
+        // Distance transforms use a one pixel border of empty pixels, so
+        // solid pixels at the image border are 1 away from empty space.
+        const int pw = _w + 2,
+                  ph = _h + 2;
+        std::vector<float> tosolid(pw * ph), toempty(pw * ph);
+        for (int y = 0; y < ph; ++y)
+            for (int x = 0; x < pw; ++x)
+            {
+                const bool solid = test(x - 1, y - 1);
+                tosolid[y * pw + x] = solid ? 0 : sdf_infinity;
+                toempty[y * pw + x] = solid ? sdf_infinity : 0;
+            }
+
+        distanceTransform(&tosolid, pw, ph);
+        distanceTransform(&toempty, pw, ph);
+
+        _sdf.resize(_w * _h);
+        for (int y = 0; y < _h; ++y)
+            for (int x = 0; x < _w; ++x)
+            {
+                const int i = (y + 1) * pw + x + 1;
+                _sdf[y * _w + x] = std::sqrt(tosolid[i]) - std::sqrt(toempty[i]);
+            }
+    }
+}
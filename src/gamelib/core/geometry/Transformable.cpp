@@ -2,6 +2,7 @@
 #include "gamelib/core/geometry/GroupTransform.hpp"
 #include "gamelib/utils/log.hpp"
 #include "gamelib/utils/conversions.hpp"
+#include <algorithm>
 
 // TODO:
 
@@ -78,6 +79,11 @@ namespace gamelib
             _parent->remove(this);
             _parent = nullptr;
         }
+
+        auto dependents = std::move(_dependents);
+        _dependents.clear();
+        for (auto i : dependents)
+            i->_onSourceDestroyed(this);
     }
 
 
@@ -353,10 +359,24 @@ namespace gamelib
         _updateMatrix();
     }
 
+    void Transformable::addDependent(Transformable* dep) const
+    {
+        if (std::find(_dependents.begin(), _dependents.end(), dep) == _dependents.end())
+            _dependents.push_back(dep);
+    }
+
+    void Transformable::removeDependent(Transformable* dep) const
+    {
+        _dependents.erase(std::remove(_dependents.begin(), _dependents.end(), dep), _dependents.end());
+    }
+
     void Transformable::_markDirty() const
     {
         if (_parent)
             _parent->_dirty = true;
+
+        for (auto i : _dependents)
+            i->_markDirty();
     }
 
 
@@ -145,12 +145,17 @@ namespace gamelib
     }
 
     sf::View Camera::getView(const sf::RenderTarget& target) const
+    {
+        return getView(target.getSize());
+    }
+
+    sf::View Camera::getView(const sf::Vector2u& targetsize) const
     {
         // Can't use the sf::View version of applyAspectRatio() because we
         // want to use the actual size and not the scaled size.
         auto view = getView();
         view.setViewport(convert(
-                    applyAspectRatio(_size, viewport, convert(target.getSize()), ratio)));
+                    applyAspectRatio(_size, viewport, convert(targetsize), ratio)));
         return view;
     }
 
@@ -1,5 +1,6 @@
 #include "gamelib/core/rendering/CameraSystem.hpp"
 #include "gamelib/core/rendering/RenderSystem.hpp"
+#include "gamelib/core/rendering/RenderBackend.hpp"
 #include "gamelib/utils/utils.hpp"
 #include "gamelib/utils/log.hpp"
 
@@ -89,28 +90,57 @@ namespace gamelib
     }
 
     auto CameraSystem::render(const RenderSystem* sys, sf::RenderTarget& target) const -> size_t
+    {
+        SFMLRenderBackend backend(target);
+        return render(sys, backend);
+    }
+
+    auto CameraSystem::render(RenderBackend& backend) const -> size_t
+    {
+        auto sys = getSubsystem<RenderSystem>();
+        if (sys)
+            return render(sys, backend);
+        return 0;
+    }
+
+    auto CameraSystem::render(const RenderSystem* sys, RenderBackend& backend) const -> size_t
     {
         _numrendered = 0;
 
         if (_cams.empty())
         {
-            _numrendered = sys->render(target);
+            _numrendered = sys->render(backend);
         }
         else
         {
-            sf::View reset = target.getView();  // backup current view
+            sf::View reset = backend.getView();  // backup current view
 
+            _active.clear();
+            _rects.clear();
             for (const auto& i : _cams)
             {
                 if (!i->active)
                     continue;
 
-                _currentcam = i;
-                i->apply(target);
-                _numrendered += sys->render(target, i->getBBox());
+                _active.push_back(i);
+                _rects.push_back(i->getBBox());
+            }
+
+            // Build all views' draw calls in parallel, then draw them in order
+            if (_lists.size() < _active.size())
+                _lists.resize(_active.size());
+
+            sys->prepareRender(backend.supportsVertexBuffers());
+            sys->buildRenderLists(_lists.data(), _rects.data(), _active.size());
+
+            for (size_t i = 0; i < _active.size(); ++i)
+            {
+                _currentcam = _active[i];
+                backend.setView(_active[i]->getView(backend.getSize()));
+                _numrendered += sys->draw(backend, _lists[i]);
             }
 
-            target.setView(reset); // reset view
+            backend.setView(reset); // reset view
             _currentcam = nullptr;
         }
 
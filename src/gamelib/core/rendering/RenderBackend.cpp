@@ -0,0 +1,36 @@
+#include "gamelib/core/rendering/RenderBackend.hpp"
+
+namespace gamelib
+{
+    SFMLRenderBackend::SFMLRenderBackend(sf::RenderTarget& target) :
+        _target(target)
+    { }
+
+    auto SFMLRenderBackend::getSize() const -> sf::Vector2u
+    {
+        return _target.getSize();
+    }
+
+    auto SFMLRenderBackend::getView() const -> sf::View
+    {
+        return _target.getView();
+    }
+
+    auto SFMLRenderBackend::setView(const sf::View& view) -> void
+    {
+        _target.setView(view);
+    }
+
+    auto SFMLRenderBackend::draw(const RenderBatch& batch) -> void
+    {
+        if (batch.buffer)
+            _target.draw(*batch.buffer, batch.states);
+        else
+            _target.draw(batch.vertices, batch.size, batch.primitiveType, batch.states);
+    }
+
+    auto SFMLRenderBackend::supportsVertexBuffers() const -> bool
+    {
+        return true;
+    }
+}
@@ -11,10 +11,52 @@ namespace gamelib
         size(0)
     { }
 
+    RenderBatch::RenderBatch() :
+        vertices(nullptr),
+        buffer(nullptr),
+        size(0),
+        primitiveType(sf::Points),
+        numnodes(0)
+    { }
+
+    RenderList::RenderList() :
+        numrendered(0),
+        _system(nullptr),
+        _generation(0),
+        _moved(0),
+        _hasview(false),
+        _renderboxes(false)
+    { }
+
+    auto RenderList::clear() -> void
+    {
+        batches.clear();
+        debugboxes.clear();
+        numrendered = 0;
+        _vertices.clear();
+        _offsets.clear();
+        _indices.clear();
+        _items.clear();
+        _transforms.clear();
+        _bboxes.clear();
+        _drawn.clear();
+        _drawnoffsets.clear();
+        _system = nullptr;
+    }
+
     RenderNode::RenderNode() :
         depth(0),
         owner(nullptr),
-        _bboxdirty(false)
+        _flags(0),
+        _parallax(1),
+        _bboxdirty(false),
+        _chunk(-1),
+        _bakedirty(false),
+        _proxy(-1),
+        _sortkey(0),
+        _sequence(0),
+        _reorder(false),
+        _queueindex(-1)
     { }
 
 
@@ -47,6 +89,11 @@ namespace gamelib
     }
 
     auto RenderOptions::isVisible() const -> bool
+    {
+        return isVisible(flags);
+    }
+
+    auto RenderOptions::isVisible(unsigned int flags) -> bool
     {
         return !(flags & render_invisible ||
                 (flags & render_hidden && !(flags & render_drawhidden)));
@@ -54,4 +101,87 @@ namespace gamelib
 
 
     const RenderOptions RenderOptions::defaultOptions;
+
+
+    auto getBatchPrimitiveType(sf::PrimitiveType type) -> sf::PrimitiveType
+    {
+        switch (type)
+        {
+            case sf::Lines:
+            case sf::LineStrip:
+                return sf::Lines;
+            case sf::Triangles:
+            case sf::TriangleStrip:
+            case sf::TriangleFan:
+            case sf::Quads:
+                return sf::Triangles;
+            default:
+                return sf::Points;
+        }
+    }
+
+    auto getBatchVertexCount(size_t size, sf::PrimitiveType type) -> size_t
+    {
+        switch (type)
+        {
+            case sf::Lines:
+                return size / 2 * 2;
+            case sf::LineStrip:
+                return size < 2 ? 0 : (size - 1) * 2;
+            case sf::Triangles:
+                return size / 3 * 3;
+            case sf::TriangleStrip:
+            case sf::TriangleFan:
+                return size < 3 ? 0 : (size - 2) * 3;
+            case sf::Quads:
+                return size / 4 * 6;
+            default:
+                return size;
+        }
+    }
+
+    auto writeBatchVertices(sf::Vertex* out, const sf::Vertex* vertices, size_t size,
+            sf::PrimitiveType type, const sf::Transform& trans) -> void
+    {
+        auto push = [&](size_t i) {
+            *out = vertices[i];
+            out->position = trans.transformPoint(vertices[i].position);
+            ++out;
+        };
+
+        switch (type)
+        {
+            case sf::Lines:
+                for (size_t i = 0; i + 1 < size; i += 2)
+                    push(i), push(i + 1);
+                break;
+            case sf::LineStrip:
+                for (size_t i = 1; i < size; ++i)
+                    push(i - 1), push(i);
+                break;
+            case sf::Triangles:
+                for (size_t i = 0; i + 2 < size; i += 3)
+                    push(i), push(i + 1), push(i + 2);
+                break;
+            case sf::TriangleStrip:
+                for (size_t i = 2; i < size; ++i)
+                    push(i - 2), push(i - 1), push(i);
+                break;
+            case sf::TriangleFan:
+                for (size_t i = 2; i < size; ++i)
+                    push(0), push(i - 1), push(i);
+                break;
+            case sf::Quads:
+                for (size_t i = 0; i + 3 < size; i += 4)
+                {
+                    push(i), push(i + 1), push(i + 2);
+                    push(i), push(i + 2), push(i + 3);
+                }
+                break;
+            default:
+                for (size_t i = 0; i < size; ++i)
+                    push(i);
+                break;
+        }
+    }
 }
@@ -1,7 +1,10 @@
 #include "gamelib/core/rendering/RenderSystem.hpp"
+#include "gamelib/core/rendering/RenderBackend.hpp"
 #include "gamelib/core/rendering/flags.hpp"
+#include "gamelib/core/geometry/Broadphase.hpp"
 #include "gamelib/utils/log.hpp"
 #include "gamelib/utils/conversions.hpp"
+#include "gamelib/utils/ScratchBuffer.hpp"
 #include "math/geometry/PointSet.hpp"
 #include "math/geometry/mesh_intersect.hpp"
 #include "gamelib/json/json-rendering.hpp"
@@ -64,6 +67,40 @@ namespace gamelib
         return math::AABBf(min.asPoint(), max - min);
     }
 
+    // True if p is on the border of bbox, i.e. the bbox might shrink if p
+    // moves. Tolerant against rounding of bbox.x + bbox.w.
+    bool isOnBBoxBorder(const math::AABBf& bbox, const sf::Vector2f& p)
+    {
+        const float epsx = 1e-5f * (std::abs(bbox.x) + bbox.w + 1),
+                    epsy = 1e-5f * (std::abs(bbox.y) + bbox.h + 1);
+        return p.x <= bbox.x + epsx || p.x >= bbox.x + bbox.w - epsx
+            || p.y <= bbox.y + epsy || p.y >= bbox.y + bbox.h - epsy;
+    }
+
+    // Extends bbox to contain the given vertices. Returns true if it changed.
+    bool extendBBox(math::AABBf* bbox, const sf::Vertex* vertices, size_t size)
+    {
+        math::Vec2f min(bbox->x, bbox->y),
+                    max(bbox->x + bbox->w, bbox->y + bbox->h);
+        bool changed = false;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            const math::Vec2f& p = convert(vertices[i].position);
+            for (int k = 0; k < 2; ++k)
+            {
+                if (p[k] < min[k])
+                    min[k] = p[k], changed = true;
+                else if (p[k] > max[k])
+                    max[k] = p[k], changed = true;
+            }
+        }
+
+        if (changed)
+            *bbox = math::AABBf(min.asPoint(), max - min);
+        return changed;
+    }
+
     class VertexPointSet: public math::AbstractPointSet<float>
     {
         public:
@@ -98,12 +135,71 @@ namespace gamelib
             const sf::Vertex* _array;
     };
 
+    bool canBatch(const sf::RenderStates& a, const sf::RenderStates& b)
+    {
+        return a.texture == b.texture && a.shader == b.shader && a.blendMode == b.blendMode;
+    }
+
+    void appendBatchVertices(std::vector<sf::Vertex>* out, const sf::Vertex* vertices, size_t size,
+            sf::PrimitiveType type, const sf::Transform& trans)
+    {
+        const size_t offset = out->size();
+        out->resize(offset + getBatchVertexCount(size, type));
+        writeBatchVertices(out->data() + offset, vertices, size, type, trans);
+    }
+
+    // Render list items, i.e. what to do with a visited node
+    constexpr uint8_t item_visible  = 1;        // passed visibility checks
+    constexpr uint8_t item_draw     = 1 << 1;   // passed culling
+    constexpr uint8_t item_debugbox = 1 << 2;   // draw the parallax bbox
+    constexpr uint8_t item_chunk    = 1 << 3;   // baked into a static chunk
+
+    // Nodes per task when building render lists in parallel
+    constexpr size_t render_rangesize = 1024;
+
+    // Moved bboxes logged before all cached visible sets are dropped instead
+    constexpr size_t max_movedboxes = 4096;
+
+    // Dirty vertex ranges kept before they are merged into one
+    constexpr size_t max_dirtyranges = 4096;
+
+    // Calls f(begin, end) for ranges of [0, num), in parallel if a pool is given
+    template <typename F>
+    void forRanges(ThreadPool* pool, size_t num, F f)
+    {
+        const size_t numranges = (num + render_rangesize - 1) / render_rangesize;
+
+        if (!pool || numranges < 2)
+        {
+            f(0, num);
+            return;
+        }
+
+        pool->run(numranges, [&](size_t i) {
+                f(i * render_rangesize, std::min(num, (i + 1) * render_rangesize));
+            });
+    }
 
 
 	RenderSystem::RenderSystem() :
         renderBoxes(false),
+        batching(true),
+        threads(ThreadPool::getDefaultThreads()),
+        cullMargin(64),
+        compactBudget(4096),
+        _nextsequence(0),
         _numrendered(0),
-        _orderdirty(true)
+        _numdrawcalls(0),
+        _drawdirty(false),
+        _optionsdirty(false),
+        _staticdirty(false),
+        _staticorderdirty(false),
+        _parallaxdirty(false),
+        _queuedirty(false),
+        _orderdirty(false),
+        _visgeneration(0),
+        _movedbase(0),
+        _dirtymerged(true)
 	{ }
 
 
@@ -114,7 +210,22 @@ namespace gamelib
         _vertices.clear();
         _dirtylist.clear();
         _renderqueue.clear();
+        _queuepending.clear();
+        _list.clear();
+        _draw = DrawData();
+        _chunks.clear();
+        _staticruns.clear();
+        _grid.clear();
+        _parallaxnodes.clear();
+        _staticdirty = false;
+        _staticorderdirty = false;
+        _parallaxdirty = false;
+        _drawdirty = false;
+        _optionsdirty = false;
+        _queuedirty = false;
         _orderdirty = false;
+        _invalidateVisibleSets();
+        clearDirtyVertexRanges();
         renderBoxes = false;
     }
 
@@ -125,6 +236,7 @@ namespace gamelib
         _layers.clear();
         _root = RenderOptions();
         _numrendered = 0;
+        _numdrawcalls = 0;
     }
 
 
@@ -132,6 +244,7 @@ namespace gamelib
     {
         NodeHandle handle = _nodes.acquire();
         _nodes[handle].owner = owner;
+        _resolveOptions(handle);
         // don't add to queue, because there's no mesh yet
         LOG_DEBUG("Created RenderNode");
         return handle;
@@ -140,8 +253,15 @@ namespace gamelib
     auto RenderSystem::removeNode(NodeHandle handle) -> void
     {
         ASSURE_VALID(handle);
+
+        if (_nodes[handle]._proxy >= 0)
+            _grid.remove(_nodes[handle]._proxy);
+
+        // Dropped from the queue on the next update
+        if (_nodes[handle].mesh.handle.isValid())
+            _queuedirty = true;
+
         _nodes.destroy(handle);
-        _orderdirty = true;
     }
 
     auto RenderSystem::getNode(NodeHandle handle) const -> const RenderNode*
@@ -192,7 +312,12 @@ namespace gamelib
     auto RenderSystem::setNodeOptions(NodeHandle handle, const RenderOptions& options) -> void
     {
         ASSURE_VALID(handle);
+        _markStaticDirty(handle);
         _nodes[handle].options = options;
+        _resolveOptions(handle);
+        _markStaticDirty(handle);
+        _parallaxdirty = true;
+        _drawdirty = true;
     }
 
     auto RenderSystem::setNodeOptions(
@@ -217,8 +342,11 @@ namespace gamelib
     auto RenderSystem::setNodeDepth(NodeHandle handle, int depth) -> void
     {
         ASSURE_VALID(handle);
-        _nodes[handle].depth = depth;
-        _orderdirty = true;
+        if (_nodes[handle].depth != depth)
+        {
+            _nodes[handle].depth = depth;
+            _queueNode(handle);
+        }
     }
 
     auto RenderSystem::setNodeLayer(NodeHandle handle, LayerHandle layer) -> void
@@ -231,14 +359,24 @@ namespace gamelib
             return;
         }
 
+        _markStaticDirty(handle);
         _nodes[handle].layer = layer;
-        _orderdirty = true;
+        _resolveOptions(handle);
+        _markStaticDirty(handle);
+        _parallaxdirty = true;
+        _queueNode(handle);
     }
 
     auto RenderSystem::setNodeTransform(NodeHandle handle, const sf::Transform& transform) -> void
     {
         ASSURE_VALID(handle);
-        _nodes[handle].transform = transform;
+
+        // Avoid rebaking when the owner just updates the transform every frame
+        RenderNode& node = _nodes[handle];
+        if (node.transform != transform)
+            _markStaticDirty(handle);
+
+        node.transform = transform;
         _markBBoxDirty(handle);
     }
 
@@ -249,17 +387,29 @@ namespace gamelib
 
         RenderNode& node = _nodes[handle];
 
-        // Add to queue if there was no mesh yet
-        if (!node.mesh.handle.isValid())
+        // Add to queue if there was no mesh yet.
+        // The sequence number is kept when the node is reordered later, so
+        // nodes with equal depth stay in the order they were added.
+        if (!node.mesh.handle.isValid() && !node._reorder)
         {
-            _renderqueue.push_back(handle);
-            _orderdirty = true;
+            node._sequence = _nextsequence++;
+            node._reorder = true;
+            _queuepending.push_back(handle);
         }
 
+        _markStaticDirty(handle);
         _freeMesh(handle);
         node.mesh.handle = _vertices.allocate(size);
         node.mesh.primitiveType = type;
         node.mesh.size = size;
+        node._proxy = _grid.add(handle, node._globalBBox);
+        _drawdirty = true;
+
+        // Reused blocks contain old vertices, reset them to match the empty
+        // bbox, so later updates can extend it
+        sf::Vertex* vertices = _vertices.get(node.mesh.handle.index);
+        std::fill(vertices, vertices + size, sf::Vertex());
+        _markVerticesDirty(node.mesh.handle.index, node.mesh.handle.index + size);
         // don't update bbox, because there is no vertex data yet
     }
 
@@ -278,35 +428,85 @@ namespace gamelib
     {
         ASSURE_VALID(handle);
         CHECK_MESH_BOUNDS(handle, 0);
-        size_t stop = offset + size;
-        Mesh& mesh = _nodes[handle].mesh;
+        const Mesh& mesh = _nodes[handle].mesh;
+        const size_t stop = _clipMeshUpdate(mesh, size, offset);
+        sf::Vertex* out = _vertices.get(mesh.handle.index);
+        size_t first = stop, last = 0;     // changed vertices
+        bool moved = false, border = false;
+
+        // One pass per stream
+        if (vertices)
+            for (size_t i = offset; i < stop; ++i)
+                if (out[i].position != vertices[i - offset])
+                {
+                    border = border || isOnBBoxBorder(mesh.bbox, out[i].position);
+                    out[i].position = vertices[i - offset];
+                    first = std::min(first, i);
+                    last = i + 1;
+                    moved = true;
+                }
 
-        if (mesh.handle.size < stop)
-            LOG_WARN("Trying to assign more vertices than space allocated -> Clipping to maximum");
+        if (uvs)
+            for (size_t i = offset; i < stop; ++i)
+                if (out[i].texCoords != uvs[i - offset])
+                {
+                    out[i].texCoords = uvs[i - offset];
+                    first = std::min(first, i);
+                    last = std::max(last, i + 1);
+                }
+
+        if (colors)
+            for (size_t i = offset; i < stop; ++i)
+                if (out[i].color != colors[i - offset])
+                {
+                    out[i].color = colors[i - offset];
+                    first = std::min(first, i);
+                    last = std::max(last, i + 1);
+                }
 
-        stop = std::min(stop, mesh.handle.size);
-        bool sizechanged = updateSize && stop != mesh.size;
+        _finishMeshUpdate(handle, first, last, updateSize ? stop : mesh.size, moved, border);
+    }
 
-        if (sizechanged)
-            mesh.size = stop;
+    auto RenderSystem::updateNodeMeshVertices(
+            NodeHandle handle, size_t size, size_t offset,
+            const sf::Vertex* vertices, bool updateSize)
+        -> void
+    {
+        ASSURE_VALID(handle);
+        CHECK_MESH_BOUNDS(handle, 0);
+        const Mesh& mesh = _nodes[handle].mesh;
+        const size_t stop = _clipMeshUpdate(mesh, size, offset);
+        sf::Vertex* out = _vertices.get(mesh.handle.index);
+        size_t first = stop, last = 0;
+        bool moved = false, border = false;
 
         for (size_t i = offset; i < stop; ++i)
         {
-            sf::Vertex& v = *_vertices.get(mesh.handle.index + i);
+            const sf::Vertex& v = vertices[i - offset];
+            if (out[i].position != v.position)
+            {
+                border = border || isOnBBoxBorder(mesh.bbox, out[i].position);
+                moved = true;
+            }
+            else if (out[i].texCoords == v.texCoords && out[i].color == v.color)
+                continue;
 
-            if (vertices) v.position  = vertices[i - offset];
-            if (uvs)      v.texCoords = uvs[i - offset];
-            if (colors)   v.color     = colors[i - offset];
+            first = std::min(first, i);
+            last = i + 1;
         }
 
-        if (vertices || sizechanged)
-            _updateMeshBBox(handle);
+        if (first < last)
+            std::copy(vertices + (first - offset), vertices + (last - offset), out + first);
+
+        _finishMeshUpdate(handle, first, last, updateSize ? stop : mesh.size, moved, border);
     }
 
     auto RenderSystem::setNodeMeshType(NodeHandle handle, sf::PrimitiveType type) -> void
     {
         ASSURE_VALID(handle);
         _nodes[handle].mesh.primitiveType = type;
+        _markStaticDirty(handle);
+        _drawdirty = true;
     }
 
     auto RenderSystem::setNodeMeshSize(NodeHandle handle, size_t size) -> void
@@ -314,6 +514,7 @@ namespace gamelib
         ASSURE_VALID(handle);
         CHECK_MESH_BOUNDS(handle, size == 0 ? 0 : size - 1);
         _nodes[handle].mesh.size = size;
+        _markStaticDirty(handle);
         _updateMeshBBox(handle);
     }
 
@@ -321,6 +522,8 @@ namespace gamelib
     auto RenderSystem::setRootOptions(const RenderOptions& options) -> void
     {
         _root = options;
+        _staticdirty = true;
+        _optionsdirty = true;
     }
 
     auto RenderSystem::setRootOptions(
@@ -351,13 +554,28 @@ namespace gamelib
         return _numrendered;
 	}
 
+    auto RenderSystem::getNumDrawCalls() const -> size_t
+    {
+        return _numdrawcalls;
+    }
+
+    auto RenderSystem::getVertexAllocator() const -> const BatchAllocator<sf::Vertex>&
+    {
+        return _vertices;
+    }
+
     auto RenderSystem::forceUpdate() const -> void
     {
         // Should be safe, because why would you instantiate a const RenderSystem?
         // Easier than to add mutable and const on half of the members.
         RenderSystem* self = const_cast<RenderSystem*>(this);
-        self->_updateDirty();
         self->_updateQueue();
+        self->_updateDirty();
+        self->_updateOptions();
+        self->_updateParallax();
+        self->_bakeStatic();
+        self->_updateDrawData();
+        self->_compactVertices();
     }
 
     auto RenderSystem::render(sf::RenderTarget& target, const math::AABBf& rect) const -> size_t
@@ -367,107 +585,360 @@ namespace gamelib
 
     auto RenderSystem::render(sf::RenderTarget& target, const math::AABBf* rect) const -> size_t
     {
-        _numrendered = 0;
+        SFMLRenderBackend backend(target);
+        return render(backend, rect);
+    }
 
-        if (_root.flags & render_invisible)
-            return 0;
+    auto RenderSystem::render(RenderBackend& backend, const math::AABBf* rect) const -> size_t
+    {
+        prepareRender(backend.supportsVertexBuffers());
+        buildRenderList(&_list, rect);
+        return draw(backend, _list);
+    }
 
+    auto RenderSystem::prepareRender(bool upload) const -> void
+    {
         forceUpdate();
+        if (upload)
+            _uploadStatic();    // requires a GL context, i.e. a render target
+    }
 
-        RenderOptions parent = _root;
-        LayerHandle currentlayer;
+    auto RenderSystem::buildRenderList(RenderList* list, const math::AABBf* rect) const -> void
+    {
+        _buildRenderList(list, rect, true);
+    }
 
-        for (NodeHandle handle : _renderqueue)
+    auto RenderSystem::buildRenderLists(RenderList* lists, const math::AABBf* rects, size_t num) const -> void
+    {
+        // Build one view per thread, or split the view if there is only one
+        ThreadPool* pool = num > 1 ? _getThreadPool() : nullptr;
+
+        if (!pool)
         {
-            const RenderNode& node = _nodes[handle];
-            const Mesh& mesh = node.mesh;
+            for (size_t i = 0; i < num; ++i)
+                _buildRenderList(&lists[i], &rects[i], true);
+            return;
+        }
 
-            if (mesh.size == 0)
-                continue;
+        pool->run(num, [&](size_t i) {
+                _buildRenderList(&lists[i], &rects[i], false);
+            });
+    }
 
-            if (mesh.size == 1 && mesh.primitiveType != sf::Points)
-                continue;
+    auto RenderSystem::draw(sf::RenderTarget& target, const RenderList& list) const -> size_t
+    {
+        SFMLRenderBackend backend(target);
+        return draw(backend, list);
+    }
 
-            if (mesh.size == 2 && mesh.primitiveType != sf::Points
-                    && mesh.primitiveType != sf::Lines
-                    && mesh.primitiveType != sf::LineStrip)
-                continue;
+    auto RenderSystem::draw(RenderBackend& backend, const RenderList& list) const -> size_t
+    {
+        for (const RenderBatch& batch : list.batches)
+            backend.draw(batch);
+
+        if (!list.debugboxes.empty())
+        {
+            std::vector<sf::Vertex> outlines;
+            outlines.reserve(list.debugboxes.size() * 8);
+            for (const math::AABBf& bbox : list.debugboxes)
+            {
+                const sf::Vector2f corners[] = {
+                    sf::Vector2f(bbox.x, bbox.y),
+                    sf::Vector2f(bbox.x + bbox.w, bbox.y),
+                    sf::Vector2f(bbox.x + bbox.w, bbox.y + bbox.h),
+                    sf::Vector2f(bbox.x, bbox.y + bbox.h)
+                };
+
+                for (int i = 0; i < 4; ++i)
+                {
+                    outlines.emplace_back(corners[i], sf::Color::White);
+                    outlines.emplace_back(corners[(i + 1) % 4], sf::Color::White);
+                }
+            }
 
-            // Update current layer
-            if (node.layer != currentlayer)
+            RenderBatch batch;
+            batch.vertices = outlines.data();
+            batch.size = outlines.size();
+            batch.primitiveType = sf::Lines;
+            backend.draw(batch);
+        }
+
+        _numrendered = list.numrendered;
+        _numdrawcalls = list.batches.size();
+        return list.numrendered;
+    }
+
+    auto RenderSystem::updateBatches(const math::AABBf* rect) const -> const BatchList&
+    {
+        forceUpdate();
+        buildRenderList(&_list, rect);
+        _numrendered = _list.numrendered;
+        _numdrawcalls = _list.batches.size();
+        return _list.batches;
+    }
+
+    auto RenderSystem::_buildRenderList(RenderList* list, const math::AABBf* rect, bool parallel) const -> void
+    {
+        constexpr size_t npos = -1;
+
+        // Keep the visible set, only drop the previous draw calls
+        list->batches.clear();
+        list->debugboxes.clear();
+        list->numrendered = 0;
+        list->_vertices.clear();
+        list->_offsets.clear();
+        list->_drawn.clear();
+        list->_drawnoffsets.clear();
+
+        if (_root.flags & render_invisible)
+            return;
+
+        const bool reuse = _isVisibleSetValid(list, rect);
+        const bool reuseview = reuse && list->_renderboxes == renderBoxes
+            && (!rect || (list->_view.x == rect->x && list->_view.y == rect->y
+                        && list->_view.w == rect->w && list->_view.h == rect->h));
+
+        // Only visit nodes near the view rect, in render queue order
+        auto& indices = list->_indices;
+        if (rect && !reuse)
+        {
+            list->_region = math::AABBf(rect->x - cullMargin, rect->y - cullMargin,
+                    rect->w + 2 * cullMargin, rect->h + 2 * cullMargin);
+
+            ScratchBuffer<NodeHandle> candidates;
+            _grid.query(list->_region, &candidates.get());
+            candidates->insert(candidates->end(), _parallaxnodes.begin(), _parallaxnodes.end());
+
+            indices.clear();
+            for (NodeHandle handle : *candidates)
+                indices.push_back(_nodes[handle]._queueindex);
+
+            std::sort(indices.begin(), indices.end());
+            indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        }
+
+        const size_t num = rect ? indices.size() : _renderqueue.size();
+        ThreadPool* pool = parallel && num >= 2 * render_rangesize ? _getThreadPool() : nullptr;
+
+        // Culling and parallax in parallel
+        if (!reuseview)
+        {
+            list->_items.resize(num);
+            list->_transforms.resize(num);
+            list->_bboxes.resize(num);
+
+            forRanges(pool, num, [&](size_t begin, size_t end) {
+                    for (size_t k = begin; k < end; ++k)
+                        list->_items[k] = _cullNode(rect ? indices[k] : k, rect,
+                                &list->_transforms[k], &list->_bboxes[k]);
+                });
+        }
+
+        list->_system = this;
+        list->_generation = _visgeneration;
+        list->_moved = _movedbase + _movedboxes.size();
+        list->_view = rect ? *rect : math::AABBf();
+        list->_hasview = rect != nullptr;
+        list->_renderboxes = renderBoxes;
+
+        // Form batches and reserve space for merged vertices
+        auto& batches = list->batches;
+        size_t numvertices = 0;
+        size_t batchbegin = 0;  // first drawn node of the last batch
+        bool lastbatchable = false;
+        int lastchunk = -1;
+
+        for (size_t k = 0; k < num; ++k)
+        {
+            const size_t i = rect ? indices[k] : k;
+            const uint8_t item = list->_items[k];
+
+            // Baked nodes are drawn once per chunk
+            if (item & item_chunk)
             {
-                auto layerptr = _layers.get(node.layer);
-                parent = !layerptr ? _root : layerptr->options.inherited(_root);
-                currentlayer = node.layer;
+                const int chunkindex = _draw.chunks[i];
+                if (chunkindex == lastchunk)
+                    continue;
+
+                lastchunk = chunkindex;
+                lastbatchable = false;
+                const StaticChunk& chunk = _chunks[chunkindex];
+
+                if (rect && !math::intersect(*rect, chunk.bbox))
+                    continue;
+
+                batches.emplace_back();
+                RenderBatch& batch = batches.back();
+                batch.vertices = chunk.vertices.empty() ? nullptr : chunk.vertices.data();
+                batch.buffer = chunk.buffer.getVertexCount() > 0 ? &chunk.buffer : nullptr;
+                batch.size = chunk.buffer.getVertexCount() > 0 ? chunk.buffer.getVertexCount() : chunk.vertices.size();
+                batch.primitiveType = chunk.primitiveType;
+                batch.states = chunk.states;
+                batch.numnodes = chunk.nodes.size();
+                list->_offsets.push_back(npos);
+                list->numrendered += chunk.nodes.size();
+                continue;
             }
 
-            RenderOptions options = node.options.inherited(parent);
+            if (!(item & item_visible))
+                continue;
+
+            const math::AABBf& bbox = list->_bboxes[k];
+
+            if (bbox.w == 0 || bbox.h == 0)
+                LOG_WARN("RenderNode bounding box has 0 width or height: ", bbox.w, "x", bbox.h);
+
+            if (item & item_debugbox)
+                list->debugboxes.push_back(bbox);
 
-            if (!options.isVisible())
+            if (!(item & item_draw))
                 continue;
 
-            sf::Transform trans;    // parallax transform
-            math::AABBf bbox = node._globalBBox;
-            float parallax = options.parallax;
+            // TODO: wireframe
+
+            ++list->numrendered;
+
+            const size_t size = _draw.sizes[i];
+            const sf::PrimitiveType type = _draw.types[i];
+            const unsigned int flags = _draw.flags[i];
+            sf::RenderStates states = _draw.states[i];
+            states.transform = list->_transforms[k];
+            const bool batchable = batching && !(flags & render_nobatch);
 
-            if (!(options.flags & render_noparallax) && !math::almostEquals(parallax, 1.0f))
+            if (batchable && lastbatchable
+                    && getBatchPrimitiveType(batches.back().primitiveType) == getBatchPrimitiveType(type)
+                    && canBatch(batches.back().states, states))
             {
-                // If a camera is given, scale around camera center, otherwise,
-                // when rendering the whole scene, scale around object center.
-                math::Point2f vcenter = (rect ? rect : &bbox)->getCenter();
-                math::Vec2f translate = (bbox.getCenter() - vcenter) * (parallax - 1);
-                bbox.pos += translate;
+                RenderBatch& batch = batches.back();
+                size_t& offset = list->_offsets.back();
 
-                if (options.flags & render_scaleparallax)
+                // Second node -> move the first one to the vertex buffer
+                if (offset == npos)
                 {
-                    trans.scale(parallax, parallax, vcenter.x, vcenter.y);
-                    bbox.extend(bbox.size * parallax - bbox.size);
+                    offset = numvertices;
+                    list->_drawnoffsets[batchbegin] = numvertices;
+                    numvertices += getBatchVertexCount(batch.size, batch.primitiveType);
+                    batch.primitiveType = getBatchPrimitiveType(batch.primitiveType);
+                    batch.states.transform = sf::Transform::Identity;
                 }
-                else
-                    trans.translate(translate.x, translate.y);
 
-                trans *= node.transform;
+                list->_drawn.push_back(k);
+                list->_drawnoffsets.push_back(numvertices);
+                numvertices += getBatchVertexCount(size, type);
+                batch.size = numvertices - offset;
+                ++batch.numnodes;
+            }
+            else
+            {
+                // Draw the node's own mesh until another node is merged
+                batches.emplace_back();
+                RenderBatch& batch = batches.back();
+                batch.vertices = _vertices.get(_draw.vertices[i]);
+                batch.size = size;
+                batch.primitiveType = type;
+                batch.states = states;
+                batch.numnodes = 1;
+                list->_offsets.push_back(npos);
+                batchbegin = list->_drawn.size();
+                list->_drawn.push_back(k);
+                list->_drawnoffsets.push_back(npos);
+                lastbatchable = batchable;
+            }
+        }
 
-                if (renderBoxes)
+        // Fill merged vertices in parallel
+        list->_vertices.resize(numvertices);
+        forRanges(pool, list->_drawn.size(), [&](size_t begin, size_t end) {
+                for (size_t d = begin; d < end; ++d)
                 {
-                    sf::RectangleShape noderect(convert(bbox.size));
-                    noderect.setFillColor(sf::Color::Transparent);
-                    noderect.setOutlineColor(sf::Color::White);
-                    noderect.setOutlineThickness(1);
-                    noderect.setPosition(convert(bbox.pos));
-                    target.draw(noderect);
+                    const size_t offset = list->_drawnoffsets[d];
+                    if (offset == npos)
+                        continue;
+
+                    const size_t k = list->_drawn[d];
+                    const size_t i = rect ? indices[k] : k;
+                    writeBatchVertices(list->_vertices.data() + offset, _vertices.get(_draw.vertices[i]),
+                            _draw.sizes[i], _draw.types[i], list->_transforms[k]);
                 }
-            }
-            else
-                trans = node.transform;
+            });
 
-            if (bbox.w == 0 || bbox.h == 0)
-                LOG_WARN("RenderNode bounding box has 0 width or height: ", bbox.w, "x", bbox.h);
+        for (size_t i = 0; i < batches.size(); ++i)
+            if (list->_offsets[i] != npos)
+                batches[i].vertices = list->_vertices.data() + list->_offsets[i];
+    }
 
-            // culling by bbox check
-            if (rect && !math::intersect(*rect, bbox))
-                continue;
+    auto RenderSystem::_cullNode(size_t index, const math::AABBf* rect, sf::Transform* trans, math::AABBf* bbox) const -> uint8_t
+    {
+        if (_draw.chunks[index] >= 0)
+            return item_chunk;
 
-            // TODO: wireframe
+        const size_t size = _draw.sizes[index];
+        const sf::PrimitiveType type = _draw.types[index];
+
+        if (size == 0)
+            return 0;
+
+        if (size == 1 && type != sf::Points)
+            return 0;
+
+        if (size == 2 && type != sf::Points
+                && type != sf::Lines
+                && type != sf::LineStrip)
+            return 0;
+
+        const unsigned int flags = _draw.flags[index];
+
+        if (!RenderOptions::isVisible(flags))
+            return 0;
+
+        uint8_t item = item_visible;
+        const float parallax = _draw.parallax[index];
+        *trans = _draw.states[index].transform;
+        *bbox = _draw.bboxes[index];
+
+        if (!(flags & render_noparallax) && !math::almostEquals(parallax, 1.0f))
+        {
+            sf::Transform ptrans;   // parallax transform
+
+            // If a camera is given, scale around camera center, otherwise,
+            // when rendering the whole scene, scale around object center.
+            math::Point2f vcenter = (rect ? rect : bbox)->getCenter();
+            math::Vec2f translate = (bbox->getCenter() - vcenter) * (parallax - 1);
+            bbox->pos += translate;
+
+            if (flags & render_scaleparallax)
+            {
+                ptrans.scale(parallax, parallax, vcenter.x, vcenter.y);
+                bbox->extend(bbox->size * parallax - bbox->size);
+            }
+            else
+                ptrans.translate(translate.x, translate.y);
 
-            target.draw(
-                    _vertices.get(mesh.handle.index), mesh.size, mesh.primitiveType,
-                    sf::RenderStates(options.blendMode, trans, options.texture.get(), options.shader));
+            *trans = ptrans * *trans;
 
-            ++_numrendered;
+            if (renderBoxes)
+                item |= item_debugbox;
         }
 
-        return _numrendered;
+        // culling by bbox check
+        if (rect && !math::intersect(*rect, *bbox))
+            return item;
+
+        return item | item_draw;
     }
 
     auto RenderSystem::getNodeAtPosition(const math::Point2f& pos) const -> NodeHandle
     {
         forceUpdate();
 
-        for (auto it = _renderqueue.rbegin(), end = _renderqueue.rend(); it != end; ++it)
-        {
-            NodeHandle handle = *it;
+        ScratchBuffer<NodeHandle> candidates;
+        _grid.query(math::AABBf(pos.x - 0.5, pos.y - 0.5, 1, 1), &candidates.get());
+        std::sort(candidates->begin(), candidates->end(), [this](NodeHandle a, NodeHandle b) {
+                return _nodes[a]._queueindex > _nodes[b]._queueindex;
+            });
 
+        for (NodeHandle handle : *candidates)
+        {
             if (!getNodeVisible(handle))
                 continue;
 
@@ -520,6 +991,9 @@ namespace gamelib
     {
         ASSURE_LAYER_VALID(handle);
         _layers.destroy(handle);
+        _staticdirty = true;
+        _optionsdirty = true;
+        _orderdirty = true;     // nodes fall back to depth 0
     }
 
     auto RenderSystem::getLayer(LayerHandle handle) const -> const RenderLayer*
@@ -571,6 +1045,8 @@ namespace gamelib
     {
         ASSURE_LAYER_VALID(handle);
         _layers[handle].options = options;
+        _staticdirty = true;
+        _optionsdirty = true;
     }
 
     auto RenderSystem::setLayerOptions(
@@ -601,8 +1077,25 @@ namespace gamelib
         // LOG_DEBUG("Recalculating global node transforms and bboxs: ", _dirtylist.size());
 
         for (NodeHandle handle : _dirtylist)
-            if (_nodes.isValid(handle))
-                _updateNodeGlobalBBox(handle);
+        {
+            if (!_nodes.isValid(handle))
+                continue;
+
+            // Update the grid unconditionally, the bbox might have been
+            // updated already by getNodeGlobalBBox()
+            const RenderNode& node = _nodes[handle];
+            _updateNodeGlobalBBox(handle);
+            if (node._proxy >= 0)
+            {
+                const math::AABBf oldbbox = _grid.getBBox(node._proxy);
+                _grid.update(node._proxy, node._globalBBox);
+                _markMoved(node, oldbbox);
+            }
+
+            // Update moved nodes in place, unless everything is rebuilt anyway
+            if (!_drawdirty && node._queueindex < _renderqueue.size())
+                _syncDrawData(node);
+        }
 
         _dirtylist.clear();
     }
@@ -631,6 +1124,40 @@ namespace gamelib
         _markBBoxDirty(handle);
     }
 
+    auto RenderSystem::_clipMeshUpdate(const Mesh& mesh, size_t size, size_t offset) const -> size_t
+    {
+        if (mesh.handle.size < offset + size)
+            LOG_WARN("Trying to assign more vertices than space allocated -> Clipping to maximum");
+        return std::min(offset + size, mesh.handle.size);
+    }
+
+    auto RenderSystem::_finishMeshUpdate(NodeHandle handle, size_t first, size_t last, size_t size, bool moved, bool border) -> void
+    {
+        Mesh& mesh = _nodes[handle].mesh;
+        const bool sizechanged = size != mesh.size;
+
+        if (first < last)
+            _markVerticesDirty(mesh.handle.index + first, mesh.handle.index + last);
+
+        if (first < last || sizechanged)
+            _markStaticDirty(handle);
+
+        if (sizechanged)
+        {
+            mesh.size = size;
+            _updateMeshBBox(handle);
+        }
+        else if (moved && first < mesh.size)
+        {
+            // Moving a vertex away from the border might shrink the bbox,
+            // otherwise it only grows by the changed vertices
+            if (border || mesh.size < 2)
+                _updateMeshBBox(handle);
+            else if (extendBBox(&mesh.bbox, _vertices.get(mesh.handle.index + first), std::min(last, mesh.size) - first))
+                _markBBoxDirty(handle);
+        }
+    }
+
     auto RenderSystem::_freeMesh(NodeHandle handle) -> void
     {
         ASSURE_VALID(handle);
@@ -645,6 +1172,401 @@ namespace gamelib
             _nodes[handle]._globalBBox = math::AABBf();
             _nodes[handle]._bboxdirty = false;
         }
+
+        if (_nodes[handle]._proxy >= 0)
+        {
+            _grid.remove(_nodes[handle]._proxy);
+            _nodes[handle]._proxy = -1;
+        }
+    }
+
+    auto RenderSystem::_isNodeStatic(const RenderNode& node) const -> bool
+    {
+        unsigned int flags = node.options.flags | _root.flags;
+        const RenderLayer* layer = _layers.get(node.layer);
+        if (layer)
+            flags |= layer->options.flags;
+        return flags & render_static;
+    }
+
+    auto RenderSystem::_markStaticDirty(NodeHandle handle) -> void
+    {
+        RenderNode& node = _nodes[handle];
+        if (_isNodeStatic(node))
+        {
+            node._bakedirty = true;
+            _staticdirty = true;
+        }
+    }
+
+    auto RenderSystem::_bakeStatic() -> void
+    {
+        if (!_staticdirty && !_staticorderdirty)
+            return;
+
+        // Find runs of bakeable nodes
+        std::vector<NodeHandle> runs;
+        bool inrun = false;
+
+        for (NodeHandle handle : _renderqueue)
+        {
+            const RenderNode& node = _nodes[handle];
+            const Mesh& mesh = node.mesh;
+
+            if (mesh.size == 0)
+                continue;
+
+            if (mesh.size == 1 && mesh.primitiveType != sf::Points)
+                continue;
+
+            if (mesh.size == 2 && mesh.primitiveType != sf::Points
+                    && mesh.primitiveType != sf::Lines
+                    && mesh.primitiveType != sf::LineStrip)
+                continue;
+
+            if (!RenderOptions::isVisible(node._flags))
+                continue;
+
+            const bool bakeable = node._flags & render_static
+                && (node._flags & render_noparallax || math::almostEquals(node._parallax, 1.0f));
+
+            if (bakeable)
+            {
+                runs.push_back(handle);
+                inrun = true;
+            }
+            else if (inrun)
+            {
+                runs.push_back(NodeHandle());
+                inrun = false;
+            }
+        }
+
+        _staticorderdirty = false;
+        if (!_staticdirty && runs == _staticruns)
+            return;
+
+        LOG_DEBUG("Baking static render nodes");
+
+        // Split the runs into chunks
+        std::vector<StaticChunk> chunks;
+        bool newchunk = true;
+
+        for (NodeHandle handle : runs)
+        {
+            if (!handle)
+            {
+                newchunk = true;
+                continue;
+            }
+
+            const RenderNode& node = _nodes[handle];
+            const sf::RenderStates& states = node._states;
+            const sf::PrimitiveType type = getBatchPrimitiveType(node.mesh.primitiveType);
+
+            if (newchunk || chunks.back().primitiveType != type || !canBatch(chunks.back().states, states))
+            {
+                chunks.emplace_back();
+                chunks.back().primitiveType = type;
+                chunks.back().states = states;
+                newchunk = false;
+            }
+
+            chunks.back().nodes.push_back(handle);
+        }
+
+        // Reuse unchanged chunks, rebake the others.
+        // Done after splitting, so vertex buffers aren't copied when the
+        // vector grows.
+        for (StaticChunk& chunk : chunks)
+        {
+            const int old = _nodes[chunk.nodes[0]]._chunk;
+            bool reuse = old != -1
+                && _chunks[old].nodes == chunk.nodes
+                && _chunks[old].primitiveType == chunk.primitiveType
+                && canBatch(_chunks[old].states, chunk.states);
+
+            for (size_t i = 0; i < chunk.nodes.size() && reuse; ++i)
+                reuse = !_nodes[chunk.nodes[i]]._bakedirty;
+
+            if (reuse)
+            {
+                chunk.vertices.swap(_chunks[old].vertices);
+                chunk.buffer.swap(_chunks[old].buffer);
+                chunk.bbox = _chunks[old].bbox;
+                continue;
+            }
+
+            chunk.bbox = _nodes[chunk.nodes[0]]._globalBBox;
+            for (NodeHandle handle : chunk.nodes)
+            {
+                RenderNode& node = _nodes[handle];
+                appendBatchVertices(&chunk.vertices, _vertices.get(node.mesh.handle.index),
+                        node.mesh.size, node.mesh.primitiveType, node.transform);
+                chunk.bbox.combine(node._globalBBox);
+                node._bakedirty = false;
+            }
+        }
+
+        for (NodeHandle handle : _staticruns)
+            if (_nodes.isValid(handle))
+                _nodes[handle]._chunk = -1;
+
+        for (size_t i = 0; i < chunks.size(); ++i)
+            for (NodeHandle handle : chunks[i].nodes)
+                _nodes[handle]._chunk = i;
+
+        _chunks.swap(chunks);
+        _staticruns = std::move(runs);
+        _staticdirty = false;
+        _drawdirty = true;
+    }
+
+    auto RenderSystem::_uploadStatic() const -> void
+    {
+        if (!sf::VertexBuffer::isAvailable())
+            return;
+
+        for (StaticChunk& chunk : _chunks)
+        {
+            if (chunk.vertices.empty())
+                continue;
+
+            chunk.buffer.setPrimitiveType(chunk.primitiveType);
+            chunk.buffer.setUsage(sf::VertexBuffer::Static);
+
+            if (chunk.buffer.create(chunk.vertices.size()) && chunk.buffer.update(chunk.vertices.data()))
+                std::vector<sf::Vertex>().swap(chunk.vertices);
+        }
+    }
+
+    auto RenderSystem::_updateParallax() -> void
+    {
+        if (!_parallaxdirty)
+            return;
+
+        _parallaxnodes.clear();
+        for (NodeHandle handle : _renderqueue)
+        {
+            const RenderNode& node = _nodes[handle];
+            if (!(node._flags & render_noparallax) && !math::almostEquals(node._parallax, 1.0f))
+                _parallaxnodes.push_back(handle);
+        }
+
+        _parallaxdirty = false;
+    }
+
+    auto RenderSystem::_updateOptions() -> void
+    {
+        if (!_optionsdirty)
+            return;
+
+        for (auto it = _nodes.begin(), end = _nodes.end(); it != end; ++it)
+            _resolveOptions(it.handle());
+
+        _optionsdirty = false;
+        _parallaxdirty = true;
+        _drawdirty = true;
+    }
+
+    auto RenderSystem::_resolveOptions(NodeHandle handle) -> void
+    {
+        const RenderOptions options = getNodeGlobalOptions(handle);
+        RenderNode& node = _nodes[handle];
+        node._states = sf::RenderStates(options.blendMode, sf::Transform::Identity,
+                options.texture.get(), options.shader);
+        node._flags = options.flags;
+        node._parallax = options.parallax;
+    }
+
+    auto RenderSystem::_getThreadPool() const -> ThreadPool*
+    {
+        if (threads == 0)
+            return nullptr;
+
+        if (!_pool || _pool->getNumThreads() != threads)
+            _pool.reset(new ThreadPool(threads));
+        return _pool.get();
+    }
+
+    auto RenderSystem::_updateDrawData() -> void
+    {
+        if (!_drawdirty)
+            return;
+
+        // Queue indices change
+        _invalidateVisibleSets();
+
+        const size_t size = _renderqueue.size();
+        _draw.states.resize(size);
+        _draw.bboxes.resize(size);
+        _draw.vertices.resize(size);
+        _draw.sizes.resize(size);
+        _draw.types.resize(size);
+        _draw.flags.resize(size);
+        _draw.parallax.resize(size);
+        _draw.chunks.resize(size);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            RenderNode& node = _nodes[_renderqueue[i]];
+            node._queueindex = i;
+            _draw.states[i] = node._states;
+            _draw.flags[i] = node._flags;
+            _draw.parallax[i] = node._parallax;
+            _draw.chunks[i] = node._chunk;
+            _syncDrawData(node);
+        }
+
+        _drawdirty = false;
+    }
+
+    auto RenderSystem::_compactVertices() -> void
+    {
+        if (compactBudget == 0 || _vertices.getNumFreeBlocks() == 0)
+            return;
+
+        _relocations.clear();
+        if (_vertices.compact(&_relocations, compactBudget) == 0)
+            return;
+
+        for (auto& r : _relocations)
+            _markVerticesDirty(r.to, r.to + r.size);
+
+        // Relocations are ordered by their old index
+        for (auto it = _nodes.begin(), end = _nodes.end(); it != end; ++it)
+        {
+            RenderNode& node = *it;
+            if (!node.mesh.handle.isValid() || node.mesh.handle.index < _relocations.front().from)
+                continue;
+
+            auto reloc = std::upper_bound(_relocations.begin(), _relocations.end(), node.mesh.handle.index,
+                    [](size_t index, const BatchRelocation& r) { return index < r.from; });
+
+            if (!(reloc - 1)->apply(&node.mesh.handle.index))
+                continue;
+
+            if (!_drawdirty && node._queueindex < _renderqueue.size())
+                _draw.vertices[node._queueindex] = node.mesh.handle.index;
+        }
+    }
+
+    auto RenderSystem::getDirtyVertexRanges() const -> const std::vector<VertexRange>&
+    {
+        _mergeDirtyRanges();
+
+        // Freed meshes at the end might have shrunk the allocator
+        const size_t size = _vertices.getSize();
+        while (!_dirtyranges.empty() && _dirtyranges.back().begin >= size)
+            _dirtyranges.pop_back();
+        if (!_dirtyranges.empty())
+            _dirtyranges.back().end = std::min(_dirtyranges.back().end, size);
+
+        return _dirtyranges;
+    }
+
+    auto RenderSystem::clearDirtyVertexRanges() -> void
+    {
+        _dirtyranges.clear();
+        _dirtymerged = true;
+    }
+
+    auto RenderSystem::_markVerticesDirty(size_t begin, size_t end) -> void
+    {
+        // Consecutive updates often touch neighbouring vertices
+        if (!_dirtyranges.empty() && begin <= _dirtyranges.back().end && end >= _dirtyranges.back().begin)
+        {
+            VertexRange& back = _dirtyranges.back();
+            back.begin = std::min(back.begin, begin);
+            back.end = std::max(back.end, end);
+            _dirtymerged = _dirtyranges.size() == 1;
+            return;
+        }
+
+        _dirtyranges.push_back({ begin, end });
+        _dirtymerged = _dirtyranges.size() == 1;
+
+        if (_dirtyranges.size() > max_dirtyranges)
+        {
+            _mergeDirtyRanges();
+
+            // Upload everything in between instead of tracking more ranges
+            if (_dirtyranges.size() > max_dirtyranges / 2)
+            {
+                const VertexRange all = { _dirtyranges.front().begin, _dirtyranges.back().end };
+                _dirtyranges.assign(1, all);
+            }
+        }
+    }
+
+    auto RenderSystem::_mergeDirtyRanges() const -> void
+    {
+        if (_dirtymerged || _dirtyranges.empty())
+            return;
+
+        std::sort(_dirtyranges.begin(), _dirtyranges.end(), [](const VertexRange& a, const VertexRange& b) {
+                return a.begin < b.begin;
+            });
+
+        size_t num = 0;
+        for (size_t i = 1; i < _dirtyranges.size(); ++i)
+        {
+            if (_dirtyranges[i].begin <= _dirtyranges[num].end)
+                _dirtyranges[num].end = std::max(_dirtyranges[num].end, _dirtyranges[i].end);
+            else
+                _dirtyranges[++num] = _dirtyranges[i];
+        }
+
+        _dirtyranges.resize(num + 1);
+        _dirtymerged = true;
+    }
+
+    auto RenderSystem::_syncDrawData(const RenderNode& node) -> void
+    {
+        const size_t i = node._queueindex;
+        _draw.states[i].transform = node.transform;
+        _draw.bboxes[i] = node._globalBBox;
+        _draw.vertices[i] = node.mesh.handle.index;
+        _draw.sizes[i] = node.mesh.size;
+        _draw.types[i] = node.mesh.primitiveType;
+    }
+
+    auto RenderSystem::_isVisibleSetValid(const RenderList* list, const math::AABBf* rect) const -> bool
+    {
+        if (list->_system != this || list->_generation != _visgeneration
+                || list->_moved < _movedbase || list->_hasview != (rect != nullptr))
+            return false;
+
+        if (rect && !contains(list->_region, *rect))
+            return false;
+
+        // Any move invalidates a set of the whole scene
+        for (size_t i = list->_moved - _movedbase; i < _movedboxes.size(); ++i)
+            if (!rect || math::intersect(list->_region, _movedboxes[i]))
+                return false;
+
+        return true;
+    }
+
+    auto RenderSystem::_markMoved(const RenderNode& node, const math::AABBf& oldbbox) -> void
+    {
+        // Parallax nodes appear elsewhere depending on the view
+        if ((!(node._flags & render_noparallax) && !math::almostEquals(node._parallax, 1.0f))
+                || _movedboxes.size() + 2 > max_movedboxes)
+        {
+            _invalidateVisibleSets();
+            return;
+        }
+
+        _movedboxes.push_back(oldbbox);
+        _movedboxes.push_back(node._globalBBox);
+    }
+
+    auto RenderSystem::_invalidateVisibleSets() -> void
+    {
+        ++_visgeneration;
+        _movedbase += _movedboxes.size();
+        _movedboxes.clear();
     }
 
     auto RenderSystem::_markBBoxDirty(NodeHandle handle) -> void
@@ -653,50 +1575,124 @@ namespace gamelib
         if (!node._bboxdirty)
         {
             node._bboxdirty = true;
+            std::lock_guard<std::mutex> guard(_dirtylock);
             _dirtylist.push_back(handle);
         }
     }
 
 	auto RenderSystem::_updateQueue() -> void
 	{
-        if (!_orderdirty)
+        if (!_orderdirty && !_queuedirty && _queuepending.empty())
             return;
 
-        LOG_DEBUG("RenderSystem content changed -> sorting");
+        auto less = [this](NodeHandle a, NodeHandle b) { return _queueLess(a, b); };
 
-        auto begin = _renderqueue.begin(),
-             end = _renderqueue.end();
-
-        std::stable_sort(begin, end, [this](NodeHandle a, NodeHandle b) {
-            const RenderNode *nodea = _nodes.get(a),
-                            *nodeb = _nodes.get(b);
+        if (_orderdirty)
+        {
+            LOG_DEBUG("RenderLayer order changed -> sorting");
 
-            if (!nodea)
-                return false;
-            if (!nodeb)
-                return true;
+            _renderqueue.erase(std::remove_if(_renderqueue.begin(), _renderqueue.end(),
+                        [this](NodeHandle handle) { return !_nodes.isValid(handle); }),
+                    _renderqueue.end());
 
-            const RenderLayer *layera = getLayer(nodea->layer),
-                              *layerb = getLayer(nodeb->layer);
-            const int deptha = layera ? layera->depth : 0,
-                      depthb = layerb ? layerb->depth : 0;
+            for (NodeHandle handle : _renderqueue)
+            {
+                _nodes[handle]._sortkey = _getSortKey(_nodes[handle]);
+                _nodes[handle]._reorder = false;
+            }
 
-            if (deptha != depthb)
-                return deptha > depthb;
-            return nodea->depth > nodeb->depth;
-        });
+            // Nodes still marked are not in the queue yet
+            for (NodeHandle handle : _queuepending)
+            {
+                if (!_nodes.isValid(handle) || !_nodes[handle]._reorder)
+                    continue;
 
-        auto it = std::find_if(begin, end, [this](NodeHandle handle) { return !_nodes.isValid(handle); });
+                RenderNode& node = _nodes[handle];
+                node._sortkey = _getSortKey(node);
+                node._reorder = false;
+                _renderqueue.push_back(handle);
+            }
 
-        if (it != end)
+            std::sort(_renderqueue.begin(), _renderqueue.end(), less);
+        }
+        else
         {
-            LOG_DEBUG_WARN("Removing ", std::distance(it, end), " deleted nodes from queue");
-            _renderqueue.erase(it, end);
+            // Drop removed nodes and nodes that are about to be reinserted
+            if (_queuedirty)
+                _renderqueue.erase(std::remove_if(_renderqueue.begin(), _renderqueue.end(),
+                            [this](NodeHandle handle) {
+                                return !_nodes.isValid(handle) || _nodes[handle]._reorder;
+                            }),
+                        _renderqueue.end());
+
+            auto end = std::remove_if(_queuepending.begin(), _queuepending.end(),
+                    [this](NodeHandle handle) { return !_nodes.isValid(handle); });
+            _queuepending.erase(end, _queuepending.end());
+
+            for (NodeHandle handle : _queuepending)
+            {
+                RenderNode& node = _nodes[handle];
+                node._sortkey = _getSortKey(node);
+                node._reorder = false;
+            }
+
+            // Binary insertion for a few nodes, merging otherwise (e.g. after loading a level)
+            if (_queuepending.size() <= 16)
+            {
+                for (NodeHandle handle : _queuepending)
+                    _renderqueue.insert(std::upper_bound(_renderqueue.begin(), _renderqueue.end(),
+                                handle, less), handle);
+            }
+            else
+            {
+                std::sort(_queuepending.begin(), _queuepending.end(), less);
+                const size_t mid = _renderqueue.size();
+                _renderqueue.insert(_renderqueue.end(), _queuepending.begin(), _queuepending.end());
+                std::inplace_merge(_renderqueue.begin(), _renderqueue.begin() + mid, _renderqueue.end(), less);
+            }
         }
 
+        _queuepending.clear();
+        _queuedirty = false;
         _orderdirty = false;
+        _parallaxdirty = true;
+        _staticorderdirty = true;
+        _drawdirty = true;
 	}
 
+    auto RenderSystem::_queueNode(NodeHandle handle) -> void
+    {
+        RenderNode& node = _nodes[handle];
+
+        // Nodes without mesh are added by createNodeMesh()
+        if (!node.mesh.handle.isValid() || node._reorder)
+            return;
+
+        node._reorder = true;
+        _queuepending.push_back(handle);
+        _queuedirty = true;
+    }
+
+    auto RenderSystem::_queueLess(NodeHandle a, NodeHandle b) const -> bool
+    {
+        const RenderNode &nodea = _nodes[a],
+                         &nodeb = _nodes[b];
+
+        if (nodea._sortkey != nodeb._sortkey)
+            return nodea._sortkey < nodeb._sortkey;
+        return nodea._sequence < nodeb._sequence;
+    }
+
+    auto RenderSystem::_getSortKey(const RenderNode& node) const -> uint64_t
+    {
+        // Higher depths are rendered first -> flip the sign bit to get an
+        // unsigned ascending order and invert it
+        const RenderLayer* layer = getLayer(node.layer);
+        const uint32_t layerdepth = ~(static_cast<uint32_t>(layer ? layer->depth : 0) ^ 0x80000000u),
+                       nodedepth = ~(static_cast<uint32_t>(node.depth) ^ 0x80000000u);
+        return static_cast<uint64_t>(layerdepth) << 32 | nodedepth;
+    }
+
     auto RenderSystem::loadFromJson(const Json::Value& node) -> bool
     {
         // TODO: load root options
@@ -714,6 +1710,9 @@ namespace gamelib
             }
         }
 
+        // Layer depths and options were changed directly
+        _orderdirty = true;
+        _optionsdirty = true;
         _updateQueue();
         return true;
     }
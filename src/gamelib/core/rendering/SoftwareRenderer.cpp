@@ -0,0 +1,410 @@
+#include "gamelib/core/rendering/SoftwareRenderer.hpp"
+#include "gamelib/utils/log.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace gamelib
+{
+    // Edge length of the screen tiles rasterized in parallel
+    constexpr int raster_tilesize = 64;
+
+    // floor(v) clamped to [lo, hi], also for NaN or huge values
+    static int clampFloor(float v, int lo, int hi)
+    {
+        if (!(v >= lo))
+            return lo;
+        if (!(v <= hi))
+            return hi;
+        return std::floor(v);
+    }
+
+    // > 0 if p is left of a -> b in screen coordinates (y down)
+    static float edge(const sf::Vector2f& a, const sf::Vector2f& b, float px, float py)
+    {
+        return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+    }
+
+    // Pixels exactly on an edge belong to only one of two triangles sharing it
+    static bool isTopLeft(const sf::Vector2f& a, const sf::Vector2f& b)
+    {
+        return b.y - a.y > 0 || (b.y == a.y && b.x - a.x < 0);
+    }
+
+    static bool isInside(float w, bool topleft)
+    {
+        return w > 0 || (w == 0 && topleft);
+    }
+
+    static float blendFactor(sf::BlendMode::Factor factor, const float* src, const float* dst, int k)
+    {
+        switch (factor)
+        {
+            case sf::BlendMode::Zero:             return 0;
+            case sf::BlendMode::One:              return 1;
+            case sf::BlendMode::SrcColor:         return src[k];
+            case sf::BlendMode::OneMinusSrcColor: return 1 - src[k];
+            case sf::BlendMode::DstColor:         return dst[k];
+            case sf::BlendMode::OneMinusDstColor: return 1 - dst[k];
+            case sf::BlendMode::SrcAlpha:         return src[3];
+            case sf::BlendMode::OneMinusSrcAlpha: return 1 - src[3];
+            case sf::BlendMode::DstAlpha:         return dst[3];
+            case sf::BlendMode::OneMinusDstAlpha: return 1 - dst[3];
+            default:                              return 1;
+        }
+    }
+
+    static float blendEquation(sf::BlendMode::Equation equation, float a, float b)
+    {
+        switch (equation)
+        {
+            case sf::BlendMode::Add:      return a + b;
+            case sf::BlendMode::Subtract: return a - b;
+            default:                      return b - a;  // reverse subtract
+        }
+    }
+
+
+    SoftwareRenderer::SoftwareRenderer() :
+        threads(ThreadPool::getDefaultThreads()),
+        _tilesx(0),
+        _tilesy(0)
+    { }
+
+    SoftwareRenderer::SoftwareRenderer(unsigned int width, unsigned int height) :
+        SoftwareRenderer()
+    {
+        create(width, height);
+    }
+
+    auto SoftwareRenderer::create(unsigned int width, unsigned int height) -> void
+    {
+        _size = sf::Vector2u(width, height);
+        _pixels.assign(width * height * 4, 0);
+        _tilesx = (width + raster_tilesize - 1) / raster_tilesize;
+        _tilesy = (height + raster_tilesize - 1) / raster_tilesize;
+        _bins.resize(_tilesx * _tilesy);
+        _calls.clear();
+        _primitives.clear();
+        _vertices.clear();
+        setView(sf::View(sf::FloatRect(0, 0, width, height)));
+    }
+
+    auto SoftwareRenderer::clear(const sf::Color& color) -> void
+    {
+        // Pending draw calls would be overwritten anyway
+        _calls.clear();
+        _primitives.clear();
+        _vertices.clear();
+
+        for (size_t i = 0; i < _pixels.size(); i += 4)
+        {
+            _pixels[i] = color.r;
+            _pixels[i + 1] = color.g;
+            _pixels[i + 2] = color.b;
+            _pixels[i + 3] = color.a;
+        }
+    }
+
+    auto SoftwareRenderer::setTextureImage(const sf::Texture* texture, const sf::Image* image) -> void
+    {
+        if (image)
+            _images[texture] = image;
+        else
+            _images.erase(texture);
+    }
+
+    auto SoftwareRenderer::getPixels() const -> const sf::Uint8*
+    {
+        return _pixels.data();
+    }
+
+    auto SoftwareRenderer::copyToImage() const -> sf::Image
+    {
+        sf::Image img;
+        img.create(_size.x, _size.y, _pixels.data());
+        return img;
+    }
+
+    auto SoftwareRenderer::getSize() const -> sf::Vector2u
+    {
+        return _size;
+    }
+
+    auto SoftwareRenderer::getView() const -> sf::View
+    {
+        return _view;
+    }
+
+    auto SoftwareRenderer::setView(const sf::View& view) -> void
+    {
+        // Same mapping as sf::RenderTarget::getViewport() and mapCoordsToPixel()
+        const sf::FloatRect& vp = view.getViewport();
+        const sf::IntRect viewport(
+                0.5f + _size.x * vp.left, 0.5f + _size.y * vp.top,
+                0.5f + _size.x * vp.width, 0.5f + _size.y * vp.height);
+
+        _view = view;
+        _viewtransform = sf::Transform::Identity;
+        _viewtransform.translate(viewport.left + viewport.width / 2.f, viewport.top + viewport.height / 2.f)
+            .scale(viewport.width / 2.f, -viewport.height / 2.f)
+            .combine(view.getTransform());
+
+        // Viewport clipped to the framebuffer
+        _clip.left = std::max(viewport.left, 0);
+        _clip.top = std::max(viewport.top, 0);
+        _clip.width = std::min<int>(viewport.left + viewport.width, _size.x) - _clip.left;
+        _clip.height = std::min<int>(viewport.top + viewport.height, _size.y) - _clip.top;
+    }
+
+    auto SoftwareRenderer::draw(const RenderBatch& batch) -> void
+    {
+        if (!batch.vertices)
+        {
+            LOG_WARN("Can't draw vertex buffers in software, use RenderSystem::prepareRender(false)");
+            return;
+        }
+
+        if (_clip.width <= 0 || _clip.height <= 0)
+            return;
+
+        DrawCall call;
+        auto it = batch.states.texture ? _images.find(batch.states.texture) : _images.end();
+        call.image = it != _images.end() ? it->second : nullptr;
+        call.repeated = call.image && batch.states.texture->isRepeated();
+        call.blendMode = batch.states.blendMode;
+
+        const sf::PrimitiveType type = getBatchPrimitiveType(batch.primitiveType);
+        call.numvertices = type == sf::Triangles ? 3 : type == sf::Lines ? 2 : 1;
+
+        const size_t first = _vertices.size();
+        _vertices.resize(first + getBatchVertexCount(batch.size, batch.primitiveType));
+        writeBatchVertices(_vertices.data() + first, batch.vertices, batch.size, batch.primitiveType,
+                _viewtransform * batch.states.transform);
+
+        const int maxx = _clip.left + _clip.width - 1,
+                  maxy = _clip.top + _clip.height - 1;
+        const size_t numprimitives = _primitives.size();
+
+        for (size_t i = first; i < _vertices.size(); i += call.numvertices)
+        {
+            sf::Vector2f min = _vertices[i].position,
+                         max = min;
+
+            for (int k = 1; k < call.numvertices; ++k)
+            {
+                const sf::Vector2f& p = _vertices[i + k].position;
+                min.x = std::min(min.x, p.x);
+                min.y = std::min(min.y, p.y);
+                max.x = std::max(max.x, p.x);
+                max.y = std::max(max.y, p.y);
+            }
+
+            Primitive prim;
+            prim.vertex = i;
+            prim.call = _calls.size();
+            prim.bounds.minx = clampFloor(min.x, _clip.left, maxx + 1);
+            prim.bounds.miny = clampFloor(min.y, _clip.top, maxy + 1);
+            prim.bounds.maxx = clampFloor(max.x, _clip.left - 1, maxx);
+            prim.bounds.maxy = clampFloor(max.y, _clip.top - 1, maxy);
+
+            if (prim.bounds.minx <= prim.bounds.maxx && prim.bounds.miny <= prim.bounds.maxy)
+                _primitives.push_back(prim);
+        }
+
+        if (_primitives.size() > numprimitives)
+            _calls.push_back(call);
+    }
+
+    auto SoftwareRenderer::supportsVertexBuffers() const -> bool
+    {
+        return false;
+    }
+
+    auto SoftwareRenderer::display() -> void
+    {
+        for (auto& bin : _bins)
+            bin.clear();
+
+        for (size_t i = 0; i < _primitives.size(); ++i)
+        {
+            const Bounds& b = _primitives[i].bounds;
+            for (int y = b.miny / raster_tilesize; y <= b.maxy / raster_tilesize; ++y)
+                for (int x = b.minx / raster_tilesize; x <= b.maxx / raster_tilesize; ++x)
+                    _bins[y * _tilesx + x].push_back(i);
+        }
+
+        ThreadPool* pool = _getThreadPool();
+        if (pool)
+            pool->run(_bins.size(), [this](size_t tile) { _rasterizeTile(tile); });
+        else
+            for (size_t tile = 0; tile < _bins.size(); ++tile)
+                _rasterizeTile(tile);
+
+        _calls.clear();
+        _primitives.clear();
+        _vertices.clear();
+    }
+
+    auto SoftwareRenderer::_getThreadPool() -> ThreadPool*
+    {
+        if (threads == 0 || _bins.size() < 2)
+            return nullptr;
+
+        if (!_pool || _pool->getNumThreads() != threads)
+            _pool.reset(new ThreadPool(threads));
+        return _pool.get();
+    }
+
+    auto SoftwareRenderer::_rasterizeTile(size_t tile) -> void
+    {
+        const int left = tile % _tilesx * raster_tilesize,
+                  top = tile / _tilesx * raster_tilesize;
+
+        for (size_t i : _bins[tile])
+        {
+            const Primitive& prim = _primitives[i];
+
+            // Part of the primitive inside this tile
+            Bounds rect;
+            rect.minx = std::max(left, prim.bounds.minx);
+            rect.miny = std::max(top, prim.bounds.miny);
+            rect.maxx = std::min(left + raster_tilesize - 1, prim.bounds.maxx);
+            rect.maxy = std::min(top + raster_tilesize - 1, prim.bounds.maxy);
+
+            switch (_calls[prim.call].numvertices)
+            {
+                case 3:
+                    _drawTriangle(prim, rect);
+                    break;
+                case 2:
+                    _drawLine(prim, rect);
+                    break;
+                default:
+                    _drawPoint(prim, rect);
+            }
+        }
+    }
+
+    // Interpolates the vertex attributes with the given weights and
+    // applies the texture
+    static sf::Color shade(const sf::Image* image, bool repeated, const sf::Vertex* v,
+            float l0, float l1, float l2)
+    {
+        sf::Color color(
+                l0 * v[0].color.r + l1 * v[1].color.r + l2 * v[2].color.r + 0.5f,
+                l0 * v[0].color.g + l1 * v[1].color.g + l2 * v[2].color.g + 0.5f,
+                l0 * v[0].color.b + l1 * v[1].color.b + l2 * v[2].color.b + 0.5f,
+                l0 * v[0].color.a + l1 * v[1].color.a + l2 * v[2].color.a + 0.5f);
+
+        if (!image || image->getSize().x == 0 || image->getSize().y == 0)
+            return color;
+
+        const int w = image->getSize().x,
+                  h = image->getSize().y;
+        int x = std::floor(l0 * v[0].texCoords.x + l1 * v[1].texCoords.x + l2 * v[2].texCoords.x),
+            y = std::floor(l0 * v[0].texCoords.y + l1 * v[1].texCoords.y + l2 * v[2].texCoords.y);
+
+        if (repeated)
+        {
+            x = (x % w + w) % w;
+            y = (y % h + h) % h;
+        }
+        else
+        {
+            x = std::min(std::max(x, 0), w - 1);
+            y = std::min(std::max(y, 0), h - 1);
+        }
+
+        return color * image->getPixel(x, y);
+    }
+
+    auto SoftwareRenderer::_drawPoint(const Primitive& prim, const Bounds& rect) -> void
+    {
+        // Bounds are the pixel itself
+        const DrawCall& call = _calls[prim.call];
+        const sf::Vertex* v = &_vertices[prim.vertex];
+        const sf::Vertex tri[] = { v[0], v[0], v[0] };
+        _blend(call, rect.minx, rect.miny, shade(call.image, call.repeated, tri, 1, 0, 0));
+    }
+
+    auto SoftwareRenderer::_drawLine(const Primitive& prim, const Bounds& rect) -> void
+    {
+        const DrawCall& call = _calls[prim.call];
+        const sf::Vertex* v = &_vertices[prim.vertex];
+        const sf::Vertex tri[] = { v[0], v[1], v[1] };
+        const sf::Vector2f d = v[1].position - v[0].position;
+        const int steps = std::min(std::ceil(std::max(std::abs(d.x), std::abs(d.y))), 1e6f);
+
+        for (int i = 0; i <= steps; ++i)
+        {
+            const float t = steps > 0 ? (float)i / steps : 0;
+            const int x = std::floor(v[0].position.x + d.x * t),
+                      y = std::floor(v[0].position.y + d.y * t);
+
+            if (x >= rect.minx && x <= rect.maxx && y >= rect.miny && y <= rect.maxy)
+                _blend(call, x, y, shade(call.image, call.repeated, tri, 1 - t, t, 0));
+        }
+    }
+
+    auto SoftwareRenderer::_drawTriangle(const Primitive& prim, const Bounds& rect) -> void
+    {
+        const DrawCall& call = _calls[prim.call];
+        const sf::Vertex* v = &_vertices[prim.vertex];
+        sf::Vertex tri[] = { v[0], v[1], v[2] };
+
+        float area = edge(tri[0].position, tri[1].position, tri[2].position.x, tri[2].position.y);
+        if (area == 0 || !std::isfinite(area))
+            return;
+
+        // SFML doesn't cull, make all triangles counter-clockwise
+        if (area < 0)
+        {
+            std::swap(tri[1], tri[2]);
+            area = -area;
+        }
+
+        const sf::Vector2f& p0 = tri[0].position;
+        const sf::Vector2f& p1 = tri[1].position;
+        const sf::Vector2f& p2 = tri[2].position;
+        const bool tl0 = isTopLeft(p1, p2),
+                   tl1 = isTopLeft(p2, p0),
+                   tl2 = isTopLeft(p0, p1);
+
+        // Weights are evaluated per pixel instead of incrementally, so
+        // results don't depend on the tile
+        for (int y = rect.miny; y <= rect.maxy; ++y)
+        {
+            const float py = y + 0.5f;
+            for (int x = rect.minx; x <= rect.maxx; ++x)
+            {
+                const float px = x + 0.5f;
+                const float w0 = edge(p1, p2, px, py),
+                            w1 = edge(p2, p0, px, py),
+                            w2 = edge(p0, p1, px, py);
+
+                if (isInside(w0, tl0) && isInside(w1, tl1) && isInside(w2, tl2))
+                    _blend(call, x, y, shade(call.image, call.repeated, tri, w0 / area, w1 / area, w2 / area));
+            }
+        }
+    }
+
+    auto SoftwareRenderer::_blend(const DrawCall& call, int x, int y, sf::Color color) -> void
+    {
+        sf::Uint8* out = &_pixels[(y * _size.x + x) * 4];
+        const sf::BlendMode& mode = call.blendMode;
+        const float src[] = { color.r / 255.f, color.g / 255.f, color.b / 255.f, color.a / 255.f };
+        const float dst[] = { out[0] / 255.f, out[1] / 255.f, out[2] / 255.f, out[3] / 255.f };
+
+        for (int k = 0; k < 4; ++k)
+        {
+            const float res = k < 3
+                ? blendEquation(mode.colorEquation,
+                        src[k] * blendFactor(mode.colorSrcFactor, src, dst, k),
+                        dst[k] * blendFactor(mode.colorDstFactor, src, dst, k))
+                : blendEquation(mode.alphaEquation,
+                        src[k] * blendFactor(mode.alphaSrcFactor, src, dst, k),
+                        dst[k] * blendFactor(mode.alphaDstFactor, src, dst, k));
+            out[k] = std::min(std::max(res, 0.f), 1.f) * 255 + 0.5f;
+        }
+    }
+}
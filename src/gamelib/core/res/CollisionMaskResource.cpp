@@ -0,0 +1,138 @@
+#include "gamelib/core/res/CollisionMaskResource.hpp"
+#include "gamelib/core/res/ResourceManager.hpp"
+#include "gamelib/json/json-file.hpp"
+#include "gamelib/utils/log.hpp"
+#include <algorithm>
+
+namespace gamelib
+{
+    constexpr size_t min_clean_size = 64;
+
+    static void createPixelMask(const sf::Image& img, sf::Color color, PixelMask* mask)
+    {
+        const sf::Uint8* data = img.getPixelsPtr();
+        const int w = img.getSize().x;
+
+        // Same as sf::Image::createMaskFromColor() and checking for alpha 0
+        mask->create(w, img.getSize().y, [&](int x, int y) {
+                const sf::Uint8* p = data + 4 * (y * w + x);
+                return p[3] != 0 && !(p[0] == color.r && p[1] == color.g && p[2] == color.b && p[3] == color.a);
+            });
+    }
+
+
+    void registerCollisionMaskLoader(ResourceManager& resmgr)
+    {
+        resmgr.registerFileType("colmask", collisionMaskLoader);
+    }
+
+    BaseResourceHandle collisionMaskLoader(const std::string& fname, ResourceManager* resmgr)
+    {
+        Json::Value node;
+        if (!loadJsonFromFile(fname, node))
+            return nullptr;
+
+        auto tex = resmgr->get(node["texture"].asString()).as<TextureResource>();
+        if (!tex)
+        {
+            LOG_ERROR("No texture specified for collision mask: ", fname);
+            return nullptr;
+        }
+
+        sf::Color color = sf::Color::Transparent;
+        if (node.isMember("mask"))
+        {
+            auto& mask = node["mask"];
+            color = sf::Color(mask[0].asInt(), mask[1].asInt(), mask[2].asInt(), mask[3].asInt());
+        }
+
+        // Not shared with getCollisionMask(), because the ResourceManager
+        // sets path attributes of the returned resource.
+        auto res = createCollisionMask(tex->copyToImage(), color);
+        res->tex = tex;
+        return res.as<BaseResource>();
+    }
+
+    auto getCollisionMask(TextureResource::Handle tex, sf::Color color) -> CollisionMaskResource::Handle
+    {
+        if (!tex)
+            return nullptr;
+
+        auto resmgr = ResourceManager::findActive();
+        if (resmgr)
+            return resmgr->getCollisionMasks().get(tex, color);
+
+        auto res = createCollisionMask(tex->copyToImage(), color);
+        res->tex = tex;
+        return res;
+    }
+
+    auto createCollisionMask(const sf::Image& img, sf::Color color) -> CollisionMaskResource::Handle
+    {
+        auto res = CollisionMaskResource::create();
+        res->color = color;
+        createPixelMask(img, color, &res->mask);
+        return res;
+    }
+
+
+    CollisionMaskCache::CollisionMaskCache() :
+        _cleansize(min_clean_size)
+    { }
+
+    auto CollisionMaskCache::get(TextureResource::Handle tex, sf::Color color) -> CollisionMaskResource::Handle
+    {
+        if (!tex)
+            return nullptr;
+
+        std::lock_guard<std::mutex> guard(_lock);
+
+        auto& entry = _masks[Key(tex.get(), sf::Uint32(color.r) << 24 | color.g << 16 | color.b << 8 | color.a)];
+        auto res = entry.lock();
+        if (!res)
+        {
+            res = std::make_shared<CollisionMaskResource>();
+            res->res.tex = tex;
+            res->res.color = color;
+            createPixelMask(tex->copyToImage(), color, &res->res.mask);
+            entry = res;
+
+            if (_masks.size() >= _cleansize)
+                _clean();
+        }
+
+        return res;
+    }
+
+    auto CollisionMaskCache::clean() -> void
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _clean();
+    }
+
+    auto CollisionMaskCache::clear() -> void
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _masks.clear();
+        _cleansize = min_clean_size;
+    }
+
+    auto CollisionMaskCache::size() const -> size_t
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        return _masks.size();
+    }
+
+    auto CollisionMaskCache::_clean() -> void
+    {
+        for (auto it = _masks.begin(); it != _masks.end();)
+        {
+            if (it->second.expired())
+                it = _masks.erase(it);
+            else
+                ++it;
+        }
+
+        _cleansize = std::max(min_clean_size, 2 * _masks.size());
+    }
+}
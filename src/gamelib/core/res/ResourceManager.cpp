@@ -1,4 +1,5 @@
 #include "gamelib/core/res/ResourceManager.hpp"
+#include "gamelib/core/res/TextureAtlas.hpp"
 #include "gamelib/events/ResourceReloadEvent.hpp"
 #include "gamelib/core/event/EventManager.hpp"
 #include "gamelib/utils/log.hpp"
@@ -68,6 +69,15 @@ namespace gamelib
             }
         }
 
+        if (node.isMember("atlas"))
+        {
+            _atlas = node["atlas"];
+            packSpriteAtlases(*this,
+                    _atlas.get("cache", "").asString(),
+                    _atlas.get("pagesize", 2048).asInt(),
+                    _atlas.get("padding", 1).asInt());
+        }
+
         if (node.isMember("once"))
         {
             auto& once = node["once"];
@@ -102,6 +112,9 @@ namespace gamelib
 
         node["forcereload"] = false;
 
+        if (!_atlas.isNull())
+            node["atlas"] = _atlas;
+
         // TODO: group files by subfolders
         auto& files = node["preload"][""];
         files.resize(_res.size());
@@ -280,11 +293,14 @@ namespace gamelib
                     ++it;
             }
         } while (freed > 0);
+
+        _masks.clean();
     }
 
     void ResourceManager::clear()
     {
         _res.clear();
+        _masks.clear();
         LOG_DEBUG_WARN("Freeing all resources");
     }
 
@@ -293,9 +309,16 @@ namespace gamelib
         _res.clear();
         _typemap.clear();
         _searchpaths.clear();
+        _masks.clear();
+        _atlas = Json::Value();
         LOG_DEBUG_WARN("ResourceManager destroyed");
     }
 
+    auto ResourceManager::getCollisionMasks() -> CollisionMaskCache&
+    {
+        return _masks;
+    }
+
     auto ResourceManager::findFile(const boost::filesystem::path& fname) const -> boost::filesystem::path
     {
         // TODO: maybe allow files not to exist
@@ -19,11 +19,10 @@ namespace gamelib
         // constexpr float magic = 0.375;
         constexpr float magic = 0;
 
-        auto tsize = tex->getSize();
-
+        // Frames wrap around inside the region
         int x = rect.x + index * rect.w;
-        int y = (rect.y + (int)(x / tsize.x) * rect.h) % tsize.y;
-        x = x % tsize.x;
+        int y = (rect.y + (int)(x / region.w) * rect.h) % region.h + region.y;
+        x = x % region.w + region.x;
 
         return math::AABBi(
                 x + magic, y + magic,
@@ -48,7 +47,10 @@ namespace gamelib
         }
 
         if (node.isMember("texture"))
+        {
             sprite->tex = resmgr->get(node["texture"].asString()).as<TextureResource>();
+            sprite->region = math::AABBi();
+        }
 
         if (!sprite->tex)
         {
@@ -56,13 +58,22 @@ namespace gamelib
             return nullptr;
         }
 
+        // Inherited from the parent otherwise, which might be in an atlas
+        if (sprite->region.size.isZero())
+            sprite->region.size = convert(sprite->tex->getSize());
+
         loadFromJson(node["framesize"], sprite->rect.size);
 
         if (sprite->rect.size.isZero())
             sprite->rect.size = convert(sprite->tex->getSize());
 
+        // getFrameRect() returns texture coordinates, rect is relative to the region
         if (node.isMember("startindex"))
-            sprite->rect.pos = sprite->getFrameRect(node["startindex"].asInt()).pos;
+        {
+            auto frame = sprite->getFrameRect(node["startindex"].asInt());
+            sprite->rect.pos.x = frame.x - sprite->region.x;
+            sprite->rect.pos.y = frame.y - sprite->region.y;
+        }
 
         loadFromJson(node["framepos"], sprite->rect.pos);    // overwrites startindex if present
         loadFromJson(node["origin"], sprite->origin);
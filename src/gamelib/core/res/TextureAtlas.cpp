@@ -0,0 +1,244 @@
+#include "gamelib/core/res/TextureAtlas.hpp"
+#include "gamelib/core/res/ResourceManager.hpp"
+#include "gamelib/core/res/SpriteResource.hpp"
+#include "gamelib/utils/RectPacker.hpp"
+#include "gamelib/utils/log.hpp"
+#include "gamelib/json/json-file.hpp"
+#include "gamelib/json/json-vector.hpp"
+#include <SFML/Graphics/Image.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <map>
+
+namespace gamelib
+{
+    struct AtlasEntry
+    {
+        TextureResource::Handle tex;
+        std::string path;
+        math::Vec2i size;
+        int64_t mtime;
+        int page;
+        math::Vec2i pos;    // excluding padding
+    };
+
+    // Copies the image to the page and extends its edges into the padding
+    void blitPadded(sf::Image* page, const sf::Image& img, const math::Vec2i& pos, int padding)
+    {
+        const int w = img.getSize().x,
+                  h = img.getSize().y;
+
+        auto extend = [&](int x, int y) {
+            page->setPixel(pos.x + x, pos.y + y, img.getPixel(
+                        std::min(std::max(x, 0), w - 1), std::min(std::max(y, 0), h - 1)));
+        };
+
+        page->copy(img, pos.x, pos.y);
+
+        for (int y = -padding; y < h + padding; ++y)
+            for (int i = 1; i <= padding; ++i)
+                extend(-i, y), extend(w - 1 + i, y);
+
+        for (int x = 0; x < w; ++x)
+            for (int i = 1; i <= padding; ++i)
+                extend(x, -i), extend(x, h - 1 + i);
+    }
+
+    bool loadAtlasCache(const std::string& fname, int pagesize, int padding,
+            std::vector<AtlasEntry>* entries, std::vector<sf::Image>* pages)
+    {
+        if (!boost::filesystem::exists(fname))
+            return false;
+
+        Json::Value node;
+        if (!loadJsonFromFile(fname, node))
+            return false;
+
+        const auto& textures = node["textures"];
+        if (node["pagesize"].asInt() != pagesize || node["padding"].asInt() != padding
+                || !textures.isObject() || textures.size() != entries->size())
+            return false;
+
+        const auto& pagesnode = node["pages"];
+        for (auto& entry : *entries)
+        {
+            const auto& texnode = textures[entry.path];
+            math::Vec2i size;
+
+            if (!texnode.isObject() || !loadFromJson(texnode["size"], size)
+                    || size.x != entry.size.x || size.y != entry.size.y
+                    || texnode["mtime"].asInt64() != entry.mtime)
+                return false;
+
+            entry.page = texnode["page"].asInt();
+            if (entry.page < 0 || entry.page >= (int)pagesnode.size()
+                    || !loadFromJson(texnode["pos"], entry.pos))
+                return false;
+        }
+
+        const auto dir = boost::filesystem::path(fname).parent_path();
+        pages->resize(pagesnode.size());
+        for (Json::ArrayIndex i = 0; i < pagesnode.size(); ++i)
+            if (!(*pages)[i].loadFromFile((dir / pagesnode[i].asString()).string()))
+            {
+                LOG_WARN("Failed to load atlas page ", pagesnode[i].asString(), " -> Repacking");
+                return false;
+            }
+
+        return true;
+    }
+
+    void writeAtlasCache(const std::string& fname, int pagesize, int padding,
+            const std::vector<AtlasEntry>& entries, const std::vector<sf::Image>& pages)
+    {
+        const boost::filesystem::path path = fname;
+        Json::Value node;
+        node["pagesize"] = pagesize;
+        node["padding"] = padding;
+
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            const std::string pagename = path.filename().string() + "." + std::to_string(i) + ".png";
+            if (!pages[i].saveToFile((path.parent_path() / pagename).string()))
+            {
+                LOG_ERROR("Failed to save atlas page ", pagename);
+                return;
+            }
+            node["pages"].append(pagename);
+        }
+
+        auto& textures = node["textures"];
+        for (auto& entry : entries)
+        {
+            auto& texnode = textures[entry.path];
+            texnode["page"] = entry.page;
+            writeToJson(texnode["pos"], entry.pos);
+            writeToJson(texnode["size"], entry.size);
+            texnode["mtime"] = (Json::Int64)entry.mtime;
+        }
+
+        writeJsonToFile(fname, node);
+    }
+
+    void packAtlasPages(int pagesize, int padding, std::vector<AtlasEntry>* entries, std::vector<sf::Image>* pages)
+    {
+        std::vector<RectPacker> packers;
+
+        for (auto& entry : *entries)
+        {
+            const int w = entry.size.x + 2 * padding,
+                      h = entry.size.y + 2 * padding;
+
+            math::Vec2i pos;
+            size_t page = 0;
+            while (page < packers.size() && !packers[page].insert(w, h, &pos))
+                ++page;
+
+            if (page == packers.size())
+            {
+                packers.emplace_back(pagesize, pagesize);
+                packers.back().insert(w, h, &pos);
+            }
+
+            entry.page = page;
+            entry.pos.x = pos.x + padding;
+            entry.pos.y = pos.y + padding;
+        }
+
+        // Pages only need to be as large as the area used
+        pages->resize(packers.size());
+        for (size_t i = 0; i < packers.size(); ++i)
+        {
+            const math::Vec2i size = packers[i].getUsedSize();
+            (*pages)[i].create(size.x, size.y, sf::Color::Transparent);
+            LOG_DEBUG("Atlas page ", i, ": ", size.x, "x", size.y, ", ", packers[i].getOccupancy() * 100, "% used");
+        }
+
+        for (auto& entry : *entries)
+            blitPadded(&(*pages)[entry.page], entry.tex->copyToImage(), entry.pos, padding);
+    }
+
+    size_t packSpriteAtlases(ResourceManager& resmgr, const std::string& cachefile, int pagesize, int padding, bool forcepack)
+    {
+        std::vector<SpriteResource::Handle> sprites;
+        std::map<std::string, AtlasEntry> textures;
+
+        resmgr.foreach([&](const std::string&, BaseResourceHandle res) {
+                auto sprite = res.as<SpriteResource>();
+                const BaseResource* texres = sprite->tex.getResource();
+
+                // Skip textures not loaded from files, e.g. atlas pages
+                if (texres->getPath().empty())
+                    return false;
+
+                const auto size = sprite->tex->getSize();
+                if ((int)size.x + 2 * padding > pagesize || (int)size.y + 2 * padding > pagesize)
+                {
+                    LOG_WARN("Texture too large for atlas: ", texres->getPath());
+                    return false;
+                }
+
+                sprites.push_back(sprite);
+
+                AtlasEntry& entry = textures[texres->getPath()];
+                if (!entry.tex)
+                {
+                    boost::system::error_code ec;
+                    entry.tex = sprite->tex;
+                    entry.path = texres->getPath();
+                    entry.size.x = size.x;
+                    entry.size.y = size.y;
+                    entry.mtime = boost::filesystem::last_write_time(texres->getFullPath(), ec);
+                }
+                return false;
+            }, SpriteResource::id);
+
+        if (textures.empty())
+            return 0;
+
+        // Tallest first gives the best skyline packing, the path a stable layout
+        std::vector<AtlasEntry> entries;
+        for (auto& it : textures)
+            entries.push_back(std::move(it.second));
+
+        std::stable_sort(entries.begin(), entries.end(), [](const AtlasEntry& a, const AtlasEntry& b) {
+                return a.size.y > b.size.y || (a.size.y == b.size.y && a.size.x > b.size.x);
+            });
+
+        std::vector<sf::Image> pages;
+        if (forcepack || cachefile.empty() || !loadAtlasCache(cachefile, pagesize, padding, &entries, &pages))
+        {
+            LOG("Packing ", entries.size(), " textures into atlases");
+            packAtlasPages(pagesize, padding, &entries, &pages);
+
+            if (!cachefile.empty())
+                writeAtlasCache(cachefile, pagesize, padding, entries, pages);
+        }
+
+        std::vector<TextureResource::Handle> pagetextures(pages.size());
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            pagetextures[i] = TextureResource::create();
+            if (!pagetextures[i]->loadFromImage(pages[i]))
+            {
+                LOG_ERROR("Failed to create atlas texture");
+                return 0;
+            }
+        }
+
+        std::map<std::string, const AtlasEntry*> index;
+        for (auto& entry : entries)
+            index[entry.path] = &entry;
+
+        for (auto& sprite : sprites)
+        {
+            const AtlasEntry* entry = index[sprite->tex.getResource()->getPath()];
+            sprite->tex = pagetextures[entry->page];
+            sprite->region.x += entry->pos.x;
+            sprite->region.y += entry->pos.y;
+        }
+
+        LOG("Moved ", sprites.size(), " sprites to ", pages.size(), " atlas pages");
+        return sprites.size();
+    }
+}
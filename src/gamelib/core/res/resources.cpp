@@ -5,6 +5,7 @@
 #include "gamelib/core/res/SpriteResource.hpp"
 #include "gamelib/core/res/EntityResource.hpp"
 #include "gamelib/core/res/SoundResource.hpp"
+#include "gamelib/core/res/CollisionMaskResource.hpp"
 #include "gamelib/core/res/ResourceManager.hpp"
 
 
@@ -24,5 +25,6 @@ namespace gamelib
         registerJsonLoader(resmgr);
         registerEntityConfigLoader(resmgr);
         registerSoundLoader(resmgr);
+        registerCollisionMaskLoader(resmgr);
     }
 }
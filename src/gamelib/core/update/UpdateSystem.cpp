@@ -1,9 +1,14 @@
 #include "gamelib/core/update/UpdateSystem.hpp"
 #include "gamelib/components/UpdateComponent.hpp"
+#include "gamelib/utils/ScratchBuffer.hpp"
 #include "gamelib/utils/log.hpp"
 
 namespace gamelib
 {
+    UpdateSystem::UpdateSystem() :
+        _updating(false)
+    { }
+
     UpdateSystem::Handle UpdateSystem::add(UpdateComponent* obj, UpdateHookType hook)
     {
         assert(obj != nullptr && "UpdateComponent is null");
@@ -19,7 +24,19 @@ namespace gamelib
 
     void UpdateSystem::remove(Handle handle, UpdateHookType hook)
     {
-        _objs[hook].destroy(handle);
+        if (_updating)
+        {
+            // Destroying now would move another component into the
+            // position currently being iterated
+            auto data = _objs[hook].get(handle);
+            if (data && data->obj)
+            {
+                data->obj = nullptr;
+                _removed[hook].push_back(handle);
+            }
+        }
+        else
+            _objs[hook].destroy(handle);
         LOG_DEBUG("Removed UpdateComponent from UpdateSystem");
     }
 
@@ -27,14 +44,32 @@ namespace gamelib
     {
         for (auto& i : _objs)
             i.clear();
+        for (auto& i : _removed)
+            i.clear();
         LOG_DEBUG_WARN("UpdateSystem destroyed");
     }
 
     void UpdateSystem::update(float elapsed)
     {
+        struct Deferred
+        {
+            UpdateScheduler* scheduler;
+            Handle handle;
+            float elapsed;
+        };
+
+        _updating = true;
+
         for (auto& h : _objs)
-            for (auto& i : h)
+        {
+            ScratchBuffer<Deferred> deferred;
+
+            for (auto it = h.begin(), end = h.end(); it != end; ++it)
             {
+                auto& i = *it;
+                if (!i.obj)
+                    continue;   // removed during this update
+
                 --i.nextupdate;
                 i.elapsed += elapsed;
 
@@ -44,8 +79,51 @@ namespace gamelib
                     auto frametime = i.elapsed;
                     i.nextupdate = i.obj->interval;
                     i.elapsed = 0;
-                    i.obj->update(frametime);
+
+                    auto scheduler = i.obj->getScheduler();
+                    if (scheduler)
+                        deferred->push_back({ scheduler, it.handle(), frametime });
+                    else
+                        i.obj->update(frametime);
                 }
             }
+
+            // Pass deferred objects to their schedulers, in order of first appearance
+            for (size_t i = 0; i < deferred->size(); ++i)
+            {
+                auto scheduler = (*deferred)[i].scheduler;
+                if (!scheduler)
+                    continue;
+
+                ScratchBuffer<UpdateComponent*> objs;
+                ScratchBuffer<float> times;
+                for (size_t j = i; j < deferred->size(); ++j)
+                {
+                    auto& d = (*deferred)[j];
+                    if (d.scheduler != scheduler)
+                        continue;
+
+                    // Objects might have been removed by previous updates
+                    if (h.isValid(d.handle) && h[d.handle].obj)
+                    {
+                        objs->push_back(h[d.handle].obj);
+                        times->push_back(d.elapsed);
+                    }
+                    d.scheduler = nullptr;
+                }
+
+                if (!objs->empty())
+                    scheduler->update(objs->data(), times->data(), objs->size());
+            }
+        }
+
+        _updating = false;
+
+        for (size_t hook = 0; hook < NumFrameHooks; ++hook)
+        {
+            for (auto handle : _removed[hook])
+                _objs[hook].destroy(handle);
+            _removed[hook].clear();
+        }
     }
 }
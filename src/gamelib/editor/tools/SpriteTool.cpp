@@ -38,7 +38,8 @@ namespace gamelib
     {
         if (_sprite && !InputSystem::getActive()->isMouseConsumed())
         {
-            sf::Sprite spr(*_sprite->tex, convert(_sprite->rect));
+            auto rect = _sprite->getFrameRect(0);
+            sf::Sprite spr(*_sprite->tex, sf::IntRect(rect.x, rect.y, _sprite->rect.w, _sprite->rect.h));
             spr.setOrigin(convert(_sprite->origin.asVector()));
             spr.setPosition(convert(EditorShared::getMouseSnapped().asVector()));
             spr.setColor(sf::Color(255, 255, 255, 128));
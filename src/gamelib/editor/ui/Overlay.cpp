@@ -44,6 +44,9 @@ namespace gamelib
                 if (!numrendered)
                     numrendered = RenderSystem::getActive()->getNumObjectsRendered();
                 ImGui::Text("Objects rendered: %lu", numrendered);
+
+                const auto& vertices = RenderSystem::getActive()->getVertexAllocator();
+                ImGui::Text("Vertices: %lu (%i%% free)", vertices.getSize(), (int)(vertices.getFragmentation() * 100));
             }
             ImGui::End();
             ImGui::PopStyleColor();
@@ -4,6 +4,7 @@
 #include "gamelib/core/ecs/EntityManager.hpp"
 #include "gamelib/core/ecs/EntityFactory.hpp"
 #include "gamelib/core/rendering/RenderSystem.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
 #include "gamelib/core/ecs/serialization.hpp"
 
 namespace gamelib
@@ -28,6 +29,11 @@ namespace gamelib
         if (rensys && node.isMember("rendersystem"))
             rensys->loadFromJson(node["rendersystem"]);
 
+        // Layers must exist before colliders referring to them are created
+        auto colsys = getSubsystem<CollisionSystem>();
+        if (colsys && node.isMember("collisionsystem"))
+            colsys->loadFromJson(node["collisionsystem"]);
+
         loadEntityManagerFromJson(node["entmgr"], true, direct);
 
         LOG("Loading finished");
@@ -42,6 +48,10 @@ namespace gamelib
         if (rensys)
             rensys->writeToJson(node["rendersystem"]);
 
+        auto colsys = getSubsystem<CollisionSystem>();
+        if (colsys)
+            colsys->writeToJson(node["collisionsystem"]);
+
         auto entmgr = getSubsystem<EntityManager>();
         if (!entmgr)
             return true;
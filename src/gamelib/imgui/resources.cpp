@@ -2,6 +2,7 @@
 #include "gamelib/imgui/buttons.hpp"
 #include "gamelib/core/res/SpriteResource.hpp"
 #include "gamelib/core/res/JsonResource.hpp"
+#include "gamelib/core/res/CollisionMaskResource.hpp"
 #include "gamelib/core/Game.hpp"
 #include "imgui.h"
 #include "imgui_internal.h" // for imgui context
@@ -22,11 +23,23 @@ namespace gamelib
         {
             auto sprres = res.as<SpriteResource>();
             sprite->setTexture(*sprres->tex);
-            sprite->setTextureRect(sf::IntRect(sprres->rect.x, sprres->rect.y, sprres->rect.w, sprres->rect.h));
+            auto rect = sprres->getFrameRect(0);
+            sprite->setTextureRect(sf::IntRect(rect.x, rect.y, sprres->rect.w, sprres->rect.h));
         }
         return (bool)res;
     }
 
+    bool getThumbnailCollisionMask(BaseResourceHandle res, sf::Sprite* sprite)
+    {
+        auto mask = res.as<CollisionMaskResource>();
+        if (mask && mask->tex)
+        {
+            sprite->setTexture(*mask->tex, true);
+            return true;
+        }
+        return false;
+    }
+
     void previewTexture(BaseResourceHandle res)
     {
         previewTexture(res, -1);
@@ -92,10 +105,10 @@ namespace gamelib
             auto size = g.FontSize + g.Style.FramePadding.y * 2.0f;
             auto bsize = ImVec2(size, size);
 
-            auto rect = getSpriteRect(ani.offset, sprite->rect, sprite->tex->getSize().x, sprite->tex->getSize().y);
+            auto rect = sprite->getFrameRect(ani.offset);
             auto w = (imgsize == -1) ? ImGui::GetContentRegionAvailWidth() * 0.8 : imgsize;
-            auto h = w * ((float)rect.h / rect.w);
-            ImGui::Image(*sprite->tex, ImVec2(w, h), sf::FloatRect(rect.x, rect.y, rect.w, rect.h));
+            auto h = w * ((float)sprite->rect.h / sprite->rect.w);
+            ImGui::Image(*sprite->tex, ImVec2(w, h), sf::FloatRect(rect.x, rect.y, sprite->rect.w, sprite->rect.h));
 
             { // Animation controls
                 if (paused && ImGui::Button(">", bsize))
@@ -155,6 +168,10 @@ namespace gamelib
                 tmpname = "Json";
                 tmppreview = previewJson;
                 break;
+            case CollisionMaskResource::id:
+                tmpname = "Collision mask";
+                tmpthumb = getThumbnailCollisionMask;
+                break;
             default:
                 tmpname = "Other";
                 break;
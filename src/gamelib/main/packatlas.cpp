@@ -0,0 +1,37 @@
+#include <iostream>
+#include <cstdlib>
+#include "gamelib/core/res/ResourceManager.hpp"
+#include "gamelib/core/res/TextureAtlas.hpp"
+#include "gamelib/core/res/resources.hpp"
+#include "gamelib/utils/log.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cout<<"Packs the textures of all sprites loaded by a resource config into texture atlases."<<endl;
+        cout<<"Writes the atlas pages next to the cache file, which can be passed to packSpriteAtlases()"<<endl;
+        cout<<"at runtime to skip packing."<<endl;
+        cout<<"Usage: packatlas <resource config> <cache file> [pagesize] [padding]"<<endl;
+        return 0;
+    }
+
+    gamelib::ResourceManager resmgr;
+    gamelib::registerPredefLoaders(resmgr);
+
+    if (!resmgr.loadFromFile(argv[1]))
+        return 1;
+
+    int pagesize = argc >= 4 ? atoi(argv[3]) : 2048;
+    int padding = argc >= 5 ? atoi(argv[4]) : 1;
+
+    if (pagesize <= 0 || padding < 0)
+    {
+        LOG_ERROR("Invalid page size or padding");
+        return 1;
+    }
+
+    return gamelib::packSpriteAtlases(resmgr, argv[2], pagesize, padding, true) == 0;
+}
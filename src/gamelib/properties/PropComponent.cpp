@@ -39,13 +39,10 @@ namespace gamelib
             return false;
         }
 
-        for (auto& i : *getEntity(prop))
+        if (auto comp = getEntity(prop)->find(name, id))
         {
-            if (i.ptr->getName() == name && i.id == id)
-            {
-                *ptr = i.ptr.get();
-                return true;
-            }
+            *ptr = comp;
+            return true;
         }
 
         LOG_ERROR("Can't find component: ", generateName(name, id));
@@ -2,7 +2,7 @@
 
 namespace gamelib
 {
-    SlotMapShort<void*> LifetimeTrackerManager::_data;
+    HandleSlotMap<void*> LifetimeTrackerManager::_data;
 
     LifetimeTrackerManager::LifetimeTrackerManager()
     { }
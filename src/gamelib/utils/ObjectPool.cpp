@@ -0,0 +1,208 @@
+#include "gamelib/utils/ObjectPool.hpp"
+#include "gamelib/utils/log.hpp"
+#include <algorithm>
+#include <functional>
+#include <cassert>
+#include <new>
+
+namespace gamelib
+{
+    static_assert(ObjectPool::granularity % alignof(std::max_align_t) == 0, "Objects would be misaligned");
+    static_assert(ObjectPool::granularity >= sizeof(void*), "Free list pointers don't fit");
+    static_assert(ObjectPool::max_size % ObjectPool::granularity == 0, "Invalid max size");
+
+    ObjectPool* ObjectPool::_active = nullptr;
+
+    ObjectPool::ObjectPool() :
+        ObjectPool(GlobalTag())
+    {
+        _arenas().push_back(this);
+    }
+
+    ObjectPool::ObjectPool(GlobalTag) :
+        _cursor(nullptr),
+        _end(nullptr),
+        _size(0)
+    {
+        std::fill(_free, _free + num_classes, nullptr);
+    }
+
+    ObjectPool::~ObjectPool()
+    {
+        auto& arenas = _arenas();
+        arenas.erase(std::remove(arenas.begin(), arenas.end(), this), arenas.end());
+
+        if (_active == this)
+            _active = nullptr;
+
+        if (!release())
+        {
+            LOG_WARN("ObjectPool destroyed while ", _size, " objects are still alive -> moving them to the global pool");
+            getGlobal()._adopt(this);
+        }
+    }
+
+    void* ObjectPool::allocate(size_t size)
+    {
+        assert(size > 0 && size <= max_size && "Invalid size");
+
+        const size_t cls = (size - 1) / granularity;
+        void* ptr = _free[cls];
+
+        if (ptr)
+            _free[cls] = *static_cast<void**>(ptr);
+        else
+        {
+            const size_t classsize = (cls + 1) * granularity;
+            if (size_t(_end - _cursor) < classsize)
+            {
+                // The rest of the old chunk is wasted, at most max_size bytes
+                char* chunk = static_cast<char*>(::operator new(chunk_size));
+                _chunks.insert(std::upper_bound(_chunks.begin(), _chunks.end(), chunk, std::less<char*>()), chunk);
+                _cursor = chunk;
+                _end = chunk + chunk_size;
+            }
+
+            ptr = _cursor;
+            _cursor += classsize;
+        }
+
+        ++_size;
+        return ptr;
+    }
+
+    void ObjectPool::free(void* ptr, size_t size)
+    {
+        if (!ptr)
+            return;
+
+        assert(size > 0 && size <= max_size && "Invalid size");
+        assert(owns(ptr) && "Memory doesn't belong to this pool");
+
+        const size_t cls = (size - 1) / granularity;
+        *static_cast<void**>(ptr) = _free[cls];
+        _free[cls] = ptr;
+        --_size;
+    }
+
+    bool ObjectPool::owns(const void* ptr) const
+    {
+        const char* p = static_cast<const char*>(ptr);
+        auto it = std::upper_bound(_chunks.begin(), _chunks.end(), p, std::less<const char*>());
+        if (it == _chunks.begin())
+            return false;
+        --it;
+        return std::less<const char*>()(p, *it + chunk_size);
+    }
+
+    bool ObjectPool::release()
+    {
+        if (_size != 0)
+            return false;
+
+        for (auto chunk : _chunks)
+            ::operator delete(chunk);
+
+        _chunks.clear();
+        std::fill(_free, _free + num_classes, nullptr);
+        _cursor = _end = nullptr;
+        return true;
+    }
+
+    size_t ObjectPool::size() const
+    {
+        return _size;
+    }
+
+    size_t ObjectPool::getNumChunks() const
+    {
+        return _chunks.size();
+    }
+
+
+    void* ObjectPool::allocateObject(size_t size)
+    {
+        if (size > max_size)
+            return ::operator new(size);
+
+        return (_active ? *_active : getGlobal()).allocate(size);
+    }
+
+    void ObjectPool::freeObject(void* ptr, size_t size)
+    {
+        if (size > max_size)
+        {
+            ::operator delete(ptr);
+            return;
+        }
+
+        for (auto arena : _arenas())
+            if (arena->owns(ptr))
+            {
+                arena->free(ptr, size);
+                return;
+            }
+
+        getGlobal().free(ptr, size);
+    }
+
+    ObjectPool& ObjectPool::getGlobal()
+    {
+        // Never destroyed, objects might be freed during static destruction
+        static ObjectPool* pool = new ObjectPool(GlobalTag());
+        return *pool;
+    }
+
+    void ObjectPool::setArena(ObjectPool* arena)
+    {
+        assert(arena != &getGlobal() && "Use nullptr to allocate from the global pool");
+        _active = arena;
+    }
+
+    ObjectPool* ObjectPool::getArena()
+    {
+        return _active;
+    }
+
+    ObjectPool::ScopedArena::ScopedArena(ObjectPool* arena) :
+        _arena(arena),
+        _prev(_active)
+    {
+        if (_arena)
+            setArena(_arena);
+    }
+
+    ObjectPool::ScopedArena::~ScopedArena()
+    {
+        if (_arena)
+            setArena(_prev);
+    }
+
+
+    void ObjectPool::_adopt(ObjectPool* pool)
+    {
+        for (size_t cls = 0; cls < num_classes; ++cls)
+            while (pool->_free[cls])
+            {
+                void* ptr = pool->_free[cls];
+                pool->_free[cls] = *static_cast<void**>(ptr);
+                *static_cast<void**>(ptr) = _free[cls];
+                _free[cls] = ptr;
+            }
+
+        _chunks.insert(_chunks.end(), pool->_chunks.begin(), pool->_chunks.end());
+        std::sort(_chunks.begin(), _chunks.end(), std::less<char*>());
+        _size += pool->_size;
+
+        pool->_chunks.clear();
+        pool->_cursor = pool->_end = nullptr;
+        pool->_size = 0;
+    }
+
+    std::vector<ObjectPool*>& ObjectPool::_arenas()
+    {
+        // Never destroyed, see getGlobal()
+        static auto arenas = new std::vector<ObjectPool*>();
+        return *arenas;
+    }
+}
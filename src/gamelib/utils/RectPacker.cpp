@@ -0,0 +1,134 @@
+#include "gamelib/utils/RectPacker.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace gamelib
+{
+    RectPacker::RectPacker(int width, int height)
+    {
+        reset(width, height);
+    }
+
+    void RectPacker::reset(int width, int height)
+    {
+        _width = width;
+        _height = height;
+        _usedarea = 0;
+        _usedsize = math::Vec2i();
+        _skyline.clear();
+        _skyline.push_back({ 0, 0, width });
+    }
+
+    bool RectPacker::insert(int w, int h, math::Vec2i* pos)
+    {
+        if (w <= 0 || h <= 0)
+            return false;
+
+        // Find the segment where the rect's top edge is lowest,
+        // prefer narrow segments to keep wide ones for wide rects
+        size_t best = _skyline.size();
+        int besttop = INT_MAX, bestwidth = INT_MAX, besty = 0;
+
+        for (size_t i = 0; i < _skyline.size(); ++i)
+        {
+            int y;
+            if (!_fit(i, w, h, &y))
+                continue;
+
+            if (y + h < besttop || (y + h == besttop && _skyline[i].w < bestwidth))
+            {
+                best = i;
+                besttop = y + h;
+                bestwidth = _skyline[i].w;
+                besty = y;
+            }
+        }
+
+        if (best == _skyline.size())
+            return false;
+
+        const int x = _skyline[best].x;
+        _skyline.insert(_skyline.begin() + best, { x, besty + h, w });
+
+        // Shrink or remove the segments covered by the new one
+        for (size_t i = best + 1; i < _skyline.size();)
+        {
+            Segment& seg = _skyline[i];
+            const int overlap = x + w - seg.x;
+
+            if (overlap <= 0)
+                break;
+
+            if (overlap < seg.w)
+            {
+                seg.x += overlap;
+                seg.w -= overlap;
+                break;
+            }
+
+            _skyline.erase(_skyline.begin() + i);
+        }
+
+        // Merge neighbours of equal height
+        for (size_t i = 0; i + 1 < _skyline.size();)
+        {
+            if (_skyline[i].y == _skyline[i + 1].y)
+            {
+                _skyline[i].w += _skyline[i + 1].w;
+                _skyline.erase(_skyline.begin() + i + 1);
+            }
+            else
+                ++i;
+        }
+
+        pos->x = x;
+        pos->y = besty;
+        _usedarea += (long)w * h;
+        _usedsize.x = std::max(_usedsize.x, x + w);
+        _usedsize.y = std::max(_usedsize.y, besty + h);
+        return true;
+    }
+
+    int RectPacker::getWidth() const
+    {
+        return _width;
+    }
+
+    int RectPacker::getHeight() const
+    {
+        return _height;
+    }
+
+    math::Vec2i RectPacker::getUsedSize() const
+    {
+        return _usedsize;
+    }
+
+    float RectPacker::getOccupancy() const
+    {
+        if (_width <= 0 || _height <= 0)
+            return 0;
+        return (float)_usedarea / ((long)_width * _height);
+    }
+
+    bool RectPacker::_fit(size_t index, int w, int h, int* y) const
+    {
+        const int x = _skyline[index].x;
+        if (x + w > _width)
+            return false;
+
+        // The rect rests on the highest segment below it
+        int top = 0;
+        int left = w;
+        for (size_t i = index; left > 0; ++i)
+        {
+            top = std::max(top, _skyline[i].y);
+            if (top + h > _height)
+                return false;
+            left -= _skyline[i].w;
+        }
+
+        *y = top;
+        return true;
+    }
+}
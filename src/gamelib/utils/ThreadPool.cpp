@@ -0,0 +1,146 @@
+#include "gamelib/utils/ThreadPool.hpp"
+#include <cassert>
+
+namespace gamelib
+{
+    ThreadPool::ThreadPool(size_t numthreads) :
+        _queues(new Queue[numthreads + 1]),
+        _callback(nullptr),
+        _me(nullptr),
+        _remaining(0),
+        _generation(0),
+        _active(0),
+        _quit(false)
+    {
+        _threads.reserve(numthreads);
+        for (size_t i = 1; i <= numthreads; ++i)
+            _threads.emplace_back(&ThreadPool::_loop, this, i);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _quit = true;
+        }
+        _wakeup.notify_all();
+
+        for (auto& i : _threads)
+            i.join();
+    }
+
+    void ThreadPool::run(size_t numtasks, TaskCallback callback, void* me)
+    {
+        if (numtasks == 0)
+            return;
+
+        if (_threads.empty() || numtasks == 1)
+        {
+            for (size_t i = 0; i < numtasks; ++i)
+                callback(me, i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            assert(_remaining == 0 && "ThreadPool::run() is not reentrant");
+
+            _callback = callback;
+            _me = me;
+            _remaining = numtasks;
+
+            const size_t numqueues = _threads.size() + 1;
+            for (size_t i = 0; i < numtasks; ++i)
+            {
+                Queue& queue = _queues[i % numqueues];
+                std::lock_guard<std::mutex> queueguard(queue.lock);
+                queue.tasks.push_back(i);
+            }
+            ++_generation;
+        }
+        _wakeup.notify_all();
+
+        _work(0);
+
+        std::unique_lock<std::mutex> guard(_lock);
+        _done.wait(guard, [this]() { return _remaining == 0 && _active == 0; });
+    }
+
+    size_t ThreadPool::getNumThreads() const
+    {
+        return _threads.size();
+    }
+
+    size_t ThreadPool::getDefaultThreads()
+    {
+        const size_t hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 0;
+    }
+
+
+    void ThreadPool::_loop(size_t index)
+    {
+        size_t generation = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> guard(_lock);
+                _wakeup.wait(guard, [&]() { return _quit || _generation != generation; });
+                if (_quit)
+                    return;
+                generation = _generation;
+                ++_active;
+            }
+
+            _work(index);
+
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                --_active;
+            }
+            _done.notify_all();
+        }
+    }
+
+    void ThreadPool::_work(size_t index)
+    {
+        size_t task;
+        while (_pop(index, &task))
+        {
+            _callback(_me, task);
+            --_remaining;
+        }
+    }
+
+    bool ThreadPool::_pop(size_t index, size_t* task)
+    {
+        const size_t numqueues = _threads.size() + 1;
+
+        {
+            Queue& queue = _queues[index];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.tasks.empty())
+            {
+                *task = queue.tasks.back();
+                queue.tasks.pop_back();
+                return true;
+            }
+        }
+
+        // Steal from the others
+        for (size_t i = 1; i < numqueues; ++i)
+        {
+            Queue& queue = _queues[(index + i) % numqueues];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.tasks.empty())
+            {
+                *task = queue.tasks.front();
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,65 @@
+#include <cassert>
+#include "gamelib/core/ecs/Entity.hpp"
+#include "gamelib/core/ecs/EntityFactory.hpp"
+#include "gamelib/core/ecs/serialization.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+#include "gamelib/components/geometry/AABB.hpp"
+#include "gamelib/components/geometry/AABBMask.hpp"
+
+using namespace gamelib;
+
+bool equal(const math::AABBf& a, const math::AABBf& b)
+{
+    return a.pos == b.pos && a.size == b.size;
+}
+
+bool hits(const CollisionSystem& colsys, const math::Point2f& point, const Collidable* obj)
+{
+    return colsys.intersectAll(point, nullptr, 0, [&](Collidable* col) {
+            return col == obj;
+        });
+}
+
+int main()
+{
+    CollisionSystem colsys;
+    EntityFactory factory;
+    factory.addComponent<AABB>();
+    factory.addComponent<AABBMask>();
+
+    // Registering a mask without a component must work
+    Json::Value config;
+    getDefaultComponentConfig(AABBMask::name(), &config, factory);
+    assert(colsys.size() == 0 && "Component not removed");
+
+    Entity ent;
+    auto aabb = ent.add(factory.createComponent(AABB::name())).as<AABB>();
+    auto mask = ent.add(factory.createComponent(AABBMask::name())).as<AABBMask>();
+    assert(aabb && mask && "Failed to create components");
+    assert(colsys.size() == 2 && "Components not registered");
+    assert(equal(mask->getBBox(), math::AABBf()) && "Mask without component should be empty");
+
+    aabb->setSize(10, 10);
+    aabb->setPosition(100, 100);
+    assert(mask->setComponent(aabb) && "Failed to set component");
+    assert(equal(mask->getBBox(), aabb->getBBox()) && "Wrong bbox");
+    assert(hits(colsys, math::Point2f(105, 105), mask.get()) && "Mask not found");
+
+    // Moving or resizing the component refits the mask
+    aabb->setPosition(500, 300);
+    assert(!hits(colsys, math::Point2f(105, 105), mask.get()) && "Mask not refitted");
+    assert(hits(colsys, math::Point2f(505, 305), mask.get()) && "Mask not refitted");
+
+    aabb->setSize(50, 50);
+    assert(hits(colsys, math::Point2f(540, 340), mask.get()) && "Mask not refitted");
+
+    // Destroying the component empties the mask
+    ent.remove(aabb);
+    assert(equal(mask->getBBox(), math::AABBf()) && "Mask should be empty");
+    assert(!hits(colsys, math::Point2f(505, 305), mask.get()) && "Mask not refitted");
+
+    ent.destroy();
+    assert(colsys.size() == 0 && "Components not removed");
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include "gamelib/core/geometry/AABBTree.hpp"
+#include "gamelib/core/geometry/LinearBroadphase.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+struct TestObject
+{
+    math::AABBf bbox;
+    int treeproxy;
+    int linearproxy;
+};
+
+math::AABBf randomBox()
+{
+    return math::AABBf(rand() % 1000, rand() % 1000, 1 + rand() % 50, 1 + rand() % 50);
+}
+
+Collidable* toCollidable(size_t i)
+{
+    return reinterpret_cast<Collidable*>(i + 1);
+}
+
+void checkQuery(const AABBTree& tree, const LinearBroadphase& linear, const math::AABBf& rect,
+        const std::vector<TestObject>& objects)
+{
+    std::vector<Collidable*> treeresult, linearresult;
+    tree.query(rect, &treeresult);
+    linear.query(rect, &linearresult);
+
+    // The tree is conservative, so it must find at least every object the linear search found
+    for (auto i : linearresult)
+        assert(std::find(treeresult.begin(), treeresult.end(), i) != treeresult.end() && "Object not found");
+
+    // Every result must overlap at least the enlarged query rect
+    for (auto i : treeresult)
+    {
+        size_t index = reinterpret_cast<size_t>(i) - 1;
+        assert(index < objects.size() && "Invalid object");
+        assert(overlaps(tree.getFatBBox(objects[index].treeproxy), rect) && "Wrong result");
+    }
+}
+
+void checkSweep(const AABBTree& tree, const std::vector<TestObject>& objects, const std::vector<bool>& alive)
+{
+    auto rect = randomBox();
+    math::Vec2f vel(rand() % 1001 - 500, rand() % 1001 - 500);
+
+    // Compute the nearest hit by brute force
+    float nearest = 1;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        float time;
+        if (alive[i] && sweepTime(rect, vel, objects[i].bbox, 1, &time))
+            nearest = std::min(nearest, time);
+    }
+
+    struct State
+    {
+        const math::AABBf* rect;
+        const math::Vec2f* vel;
+        const std::vector<TestObject>* objects;
+        float nearest;
+    } state = { &rect, &vel, &objects, 1 };
+
+    tree.sweep(rect, vel, [](void* me, Collidable* obj) {
+            auto state = static_cast<State*>(me);
+            size_t index = reinterpret_cast<size_t>(obj) - 1;
+            float time;
+            if (sweepTime(*state->rect, *state->vel, (*state->objects)[index].bbox, 1, &time))
+                state->nearest = std::min(state->nearest, time);
+            return state->nearest;
+        }, &state);
+
+    assert(state.nearest == nearest && "Sweep missed the nearest object");
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    AABBTree tree;
+    LinearBroadphase linear;
+    std::vector<TestObject> objects;
+    std::vector<bool> alive;
+
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        TestObject obj;
+        obj.bbox = randomBox();
+        obj.treeproxy = tree.add(toCollidable(objects.size()), obj.bbox);
+        obj.linearproxy = linear.add(toCollidable(objects.size()), obj.bbox);
+        objects.push_back(obj);
+        alive.push_back(true);
+    }
+
+    assert(tree.size() == 2000 && "Wrong size");
+    assert(tree.getHeight() < 40 && "Tree is not balanced");
+
+    for (size_t round = 0; round < 5000; ++round)
+    {
+        size_t index = rand() % objects.size();
+        auto& obj = objects[index];
+
+        switch (rand() % 3)
+        {
+            case 0: // move
+                if (!alive[index])
+                    break;
+                obj.bbox.x += rand() % 21 - 10;
+                obj.bbox.y += rand() % 21 - 10;
+                tree.update(obj.treeproxy, obj.bbox);
+                linear.update(obj.linearproxy, obj.bbox);
+                break;
+            case 1: // remove / readd
+                if (alive[index])
+                {
+                    tree.remove(obj.treeproxy);
+                    linear.remove(obj.linearproxy);
+                }
+                else
+                {
+                    obj.treeproxy = tree.add(toCollidable(index), obj.bbox);
+                    obj.linearproxy = linear.add(toCollidable(index), obj.bbox);
+                }
+                alive[index] = !alive[index];
+                break;
+            case 2:
+                checkQuery(tree, linear, randomBox(), objects);
+                checkSweep(tree, objects, alive);
+                break;
+        }
+
+        assert(tree.size() == linear.size() && "Wrong size");
+    }
+
+    for (size_t i = 0; i < objects.size(); ++i)
+        if (alive[i])
+            tree.remove(objects[i].treeproxy);
+
+    assert(tree.size() == 0 && "Tree should be empty");
+    assert(tree.getHeight() == 0 && "Tree should be empty");
+
+    std::vector<Collidable*> result;
+    tree.query(math::AABBf(0, 0, 1000, 1000), &result);
+    assert(result.empty() && "Tree should be empty");
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "gamelib/core/ecs/ArchetypeStorage.hpp"
+#include <cassert>
+#include <vector>
+
+using namespace gamelib;
+
+class FooComponent : public Identifier<0x2b8e4f1a, Component>
+{
+    public:
+        ASSIGN_NAMETAG("FooComponent");
+        FooComponent(int x_) : x(x_) {}
+        int x;
+};
+
+class BarComponent : public Identifier<0x5c07d3e9, Component>
+{
+    public:
+        ASSIGN_NAMETAG("BarComponent");
+        BarComponent(int x_) : x(x_) {}
+        int x;
+};
+
+class BazComponent : public Identifier<0x71a9b264, Component>
+{
+    public:
+        ASSIGN_NAMETAG("BazComponent");
+};
+
+// Same category (ID) as BazComponent
+class QuxComponent : public Identifier<0x71a9b264, Component>
+{
+    public:
+        ASSIGN_NAMETAG("QuxComponent");
+        QuxComponent(int x_) : x(x_) {}
+        int x;
+};
+
+void checkRows(const ArchetypeStorage& storage)
+{
+    for (auto& arch : storage.getArchetypes())
+        for (auto& col : arch.columns)
+        {
+            assert(col.size() == arch.entities.size() && "Column size mismatch");
+            for (auto comp : col)
+                assert(comp && "Empty cell");
+        }
+}
+
+int main()
+{
+    std::vector<EntityPtr> ents;
+
+    // Entities created before the storage are registered manually
+    ents.emplace_back(new Entity());
+    ents.back()->add<FooComponent>(-1);
+
+    ArchetypeStorage storage;
+    assert(storage.size() == 0 && "Wrong size");
+    storage.add(ents[0].get());
+    storage.add(ents[0].get());
+    assert(storage.size() == 1 && "Entity registered twice");
+
+    // Entities register themselves while a storage is active
+    for (int i = 1; i < 100; ++i)
+    {
+        ents.emplace_back(new Entity());
+        ents.back()->add<FooComponent>(i);
+        if (i % 2)
+            ents.back()->add<BarComponent>(i);
+        if (i % 3 == 0)
+            ents.back()->add<BazComponent>();
+    }
+
+    assert(storage.size() == 100 && "Wrong size");
+    assert(storage.count<FooComponent>() == 100 && "Wrong count");
+    assert((storage.count<FooComponent, BarComponent>() == 50) && "Wrong count");
+    assert((storage.count<BarComponent, BazComponent>() == 17) && "Wrong count");
+    checkRows(storage);
+
+    int n = 0;
+    storage.each<BarComponent, FooComponent>([&](Entity& ent, BarComponent& bar, FooComponent& foo) {
+            assert(foo.x == bar.x && "Components of different entities");
+            assert(ent.findByType<FooComponent>().get() == &foo && "Wrong entity");
+            ++n;
+        });
+    assert(n == 50 && "Wrong amount of entities iterated");
+
+    // Removing components moves entities to other archetypes
+    for (int i = 1; i < 100; i += 2)
+        ents[i]->remove(ents[i]->findByType<FooComponent>());
+
+    assert(storage.count<FooComponent>() == 50 && "Wrong count after removing");
+    assert((storage.count<FooComponent, BarComponent>() == 0) && "Wrong count after removing");
+    assert(storage.count<BarComponent>() == 50 && "Wrong count after removing");
+    checkRows(storage);
+
+    // The first component of a type is used
+    auto second = ents[0]->add<FooComponent>(1000);
+    storage.each<FooComponent>([&](Entity& ent, FooComponent& foo) {
+            if (&ent == ents[0].get())
+                assert(foo.x == -1 && "Wrong component");
+        });
+    ents[0]->remove(ents[0]->findByType<FooComponent>());
+    storage.each<FooComponent>([&](Entity& ent, FooComponent& foo) {
+            if (&ent == ents[0].get())
+                assert(&foo == second.get() && "Wrong component");
+        });
+
+    // Destroyed entities unregister themselves
+    ents[4].reset();
+    ents[5]->clearComponents();
+    assert(storage.size() == 99 && "Wrong size after destroying");
+    assert(storage.count<FooComponent>() == 49 && "Wrong count after destroying");
+    checkRows(storage);
+
+    // Components sharing an ID are different types
+    ents[6]->add<QuxComponent>(6);
+    ents[7]->add<QuxComponent>(7);
+    assert(storage.count<QuxComponent>() == 2 && "Wrong count with shared IDs");
+    assert((storage.count<BazComponent, QuxComponent>() == 1) && "Wrong count with shared IDs");
+    assert((storage.count<BarComponent, QuxComponent>() == 1) && "Wrong count with shared IDs");
+    checkRows(storage);
+
+    n = 0;
+    storage.each<QuxComponent>([&](Entity& ent, QuxComponent& qux) {
+            assert(ent.findByName<QuxComponent>().get() == &qux && "Wrong component");
+            ++n;
+        });
+    assert(n == 2 && "Wrong amount of entities iterated");
+
+    // Components are allocated from the arena of their type, unless another
+    // arena is set
+    auto quxarena = storage.getArena(getTypeIndex<QuxComponent>());
+    storage.each<QuxComponent>([&](Entity&, QuxComponent& qux) {
+            assert(quxarena->owns(&qux) && "Not allocated from the type's arena");
+            assert(!storage.getArena(getTypeIndex<BazComponent>())->owns(&qux) && "Allocated from the wrong arena");
+        });
+
+    {
+        ObjectPool level;
+        ObjectPool::setArena(&level);
+        auto qux = ents[8]->add<QuxComponent>(8);
+        ObjectPool::setArena(nullptr);
+        assert(level.owns(qux.get()) && !quxarena->owns(qux.get()) && "Explicit arena not used");
+        ents[8]->clearComponents();
+    }
+
+    storage.clear();
+    assert(storage.size() == 0 && storage.count<FooComponent>() == 0 && "Not cleared");
+
+    // Readding after clearing
+    ents[1]->addChild(std::move(ents[2]));
+    storage.addSubtree(ents[1].get());
+    assert(storage.size() == 2 && "Wrong size after adding a subtree");
+    assert((storage.count<FooComponent, BarComponent>() == 0) && "Wrong count after adding a subtree");
+    assert(storage.count<FooComponent>() == 1 && "Wrong count after adding a subtree");
+
+    ents.clear();
+    assert(storage.size() == 0 && "Entities not unregistered");
+
+    return 0;
+}
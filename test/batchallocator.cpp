@@ -31,6 +31,25 @@ void allocateRandom(BatchAllocator<int>& ba, std::vector<TestData>& handles)
     }
 }
 
+// Compacts and checks that the budget was kept, except for a single
+// block larger than the budget
+size_t compact(BatchAllocator<int>& ba, std::vector<BatchRelocation>* relocations, size_t budget)
+{
+    const size_t numfree = ba.getNumFreeBlocks();
+    const size_t first = relocations->size();
+    const size_t moved = ba.compact(relocations, budget);
+
+    size_t relocated = 0;
+    for (size_t i = first; i < relocations->size(); ++i)
+        relocated += (*relocations)[i].size;
+
+    assert(relocated == moved && "Wrong amount of moved elements");
+    assert((numfree == 0 || moved > 0) && "Compaction did not progress");
+    assert((moved <= budget || (relocations->size() == first + 1 && moved <= max_size))
+            && "Compaction exceeded the budget");
+    return moved;
+}
+
 void printdebug(BatchAllocator<int>& ba, const std::string& title = "")
 {
     using namespace std;
@@ -39,8 +58,9 @@ void printdebug(BatchAllocator<int>& ba, const std::string& title = "")
         std::cout<<title<<endl;
     cout<<"size: "<<ba._data.size()<<endl;
     cout<<"freelist: ";
-    for (auto& i : ba._freelist)
-        cout<<i.index<<"+"<<i.size<<", ";
+    for (size_t i = 0; i < ba._data.size(); ++i)
+        if (ba._freeBegin(i) != -1)
+            cout<<i<<"+"<<ba._blocks[ba._freeBegin(i)].size<<", ";
     cout<<endl<<"--------------------"<<endl;
 }
 
@@ -76,6 +96,48 @@ int main()
             }
         }
 
+        // Live blocks must not overlap
+        for (size_t i = 0; i < handles.size(); ++i)
+            for (size_t k = i + 1; k < handles.size(); ++k)
+            {
+                auto& a = handles[i].handle;
+                auto& b = handles[k].handle;
+                assert((a.index + a.size <= b.index || b.index + b.size <= a.index) && "Blocks overlap");
+            }
+
+        // Compact partially or completely and patch the handles
+        size_t livesize = 0;
+        for (auto& i : handles)
+            livesize += i.handle.size;
+
+        assert(ba.getSize() - ba.getFreeSize() == livesize && "Wrong free size");
+
+        std::vector<BatchRelocation> relocations;
+        const bool full = episode % 2 == 0;
+        if (full)
+        {
+            while (ba.getNumFreeBlocks() > 0)
+                compact(ba, &relocations, 1 + rand() % max_size);
+        }
+        else
+            compact(ba, &relocations, 1 + rand() % (max_size * 4));
+
+        for (size_t i = 1; i < relocations.size(); ++i)
+            assert(relocations[i - 1].from < relocations[i].from && "Relocations not ordered");
+
+        for (auto& i : handles)
+            for (auto& r : relocations)
+                r.apply(&i.handle.index);
+
+        if (full)
+        {
+            assert(ba.getSize() == livesize && ba.getFragmentation() == 0 && "Compaction left free blocks");
+        }
+        else
+        {
+            assert(ba.getSize() - ba.getFreeSize() == livesize && "Wrong free size after compaction");
+        }
+
         // cout<<"Freeing remaining handles ("<<handles.size()<<")"<<endl;
 
         for (auto& i : handles)
@@ -94,7 +156,7 @@ int main()
         handles.clear();
 
         // printdebug(ba);
-        assert(ba._freelist.size() == 0 && "_freelist should be empty");
+        assert(ba.getNumFreeBlocks() == 0 && ba.getFreeSize() == 0 && "Free blocks left");
         assert(ba._data.size() == 0 && "_data should be empty");
     }
 
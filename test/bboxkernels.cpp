@@ -0,0 +1,110 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include "gamelib/core/geometry/BBoxArray.hpp"
+#include "gamelib/core/geometry/Broadphase.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+std::mt19937 rng;
+
+float randomFloat(float min, float max)
+{
+    // Produce some exact integers and zeros to hit edge cases (touching boxes)
+    switch (rng() % 4)
+    {
+        case 0:
+            return std::uniform_int_distribution<int>(min, max)(rng);
+        case 1:
+            return 0;
+        default:
+            return std::uniform_real_distribution<float>(min, max)(rng);
+    }
+}
+
+math::AABBf randomBox()
+{
+    return math::AABBf(randomFloat(-100, 100), randomFloat(-100, 100), randomFloat(0, 50), randomFloat(0, 50));
+}
+
+int main()
+{
+    auto seed = time(0);
+    rng.seed(seed);
+    cout<<"seed: "<<seed<<endl;
+    cout<<"kernel: "<<getBBoxKernelName()<<endl;
+
+    std::vector<uint8_t> mask, maskscalar;
+    std::vector<float> times, timesscalar;
+
+    for (size_t round = 0; round < 500; ++round)
+    {
+        // Odd sizes to test the remainder loops
+        BBoxArray boxes;
+        std::vector<math::AABBf> reference;
+        const size_t num = rng() % 67;
+        for (size_t i = 0; i < num; ++i)
+        {
+            reference.push_back(randomBox());
+            boxes.add(reference.back());
+        }
+
+        if (num > 0 && rng() % 2)
+        {
+            const size_t index = rng() % num;
+            reference[index] = reference.back();
+            reference.pop_back();
+            boxes.swapRemove(index);
+        }
+        assert(boxes.size() == reference.size() && "Wrong size");
+
+        const BBoxRef ref = boxes.ref();
+        mask.assign(ref.size, 2);
+        maskscalar.assign(ref.size, 3);
+        times.assign(ref.size, 2);
+        timesscalar.assign(ref.size, 3);
+
+        for (size_t query = 0; query < 20; ++query)
+        {
+            const math::AABBf rect = randomBox();
+            const math::Vec2f vel(randomFloat(-200, 200), randomFloat(-200, 200));
+            const float maxtime = query % 2 ? 1 : randomFloat(0, 1);
+
+            overlapBoxes(ref, rect, mask.data());
+            overlapBoxesScalar(ref, rect, maskscalar.data());
+            assert(mask == maskscalar && "SIMD and scalar overlap results differ");
+
+            for (size_t i = 0; i < ref.size; ++i)
+                assert(mask[i] == overlaps(reference[i], rect) && "Wrong overlap result");
+
+            sweepBoxes(ref, rect, vel, maxtime, times.data());
+            sweepBoxesScalar(ref, rect, vel, maxtime, timesscalar.data());
+            assert(std::memcmp(times.data(), timesscalar.data(), times.size() * sizeof(float)) == 0
+                    && "SIMD and scalar sweep results differ");
+
+            for (size_t i = 0; i < ref.size; ++i)
+            {
+                float time;
+                bool hit = sweepTime(rect, vel, reference[i], maxtime, &time);
+                // sweepTime() computes the box extents slightly differently,
+                // so only clear cases are compared.
+                if (times[i] != bbox_nohit && hit)
+                    assert(std::abs(times[i] - time) < 1e-3 && "Wrong sweep result");
+            }
+        }
+
+        // Packed copies must behave the same
+        std::vector<float> buffer;
+        const BBoxRef packed = packBoxes(reference.data(), reference.size(), &buffer);
+        const math::AABBf rect = randomBox();
+        overlapBoxes(packed, rect, mask.data());
+        overlapBoxesScalar(ref, rect, maskscalar.data());
+        assert(mask == maskscalar && "Packed boxes differ");
+    }
+
+    return 0;
+}
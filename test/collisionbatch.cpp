@@ -0,0 +1,114 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include <memory>
+#include "math/geometry/intersect.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+class Box : public Collidable
+{
+    public:
+        Box(const math::AABBf& rect, unsigned int flags) :
+            Collidable(flags),
+            _rect(rect)
+        { }
+
+        auto intersect(const math::Point2f& point) const -> bool final override
+        {
+            return math::intersect(_rect, point);
+        }
+
+        auto intersect(const math::Line2f& line) const -> Intersection final override
+        {
+            return math::intersect(line, _rect);
+        }
+
+        auto intersect(const math::AABBf& rect) const -> Intersection final override
+        {
+            return math::intersect(_rect, rect);
+        }
+
+        auto sweep(const math::AABBf& rect, const math::Vec2f& vel) const -> Intersection final override
+        {
+            return math::sweep(rect, vel, _rect);
+        }
+
+        auto getBBox() const -> math::AABBf final override
+        {
+            return _rect;
+        }
+
+    private:
+        math::AABBf _rect;
+};
+
+math::AABBf randomBox()
+{
+    return math::AABBf(rand() % 2000, rand() % 2000, 1 + rand() % 50, 1 + rand() % 50);
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    const unsigned int flags[] = { collision_solid, collision_solid | collision_noprecise, collision_physicsdrag };
+
+    CollisionSystem colsys;
+    vector<unique_ptr<Box>> boxes;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        // Duplicates test the "newest on top" order
+        if (i > 0 && rand() % 10 == 0)
+            boxes.emplace_back(new Box(boxes.back()->getBBox(), collision_solid));
+        else
+            boxes.emplace_back(new Box(randomBox(), flags[rand() % 3]));
+        colsys.add(boxes.back().get());
+    }
+
+    vector<TraceQuery> traces;
+    vector<IntersectQuery> intersects;
+    for (size_t i = 0; i < 500; ++i)
+    {
+        const Collidable* self = rand() % 4 == 0 ? boxes[rand() % boxes.size()].get() : nullptr;
+        unsigned int queryflags = rand() % 2 ? 0 : flags[rand() % 3];
+        math::Vec2f vel(rand() % 201 - 100, rand() % 201 - 100);
+        auto rect = randomBox();
+        if (self && rand() % 2)
+            rect = self->getBBox();
+
+        traces.push_back({ rect, vel, self, queryflags });
+        intersects.push_back({ rect, self, queryflags });
+    }
+
+    vector<TraceResult> traceresults(traces.size());
+    vector<Collidable*> intersectresults(intersects.size());
+    colsys.traceBatch(traces.data(), traces.size(), traceresults.data());
+    colsys.intersectBatch(intersects.data(), intersects.size(), intersectresults.data());
+
+    for (size_t i = 0; i < traces.size(); ++i)
+    {
+        auto& q = traces[i];
+        TraceResult tr = colsys.trace(q.rect, q.vel, q.self, q.flags);
+        assert(tr.obj == traceresults[i].obj && "Different trace result");
+        assert((!tr || tr.isec.near == traceresults[i].isec.near) && "Different trace result");
+    }
+
+    for (size_t i = 0; i < intersects.size(); ++i)
+    {
+        auto& q = intersects[i];
+        assert(colsys.intersect(q.rect, q.self, q.flags) == intersectresults[i] && "Different intersect result");
+    }
+
+    // Empty batches must not crash
+    colsys.traceBatch(nullptr, 0, nullptr);
+    colsys.intersectBatch(nullptr, 0, nullptr);
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include <memory>
+#include "json/json.h"
+#include "math/geometry/intersect.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+class Box : public Collidable
+{
+    public:
+        Box(const math::AABBf& rect, unsigned int flags) :
+            Collidable(flags),
+            _rect(rect)
+        { }
+
+        auto intersect(const math::Point2f& point) const -> bool final override
+        {
+            return math::intersect(_rect, point);
+        }
+
+        auto intersect(const math::Line2f& line) const -> Intersection final override
+        {
+            return math::intersect(line, _rect);
+        }
+
+        auto intersect(const math::AABBf& rect) const -> Intersection final override
+        {
+            return math::intersect(_rect, rect);
+        }
+
+        auto sweep(const math::AABBf& rect, const math::Vec2f& vel) const -> Intersection final override
+        {
+            return math::sweep(rect, vel, _rect);
+        }
+
+        auto getBBox() const -> math::AABBf final override
+        {
+            return _rect;
+        }
+
+    private:
+        math::AABBf _rect;
+};
+
+math::AABBf randomBox()
+{
+    return math::AABBf(rand() % 1000, rand() % 1000, 1 + rand() % 50, 1 + rand() % 50);
+}
+
+unsigned int effectiveLayers(const CollisionSystem& colsys, const Collidable* self, unsigned int layers)
+{
+    return self ? layers & colsys.getLayerMask(self->getLayer()) : layers;
+}
+
+bool accepts(const Collidable* c, const Collidable* self, unsigned int flags, unsigned int layers)
+{
+    return c != self && (!flags || c->flags & flags) && (layers & (1u << c->getLayer()));
+}
+
+// Newest matching object, like CollisionSystem::intersect()
+Collidable* bruteIntersect(const vector<unique_ptr<Box>>& boxes, const math::AABBf& rect,
+        const Collidable* self, unsigned int flags, unsigned int layers)
+{
+    for (size_t i = boxes.size(); i-- > 0;)
+        if (accepts(boxes[i].get(), self, flags, layers) && boxes[i]->intersect(rect))
+            return boxes[i].get();
+    return nullptr;
+}
+
+// Nearest hit, newest first on ties, like CollisionSystem::trace()
+TraceResult bruteTrace(const vector<unique_ptr<Box>>& boxes, const math::AABBf& rect, const math::Vec2f& vel,
+        const Collidable* self, unsigned int flags, unsigned int layers)
+{
+    TraceResult nearest;
+    for (size_t i = boxes.size(); i-- > 0;)
+    {
+        if (!accepts(boxes[i].get(), self, flags, layers))
+            continue;
+
+        auto isec = boxes[i]->sweep(rect, vel);
+        if (isec && (!nearest || isec.near < nearest.isec.near))
+            nearest = TraceResult(boxes[i].get(), isec);
+    }
+    return nearest;
+}
+
+void checkQueries(const CollisionSystem& colsys, const vector<unique_ptr<Box>>& boxes)
+{
+    vector<TraceQuery> traces;
+    vector<IntersectQuery> intersects;
+
+    for (size_t i = 0; i < 300; ++i)
+    {
+        const Collidable* self = rand() % 2 ? boxes[rand() % boxes.size()].get() : nullptr;
+        unsigned int flags = rand() % 2 ? 0 : collision_solid;
+        unsigned int layers = rand() % 3 ? rand() % 16 : collision_alllayers;
+        math::Vec2f vel(rand() % 201 - 100, rand() % 201 - 100);
+        auto rect = randomBox();
+        const unsigned int effective = effectiveLayers(colsys, self, layers);
+
+        auto col = colsys.intersect(rect, self, flags, layers);
+        assert(col == bruteIntersect(boxes, rect, self, flags, effective) && "Wrong intersect result");
+        assert((!col || (effective & (1u << col->getLayer()))) && "Object from wrong layer");
+
+        auto tr = colsys.trace(rect, vel, self, flags, layers);
+        auto brute = bruteTrace(boxes, rect, vel, self, flags, effective);
+        assert(tr.obj == brute.obj && "Wrong trace result");
+
+        traces.push_back({ rect, vel, self, flags, layers });
+        intersects.push_back({ rect, self, flags, layers });
+    }
+
+    vector<TraceResult> traceresults(traces.size());
+    vector<Collidable*> intersectresults(intersects.size());
+    colsys.traceBatch(traces.data(), traces.size(), traceresults.data());
+    colsys.intersectBatch(intersects.data(), intersects.size(), intersectresults.data());
+
+    for (size_t i = 0; i < traces.size(); ++i)
+    {
+        auto& q = traces[i];
+        assert(colsys.trace(q.rect, q.vel, q.self, q.flags, q.layers).obj == traceresults[i].obj && "Different trace result");
+    }
+
+    for (size_t i = 0; i < intersects.size(); ++i)
+    {
+        auto& q = intersects[i];
+        assert(colsys.intersect(q.rect, q.self, q.flags, q.layers) == intersectresults[i] && "Different intersect result");
+    }
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    CollisionSystem colsys;
+    assert(colsys.getNumLayers() == 1 && colsys.getLayerName(0) == collision_defaultlayer && "Missing default layer");
+
+    const int world = colsys.createLayer("world"),
+              actors = colsys.createLayer("actors"),
+              hitboxes = colsys.createLayer("hitboxes");
+    assert(colsys.createLayer("actors") == actors && "Duplicate layer");
+    assert(colsys.findLayer("hitboxes") == hitboxes && "Layer not found");
+    assert(colsys.findLayer("foo") == collision_nolayer && "Found unknown layer");
+
+    colsys.setLayerMask(actors, (1u << world) | (1u << actors));
+    colsys.setLayerMask(hitboxes, 1u << actors);
+
+    vector<unique_ptr<Box>> boxes;
+    for (size_t i = 0; i < 500; ++i)
+    {
+        boxes.emplace_back(new Box(randomBox(), rand() % 2 ? collision_solid : collision_hitbox));
+        boxes.back()->setLayer(rand() % colsys.getNumLayers());
+        colsys.add(boxes.back().get());
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < colsys.getNumLayers(); ++i)
+        total += colsys.getBroadphase(i).size();
+    assert(total == boxes.size() && "Objects missing in layer broadphases");
+
+    checkQueries(colsys, boxes);
+
+    // Moving objects between layers
+    for (size_t i = 0; i < 100; ++i)
+        boxes[rand() % boxes.size()]->setLayer(rand() % colsys.getNumLayers());
+    checkQueries(colsys, boxes);
+
+    // Json roundtrip
+    Json::Value node;
+    colsys.writeToJson(node);
+    CollisionSystem loaded;
+    assert(loaded.loadFromJson(node) && "Failed to load layers");
+    assert(loaded.getNumLayers() == colsys.getNumLayers() && "Wrong amount of layers");
+    for (size_t i = 0; i < colsys.getNumLayers(); ++i)
+    {
+        assert(loaded.getLayerName(i) == colsys.getLayerName(i) && "Wrong layer name");
+        assert((loaded.getLayerMask(i) & 0xf) == (colsys.getLayerMask(i) & 0xf) && "Wrong layer mask");
+    }
+
+    // Layer limit
+    for (int i = colsys.getNumLayers(); i < collision_maxlayers; ++i)
+        assert(colsys.createLayer("layer" + std::to_string(i)) == i && "Failed to create layer");
+    assert(colsys.createLayer("toomany") == collision_nolayer && "Created too many layers");
+
+    colsys.destroy();
+    assert(colsys.getNumLayers() == 1 && colsys.size() == 0 && "Not reset by destroy()");
+
+    return 0;
+}
@@ -28,6 +28,14 @@ class BarComponent : public Identifier<0x650e189e, Component>
         int x;
 };
 
+// Same ID, different name
+class FooChildComponent : public FooComponent
+{
+    public:
+        ASSIGN_NAMETAG("FooChildComponent");
+        FooChildComponent(int x_) : FooComponent(x_) {}
+};
+
 class NotAComponent {};
 
 
@@ -56,5 +64,46 @@ int main()
     entity.destroy();
     assert("Wrong size" && entity.size() == 0);
 
+    // Lookup by name
+    Entity named;
+    auto child = named.add<FooChildComponent>(1);
+    auto foo1 = named.add<FooComponent>(2);
+    auto foo2 = named.add<FooComponent>(3);
+
+    assert("Wrong type index" && getTypeIndex<FooComponent>() == findTypeIndex(FooComponent::name()));
+    assert("Wrong type index" && getTypeIndex<FooComponent>() != getTypeIndex<FooChildComponent>());
+    assert("Unknown name registered" && findTypeIndex("UnknownComponent") == invalidTypeIndex);
+    assert("Found unknown component" && !named.find("UnknownComponent"));
+
+    assert("Wrong component" && named.findByType<FooComponent>() == child);
+    assert("Wrong component" && named.findByName<FooComponent>() == foo1);
+    assert("Wrong component" && named.findByName<FooChildComponent>() == child);
+    assert("Wrong component" && named.find(FooComponent::name()) == foo1);
+    assert("Wrong component" && named.find(FooComponent::name(), 2) == foo2);
+    assert("Wrong component" && named.find(FooChildComponent::name(), 1) == child);
+    assert("Found wrong component" && !named.find(FooChildComponent::name(), 2));
+
+    int n = 0;
+    named.findAllByName<FooComponent>([&](CompRef<FooComponent> foo) {
+            assert("Wrong component" && foo->getName() == FooComponent::name());
+            ++n;
+            return false;
+        });
+    assert("Wrong amount of components found" && n == 2);
+
+    named.remove(foo1);
+    assert("Wrong component after removing" && named.findByName<FooComponent>() == foo2);
+    assert("Wrong component after removing" && named.findByName<FooChildComponent>() == child);
+    assert("Wrong id after removing" && named.find(FooComponent::name(), 2) == foo2);
+    auto foo3 = named.add<FooComponent>(4);
+    assert("Wrong id after adding" && named.find(FooComponent::name(), 3) == foo3);
+
+    named.remove(child);
+    assert("Component not removed" && !named.findByName<FooChildComponent>());
+    assert("Wrong component after removing" && named.findByName<FooComponent>() == foo2);
+
+    named.clearComponents();
+    assert("Components not cleared" && !named.findByName<FooComponent>());
+
     return 0;
 }
@@ -0,0 +1,138 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include "gamelib/core/ecs/Entity.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+// Creates and destroys millions of entities and checks that references to
+// destroyed entities and components never resolve to new objects.
+
+class ChurnComponent : public Identifier<0x3f1e8a27, Component>
+{
+    public:
+        ASSIGN_NAMETAG("ChurnComponent");
+        ChurnComponent(size_t x_) : x(x_) {}
+        size_t x;
+};
+
+struct Live
+{
+    EntityPtr ent;
+    EntityReference ref;
+    ComponentReference<ChurnComponent> comp;
+    size_t id;
+};
+
+constexpr size_t numops = 2000000;
+constexpr size_t numstale = 10000;
+constexpr size_t checkinterval = 1000;
+
+void checkStale(const vector<EntityReference>& ents, const vector<ComponentReference<ChurnComponent>>& comps)
+{
+    for (auto& i : ents)
+        assert(!i && "Stale entity reference resolved");
+    for (auto& i : comps)
+        assert(!i && "Stale component reference resolved");
+}
+
+void checkLive(const Live& live)
+{
+    assert(live.ref.get() == live.ent.get() && "Live entity reference broken");
+    assert(live.comp && live.comp->x == live.id && "Live component reference broken");
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    // Each entity uses two handles, one for itself, one for its component.
+    // Go beyond what 16 bit handles can address, unless they are used.
+    const bool wide = sizeof(handle_index_type) > 2;
+    const size_t maxlive = wide ? 50000 : 20000;
+
+    vector<Live> live;
+    vector<EntityReference> staleents;
+    vector<ComponentReference<ChurnComponent>> stalecomps;
+    size_t created = 0;
+
+    auto create = [&]() {
+        Live l;
+        l.ent.reset(new Entity());
+        l.id = created++;
+        l.ref = l.ent->getLTReference();
+        l.comp = l.ent->add<ChurnComponent>(l.id);
+        live.push_back(std::move(l));
+    };
+
+    // Entities log their destruction in debug builds
+    auto coutbuf = cout.rdbuf(nullptr);
+
+    // Fill up first
+    while (live.size() < maxlive)
+        create();
+
+    for (auto& i : live)
+        checkLive(i);
+
+    for (size_t op = 0; op < numops; ++op)
+    {
+        if (live.size() < maxlive / 2 || (live.size() < maxlive && rand() % 2))
+            create();
+        else
+        {
+            size_t i = rand() % live.size();
+            checkLive(live[i]);
+
+            // Keep a random sample of stale references
+            if (staleents.size() < numstale)
+            {
+                staleents.push_back(live[i].ref);
+                stalecomps.push_back(live[i].comp);
+            }
+            else
+            {
+                size_t k = rand() % numstale;
+                staleents[k] = live[i].ref;
+                stalecomps[k] = live[i].comp;
+            }
+
+            live[i].ent.reset();
+            live[i] = std::move(live.back());
+            live.pop_back();
+        }
+
+        if (op % checkinterval == 0)
+        {
+            checkStale(staleents, stalecomps);
+            checkLive(live[rand() % live.size()]);
+        }
+    }
+
+    checkStale(staleents, stalecomps);
+    for (auto& i : live)
+        checkLive(i);
+
+    // Recreating in the same slot over and over must not wrap versions
+    EntityReference first;
+    for (size_t i = 0; i < 200000; ++i)
+    {
+        Entity ent;
+        if (i == 0)
+            first = ent.getLTReference();
+        else
+            assert(!first && "Stale reference resolved after reusing its slot");
+    }
+    assert(!first && "Stale reference resolved after reusing its slot");
+
+    cout.rdbuf(coutbuf);
+    cout.clear();
+    cout<<created<<" entities created"<<endl;
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <cassert>
+#include <vector>
+#include "gamelib/utils/ObjectPool.hpp"
+#include "gamelib/core/ecs/EntityManager.hpp"
+
+using namespace gamelib;
+
+class SmallComponent : public Identifier<0x4e2d9a61, Component>
+{
+    public:
+        ASSIGN_NAMETAG("SmallComponent");
+};
+
+class HugeComponent : public Identifier<0x1b73c5f8, Component>
+{
+    public:
+        ASSIGN_NAMETAG("HugeComponent");
+        char data[ObjectPool::max_size];
+};
+
+int main()
+{
+    {
+        ObjectPool pool;
+        std::vector<void*> ptrs;
+
+        // Consecutive allocations of one size class are packed
+        for (int i = 0; i < 100; ++i)
+        {
+            ptrs.push_back(pool.allocate(40));
+            assert(pool.owns(ptrs.back()) && "Pool should own the memory");
+        }
+
+        for (size_t i = 1; i < ptrs.size(); ++i)
+            assert(static_cast<char*>(ptrs[i]) - static_cast<char*>(ptrs[i - 1]) == 48 && "Not packed");
+
+        assert(pool.size() == 100 && "Wrong size");
+        assert(pool.getNumChunks() == 1 && "Wrong amount of chunks");
+
+        int local;
+        assert(!pool.owns(&local) && "Pool shouldn't own foreign memory");
+
+        // Freed memory is reused by its size class only
+        pool.free(ptrs[10], 40);
+        assert(pool.allocate(8) != ptrs[10] && "Wrong size class reused");
+        assert(pool.allocate(33) == ptrs[10] && "Memory not reused");
+
+        assert(!pool.release() && "Released with live objects");
+
+        pool.free(ptrs[10], 33);
+        for (size_t i = 0; i < ptrs.size(); ++i)
+            if (i != 10)
+                pool.free(ptrs[i], 40);
+
+        assert(pool.size() == 1 && "Wrong size after freeing");
+        ObjectPool::freeObject(nullptr, 8);
+    }
+
+    // Entities and components use the global pool by default
+    {
+        ObjectPool& global = ObjectPool::getGlobal();
+        const size_t size = global.size();
+
+        EntityPtr ent(new Entity());
+        auto small = ent->add<SmallComponent>();
+        auto huge = ent->add<HugeComponent>();
+
+        assert(global.owns(ent.get()) && "Entity not pooled");
+        assert(global.owns(small.get()) && "Component not pooled");
+        assert(!global.owns(huge.get()) && "Large objects should use the global allocator");
+        assert(global.size() == size + 2 && "Wrong size");
+
+        ent.reset();
+        assert(global.size() == size && "Objects not freed");
+    }
+
+    // Level arena
+    {
+        EntityManager entmgr;
+        entmgr.setLevelArena(true);
+        auto arena = entmgr.getLevelArena();
+        assert(arena && ObjectPool::getArena() == arena && "Arena not active");
+
+        for (int level = 0; level < 3; ++level)
+        {
+            for (int i = 0; i < 1000; ++i)
+            {
+                auto ent = entmgr.add();
+                auto comp = ent->add<SmallComponent>();
+                assert(arena->owns(ent.get()) && arena->owns(comp.get()) && "Not allocated from the arena");
+            }
+
+            assert(arena->size() == 2000 && "Wrong arena size");
+            entmgr.clear();
+            assert(arena->size() == 0 && arena->getNumChunks() == 0 && "Arena not released");
+        }
+
+        // Surviving entities keep the arena alive
+        auto ent = entmgr.add();
+        auto popped = entmgr.getRoot()->popChild(ent);
+        entmgr.clear();
+        assert(arena->size() == 1 && arena->getNumChunks() > 0 && "Arena released with live objects");
+
+        popped.reset();
+        entmgr.clear();
+        assert(arena->getNumChunks() == 0 && "Arena not released");
+
+        // Objects outliving the arena are handed to the global pool
+        const size_t globalsize = ObjectPool::getGlobal().size();
+        popped = entmgr.getRoot()->popChild(entmgr.add());
+        entmgr.setLevelArena(false);
+        assert(!entmgr.getLevelArena() && !ObjectPool::getArena() && "Arena still active");
+        assert(ObjectPool::getGlobal().size() == globalsize + 1 && "Object not adopted");
+        assert(ObjectPool::getGlobal().owns(popped.get()) && "Object not adopted");
+
+        popped.reset();
+        assert(ObjectPool::getGlobal().size() == globalsize && "Object not freed");
+
+        auto after = entmgr.add();
+        assert(ObjectPool::getGlobal().owns(after.get()) && "Not allocated from the global pool");
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include "gamelib/core/ecs/Entity.hpp"
+#include "gamelib/core/geometry/CollisionSystem.hpp"
+#include "gamelib/core/geometry/flags.hpp"
+#include "gamelib/core/update/UpdateSystem.hpp"
+#include "gamelib/components/geometry/AABB.hpp"
+#include "gamelib/components/update/QPhysics.hpp"
+#include "gamelib/components/update/PhysicsScheduler.hpp"
+
+using namespace gamelib;
+
+constexpr int num_clusters = 8;
+constexpr int cluster_size = 5;
+constexpr int num_frames = 60;
+constexpr float elapsed = 1.f / 60;
+
+struct Result
+{
+    std::vector<math::AABBf> boxes;
+    size_t maxislands;
+};
+
+Result simulate(size_t numthreads)
+{
+    CollisionSystem colsys;
+    UpdateSystem updsys;
+    PhysicsScheduler scheduler(numthreads);
+    std::vector<EntityPtr> ents;
+    std::vector<UpdateComponent*> objs;
+
+    ents.emplace_back(new Entity());
+    ents.back()->add<AABB>(-100, 100, 2000, 20, collision_solid);
+
+    // Clusters of boxes, far enough apart to form separate islands
+    for (int c = 0; c < num_clusters; ++c)
+        for (int i = 0; i < cluster_size; ++i)
+        {
+            ents.emplace_back(new Entity());
+            ents.back()->add<AABB>(c * 200 + i * 14, 88, 10, 10, collision_solid | collision_physicshull);
+            auto phys = ents.back()->add<QPhysics>();
+            phys->vel.x = (i % 3 - 1) * 60;
+            objs.push_back(phys.get());
+        }
+
+    // A fast box at the edge of the first cluster that reaches into the
+    // second one, with a hitbox in front of it
+    ents.emplace_back(new Entity());
+    ents.back()->add<AABB>(cluster_size * 14, 88, 10, 10, collision_solid | collision_physicshull);
+    ents.back()->add<AABB>(cluster_size * 14 + 10, 80, 20, 20, collision_hitbox);
+    auto fast = ents.back()->add<QPhysics>();
+    fast->vel.x = 3000;
+    objs.push_back(fast.get());
+
+    Result result;
+    result.maxislands = 0;
+    std::vector<float> times(objs.size(), elapsed);
+
+    for (int frame = 0; frame < num_frames; ++frame)
+    {
+        scheduler.update(objs.data(), times.data(), objs.size());
+        result.maxislands = std::max(result.maxislands, scheduler.getNumIslands());
+    }
+
+    for (auto obj : objs)
+        result.boxes.push_back(static_cast<QPhysics*>(obj)->getHull());
+
+    return result;
+}
+
+int main()
+{
+    const Result sequential = simulate(0);
+
+    for (size_t numthreads : { 1, 2, 4, 8 })
+    {
+        const Result parallel = simulate(numthreads);
+        assert(parallel.maxislands > 1 && "Nothing updated in parallel");
+        assert(parallel.boxes.size() == sequential.boxes.size() && "Wrong amount of objects");
+
+        for (size_t i = 0; i < sequential.boxes.size(); ++i)
+            assert(parallel.boxes[i].pos == sequential.boxes[i].pos
+                    && parallel.boxes[i].size == sequential.boxes[i].size
+                    && "Parallel update differs from sequential update");
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include "gamelib/core/geometry/PixelMask.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+std::mt19937 rng;
+
+struct Image
+{
+    int w, h;
+    vector<bool> pixels;
+
+    bool get(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= w || y >= h)
+            return false;
+        return pixels[y * w + x];
+    }
+};
+
+Image randomImage()
+{
+    Image img;
+    img.w = 1 + rng() % 150;    // Cross word boundaries
+    img.h = 1 + rng() % 80;
+    img.pixels.resize(img.w * img.h);
+
+    // Some blobs instead of noise to get empty rows and larger distances
+    const int density = rng() % 4;
+    for (int y = 0; y < img.h; ++y)
+        for (int x = 0; x < img.w; ++x)
+            img.pixels[y * img.w + x] = density && (x / 7 + y / 5) % (density + 1) == 0 && rng() % 3;
+    return img;
+}
+
+bool bruteFind(const Image& img, int x0, int y0, int x1, int y1, math::Vec2i* pixel)
+{
+    for (int y = y1 - 1; y >= y0; --y)
+        for (int x = x0; x < x1; ++x)
+            if (img.get(x, y))
+            {
+                pixel->x = x;
+                pixel->y = y;
+                return true;
+            }
+    return false;
+}
+
+// Distance from the pixel to the nearest pixel of the opposite state,
+// including a border of empty pixels around the image.
+float bruteDistance(const Image& img, int x, int y)
+{
+    const bool solid = img.get(x, y);
+    float best = 1e20;
+    for (int j = -1; j <= img.h; ++j)
+        for (int i = -1; i <= img.w; ++i)
+            if (img.get(i, j) != solid)
+                best = std::min(best, std::sqrt(float((i - x) * (i - x) + (j - y) * (j - y))));
+    return solid ? -best : best;
+}
+
+int main()
+{
+    auto seed = time(0);
+    rng.seed(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    PixelMask empty;
+    assert(!empty.testRect(-10, -10, 10, 10) && "Empty mask collides");
+
+    for (int n = 0; n < 50; ++n)
+    {
+        Image img = randomImage();
+        PixelMask mask;
+        mask.create(img.w, img.h, [&](int x, int y) { return img.get(x, y); });
+        assert(mask.getWidth() == img.w && mask.getHeight() == img.h && "Wrong size");
+
+        for (int y = -2; y < img.h + 2; ++y)
+            for (int x = -2; x < img.w + 2; ++x)
+                assert(mask.test(x, y) == img.get(x, y) && "Wrong pixel");
+
+        for (int i = 0; i < 500; ++i)
+        {
+            const int x0 = (int)(rng() % (img.w + 20)) - 10,
+                      y0 = (int)(rng() % (img.h + 20)) - 10,
+                      x1 = x0 + rng() % 80,
+                      y1 = y0 + rng() % 40;
+
+            math::Vec2i pixel, brute;
+            const bool found = mask.findRect(x0, y0, x1, y1, &pixel);
+            assert(found == bruteFind(img, x0, y0, x1, y1, &brute) && "Wrong rect test result");
+            assert(found == mask.testRect(x0, y0, x1, y1) && "testRect() differs from findRect()");
+            assert((!found || (pixel.x == brute.x && pixel.y == brute.y)) && "Wrong pixel found");
+        }
+
+        for (int y = 0; y < img.h; ++y)
+            for (int x = 0; x < img.w; ++x)
+            {
+                // Images without solid pixels only need to report a large distance
+                const float dist = mask.getDistance(x, y),
+                            brute = bruteDistance(img, x, y);
+                assert((brute > 1e19 ? dist > img.w + img.h : std::abs(dist - brute) < 0.001) && "Wrong distance");
+            }
+
+        // Outside it must stay a lower bound of the distance to solid pixels
+        for (int i = 0; i < 100; ++i)
+        {
+            const int x = (int)(rng() % (img.w + 40)) - 20,
+                      y = (int)(rng() % (img.h + 40)) - 20;
+            if (x >= 0 && y >= 0 && x < img.w && y < img.h)
+                continue;
+            assert(mask.getDistance(x, y) <= bruteDistance(img, x, y) + 0.001 && "Distance not a lower bound");
+        }
+    }
+
+    return 0;
+}
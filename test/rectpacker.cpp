@@ -0,0 +1,61 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include "gamelib/utils/RectPacker.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+struct Rect
+{
+    int x, y, w, h;
+};
+
+bool overlaps(const Rect& a, const Rect& b)
+{
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    // Equal squares fill the area completely
+    RectPacker packer(256, 256);
+    math::Vec2i pos;
+    for (int i = 0; i < 256; ++i)
+        assert(packer.insert(16, 16, &pos) && "Square didn't fit");
+    assert(!packer.insert(16, 16, &pos) && "Packed more than fits");
+    assert(packer.getOccupancy() == 1 && "Wrong occupancy");
+
+    // Random rects must stay inside the area and never overlap
+    packer.reset(512, 512);
+    vector<Rect> rects;
+    for (int i = 0; i < 500; ++i)
+    {
+        Rect r = { 0, 0, 1 + rand() % 64, 1 + rand() % 64 };
+        if (!packer.insert(r.w, r.h, &pos))
+            continue;
+
+        r.x = pos.x;
+        r.y = pos.y;
+        assert(r.x >= 0 && r.y >= 0 && r.x + r.w <= 512 && r.y + r.h <= 512 && "Rect out of bounds");
+
+        for (auto& other : rects)
+            assert(!overlaps(r, other) && "Rects overlap");
+
+        rects.push_back(r);
+    }
+
+    assert(!rects.empty() && "Nothing packed");
+    assert(packer.getUsedSize().x <= 512 && packer.getUsedSize().y <= 512 && "Wrong used size");
+
+    assert(!packer.insert(513, 1, &pos) && "Packed rect larger than the area");
+    assert(!packer.insert(0, 10, &pos) && "Packed empty rect");
+
+    return 0;
+}
@@ -0,0 +1,426 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <ctime>
+#include <algorithm>
+#include "gamelib/core/rendering/RenderSystem.hpp"
+#include "gamelib/core/rendering/flags.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+const sf::PrimitiveType types[] = {
+    sf::Points, sf::Lines, sf::LineStrip, sf::Triangles,
+    sf::TriangleStrip, sf::TriangleFan, sf::Quads
+};
+
+// Reference implementation: converts a mesh to a list of single primitives
+void expand(vector<sf::Vector2f>* out, const sf::Vertex* vertices, size_t size,
+        sf::PrimitiveType type, const sf::Transform& trans)
+{
+    auto push = [&](size_t i) { out->push_back(trans.transformPoint(vertices[i].position)); };
+
+    switch (type)
+    {
+        case sf::Lines:
+            for (size_t i = 0; i < size / 2 * 2; ++i)
+                push(i);
+            break;
+        case sf::LineStrip:
+            for (size_t i = 0; i + 1 < size; ++i)
+                push(i), push(i + 1);
+            break;
+        case sf::Triangles:
+            for (size_t i = 0; i < size / 3 * 3; ++i)
+                push(i);
+            break;
+        case sf::TriangleStrip:
+            for (size_t i = 0; i + 2 < size; ++i)
+                push(i), push(i + 1), push(i + 2);
+            break;
+        case sf::TriangleFan:
+            for (size_t i = 1; i + 1 < size; ++i)
+                push(0), push(i), push(i + 1);
+            break;
+        case sf::Quads:
+            for (size_t i = 0; i + 3 < size; i += 4)
+                push(i), push(i + 1), push(i + 2), push(i), push(i + 2), push(i + 3);
+            break;
+        default:
+            for (size_t i = 0; i < size; ++i)
+                push(i);
+    }
+}
+
+void checkBatches(const RenderSystem& rendersystem, const math::AABBf* rect = nullptr)
+{
+    const auto& batches = rendersystem.updateBatches(rect);
+    assert(batches.size() == rendersystem.getNumDrawCalls() && "Wrong draw call count");
+
+    vector<sf::Vector2f> expected, actual;
+    size_t numnodes = 0;
+
+    for (NodeHandle h : rendersystem)
+    {
+        if (!rendersystem.getNodeVisible(h))
+            continue;
+        if (rect && !math::intersect(*rect, rendersystem.getNodeGlobalBBox(h)))
+            continue;
+        const RenderNode* node = rendersystem.getNode(h);
+        expand(&expected, rendersystem.getNodeMesh(h, 0), node->mesh.size, node->mesh.primitiveType, node->transform);
+    }
+
+    for (const RenderBatch& batch : batches)
+    {
+        assert(batch.numnodes > 0 && batch.vertices && "Empty batch");
+        if (batch.numnodes > 1)
+        {
+            assert((batch.primitiveType == sf::Points || batch.primitiveType == sf::Lines
+                        || batch.primitiveType == sf::Triangles) && "Batch is not a list type");
+            assert(std::equal(batch.states.transform.getMatrix(), batch.states.transform.getMatrix() + 16,
+                        sf::Transform::Identity.getMatrix()) && "Batch transform not applied");
+        }
+        expand(&actual, batch.vertices, batch.size, batch.primitiveType, batch.states.transform);
+        numnodes += batch.numnodes;
+    }
+
+    assert(numnodes == rendersystem.getNumObjectsRendered() && "Nodes missing in batches");
+    assert(expected.size() == actual.size() && "Wrong amount of vertices");
+    for (size_t i = 0; i < expected.size(); ++i)
+        assert(std::abs(expected[i].x - actual[i].x) < 0.01 && std::abs(expected[i].y - actual[i].y) < 0.01 && "Wrong vertex");
+}
+
+bool canBatchStates(const sf::RenderStates& a, const sf::RenderStates& b)
+{
+    return a.texture == b.texture && a.shader == b.shader && a.blendMode == b.blendMode;
+}
+
+void checkListsEqual(const RenderList& a, const RenderList& b)
+{
+    assert(a.batches.size() == b.batches.size() && "Wrong draw call count");
+    assert(a.numrendered == b.numrendered && "Wrong rendered count");
+
+    for (size_t i = 0; i < a.batches.size(); ++i)
+    {
+        const RenderBatch& x = a.batches[i];
+        const RenderBatch& y = b.batches[i];
+        assert(x.size == y.size && x.primitiveType == y.primitiveType && x.numnodes == y.numnodes
+                && canBatchStates(x.states, y.states) && "Batches differ");
+        for (size_t k = 0; k < x.size; ++k)
+            assert(x.vertices[k].position == y.vertices[k].position && "Vertices differ");
+    }
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    RenderSystem rendersystem;
+    Component* owner = reinterpret_cast<Component*>(0xDEADBEEF);
+
+    // Never dereferenced, only compared
+    TextureResource::Handle textures[] = { TextureResource::create(), TextureResource::create(), nullptr };
+
+    // All equal -> one draw call
+    vector<NodeHandle> handles;
+    for (int i = 0; i < 100; ++i)
+    {
+        NodeHandle handle = rendersystem.createNode(owner);
+        sf::Vector2f quad[] = { { 0, 0 }, { 0, 16 }, { 16, 0 }, { 16, 16 } };
+        rendersystem.createNodeMesh(handle, 4, sf::TriangleStrip);
+        rendersystem.updateNodeMesh(handle, 4, 0, quad);
+        rendersystem.setNodeOptions(handle, nullptr, nullptr, nullptr, &textures[0]);
+        rendersystem.setNodeTransform(handle, sf::Transform().translate(i % 10 * 16, i / 10 * 16));
+        handles.push_back(handle);
+    }
+
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == 1 && "Nodes not merged");
+    assert(rendersystem.updateBatches()[0].size == 600 && "Wrong batch size");
+
+    // Opt-out splits the run
+    unsigned int nobatch = render_nobatch;
+    rendersystem.setNodeOptions(handles[50], &nobatch);
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == 3 && "Opt-out not respected");
+
+    rendersystem.batching = false;
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == 100 && "Merged nodes although batching is disabled");
+    rendersystem.batching = true;
+
+    // Cached render states follow layer option changes
+    LayerHandle layer = rendersystem.createLayer("layer");
+    for (int i = 0; i < 50; ++i)
+        rendersystem.setNodeLayer(handles[i], layer);
+
+    unsigned int invisible = render_invisible, noflags = 0;
+    rendersystem.setLayerOptions(layer, &invisible);
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumObjectsRendered() == 50 && "Layer options not applied");
+
+    rendersystem.setLayerOptions(layer, &noflags, nullptr, nullptr, &textures[1]);
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumObjectsRendered() == 100 && "Layer options not applied");
+    assert(rendersystem.updateBatches()[0].states.texture == textures[0].get() && "Node texture overridden");
+
+    // Static nodes are baked and only rebaked when they change
+    unsigned int staticflag = render_static;
+    for (NodeHandle handle : handles)
+        rendersystem.setNodeOptions(handle, &staticflag);
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == 1 && "Static nodes not baked together");
+    const sf::Vertex* baked = rendersystem.updateBatches()[0].vertices;
+
+    NodeHandle dynamic = rendersystem.createNode(owner);
+    sf::Vector2f triangle[] = { { 0, 0 }, { 10, 0 }, { 0, 10 } };
+    rendersystem.setNodeDepth(dynamic, -1);
+    rendersystem.createNodeMesh(dynamic, 3, sf::Triangles);
+    rendersystem.updateNodeMesh(dynamic, 3, 0, triangle);
+    rendersystem.setNodeTransform(handles[0], rendersystem.getNode(handles[0])->transform);
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == 2 && "Wrong draw call count");
+    assert(rendersystem.updateBatches()[0].vertices == baked && "Rebaked although no static node changed");
+
+    rendersystem.setNodeTransform(handles[5], sf::Transform().translate(1000, 1000));
+    checkBatches(rendersystem);
+    rendersystem.updateNodeMesh(handles[7], 1, 0, triangle, nullptr, nullptr, false);
+    checkBatches(rendersystem);
+
+    // A dynamic node in between splits the baked run
+    rendersystem.setNodeDepth(dynamic, 1);
+    for (int i = 0; i < 50; ++i)
+        rendersystem.setNodeDepth(handles[i], 2);
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == 3 && "Wrong draw call count");
+
+    // Only the chunk of a changed node is rebaked
+    vector<const sf::Vertex*> chunks;
+    for (auto& batch : rendersystem.updateBatches())
+        chunks.push_back(batch.vertices);
+
+    rendersystem.setNodeTransform(handles[0], sf::Transform().translate(10, 10));
+    checkBatches(rendersystem);
+
+    const auto& rebatched = rendersystem.updateBatches();
+    size_t rebaked = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+        if (rebatched[i].vertices != chunks[i])
+            ++rebaked;
+    assert(rebaked == 1 && "Unchanged chunks rebaked");
+
+    // Random meshes, states and order
+    rendersystem.clear();
+    for (int i = 0; i < 500; ++i)
+    {
+        NodeHandle handle = rendersystem.createNode(owner);
+        rendersystem.setNodeDepth(handle, rand() % 4);
+
+        const size_t size = 3 + rand() % 10;
+        const sf::PrimitiveType type = types[rand() % 7];
+        vector<sf::Vector2f> vertices(size);
+        for (auto& v : vertices)
+            v = sf::Vector2f(rand() % 100, rand() % 100);
+        vertices[0] = sf::Vector2f(0, 0);   // Avoid 0 size bboxes
+        vertices[1] = sf::Vector2f(100, 100);
+
+        rendersystem.createNodeMesh(handle, size, type);
+        rendersystem.updateNodeMesh(handle, size, 0, vertices.data());
+        rendersystem.setNodeTransform(handle, sf::Transform().translate(rand() % 500, rand() % 500).rotate(rand() % 360));
+
+        unsigned int flags = rand() % 10 == 0 ? render_nobatch : 0;
+        rendersystem.setNodeOptions(handle, &flags, nullptr, nullptr, &textures[rand() % 3]);
+    }
+
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() < rendersystem.getNumObjectsRendered() && "Nothing merged");
+
+    // Culling must produce the same draw calls as checking every node
+    for (int i = 0; i < 50; ++i)
+    {
+        math::AABBf rect(rand() % 700 - 100, rand() % 700 - 100, rand() % 300, rand() % 300);
+        checkBatches(rendersystem, &rect);
+    }
+
+    // Move nodes around to update the spatial index
+    for (NodeHandle handle : rendersystem)
+        if (rand() % 2)
+            rendersystem.setNodeTransform(handle, sf::Transform().translate(rand() % 2000 - 1000, rand() % 2000 - 1000));
+
+    for (int i = 0; i < 50; ++i)
+    {
+        math::AABBf rect(rand() % 2000 - 1000, rand() % 2000 - 1000, rand() % 500, rand() % 500);
+        checkBatches(rendersystem, &rect);
+    }
+
+    // Picking returns the topmost node
+    NodeHandle top = rendersystem.createNode(owner);
+    sf::Vector2f quad[] = { { 0, 0 }, { 0, 16 }, { 16, 0 }, { 16, 16 } };
+    rendersystem.setNodeDepth(top, -10);
+    rendersystem.createNodeMesh(top, 4, sf::TriangleStrip);
+    rendersystem.updateNodeMesh(top, 4, 0, quad);
+    rendersystem.setNodeTransform(top, sf::Transform().translate(5000, 5000));
+    assert(rendersystem.getNodeAtPosition(math::Point2f(5008, 5008)) == top && "Wrong node picked");
+    assert(!rendersystem.getNodeAtPosition(math::Point2f(5020, 5008)) && "Picked node outside of mesh");
+    rendersystem.setNodeTransform(top, sf::Transform().translate(200, 200));
+    assert(rendersystem.getNodeAtPosition(math::Point2f(208, 208)) == top && "Wrong node picked");
+    rendersystem.removeNode(top);
+    assert(!rendersystem.getNodeAtPosition(math::Point2f(5008, 5008)) && "Removed node picked");
+
+    rendersystem.batching = false;
+    checkBatches(rendersystem);
+    assert(rendersystem.getNumDrawCalls() == rendersystem.getNumObjectsRendered() && "Wrong draw call count");
+    rendersystem.batching = true;
+
+    // Lists built on worker threads must equal those built on one thread
+    for (int i = 0; i < 10000; ++i)
+    {
+        NodeHandle handle = rendersystem.createNode(owner);
+        sf::Vector2f quad[] = { { 0, 0 }, { 0, 16 }, { 16, 0 }, { 16, 16 } };
+        rendersystem.setNodeDepth(handle, rand() % 4);
+        rendersystem.createNodeMesh(handle, 4, types[rand() % 7]);
+        rendersystem.updateNodeMesh(handle, 4, 0, quad);
+        rendersystem.setNodeTransform(handle, sf::Transform().translate(rand() % 4000 - 2000, rand() % 4000 - 2000));
+
+        unsigned int flags = rand() % 10 == 0 ? render_nobatch : 0;
+        float parallax = rand() % 10 == 0 ? 0.5 : 1;
+        rendersystem.setNodeOptions(handle, &flags, &parallax, nullptr, &textures[rand() % 3]);
+    }
+
+    math::AABBf rects[] = {
+        math::AABBf(-2000, -2000, 4000, 4000),
+        math::AABBf(-500, -500, 1000, 800),
+        math::AABBf(0, 0, 300, 300)
+    };
+
+    rendersystem.forceUpdate();
+    RenderList sequential[4], parallel[4];
+
+    rendersystem.threads = 0;
+    rendersystem.buildRenderList(&sequential[3]);
+    for (int i = 0; i < 3; ++i)
+        rendersystem.buildRenderList(&sequential[i], &rects[i]);
+
+    rendersystem.threads = 3;
+    rendersystem.buildRenderList(&parallel[3]);
+    checkListsEqual(sequential[3], parallel[3]);
+
+    rendersystem.buildRenderLists(parallel, rects, 3);
+    for (int i = 0; i < 3; ++i)
+        checkListsEqual(sequential[i], parallel[i]);
+
+    for (int i = 0; i < 3; ++i)
+        rendersystem.buildRenderList(&parallel[i], &rects[i]);
+    for (int i = 0; i < 3; ++i)
+        checkListsEqual(sequential[i], parallel[i]);
+
+    // Cached visible sets follow view and node movement
+    RenderList cached, fresh;
+    auto checkCached = [&](const math::AABBf& view) {
+        rendersystem.forceUpdate();
+        rendersystem.buildRenderList(&cached, &view);
+        fresh.clear();
+        rendersystem.buildRenderList(&fresh, &view);
+        checkListsEqual(cached, fresh);
+    };
+
+    NodeHandle mover = rendersystem.createNode(owner);
+    sf::Vector2f moverquad[] = { { 0, 0 }, { 0, 16 }, { 16, 0 }, { 16, 16 } };
+    rendersystem.createNodeMesh(mover, 4, sf::TriangleStrip);
+    rendersystem.updateNodeMesh(mover, 4, 0, moverquad);
+
+    math::AABBf view(-300, -300, 600, 600);
+    checkCached(view);
+    checkCached(view);
+
+    rendersystem.setNodeTransform(mover, sf::Transform().translate(5000, 5000));
+    checkCached(view);
+    rendersystem.setNodeTransform(mover, sf::Transform().translate(0, 0));
+    checkCached(view);
+    size_t numrendered = cached.numrendered;
+    rendersystem.setNodeTransform(mover, sf::Transform().translate(-400, 0));
+    checkCached(view);
+    assert(cached.numrendered == numrendered - 1 && "Node moved out of view still drawn");
+
+    view.x -= rendersystem.cullMargin / 2;
+    checkCached(view);
+    view.x += 1000;
+    checkCached(view);
+
+    // Compaction keeps mesh contents and draw data intact
+    vector<NodeHandle> meshes;
+    for (int i = 0; i < 1000; ++i)
+    {
+        NodeHandle handle = rendersystem.createNode(owner);
+        vector<sf::Vector2f> points(1 + rand() % 8);
+        for (size_t k = 0; k < points.size(); ++k)
+            points[k] = sf::Vector2f(i, k);
+        rendersystem.createNodeMesh(handle, points.size(), sf::Points);
+        rendersystem.updateNodeMesh(handle, points.size(), 0, points.data());
+        meshes.push_back(handle);
+    }
+
+    rendersystem.compactBudget = 0;
+    rendersystem.forceUpdate();
+    for (size_t i = 0; i < meshes.size(); i += 2)
+        rendersystem.removeNode(meshes[i]);
+
+    rendersystem.forceUpdate();
+    assert(rendersystem.getVertexAllocator().getFragmentation() > 0 && "No gaps left by removed nodes");
+
+    rendersystem.compactBudget = 16;
+    while (rendersystem.getVertexAllocator().getNumFreeBlocks() > 0)
+        rendersystem.forceUpdate();
+
+    for (size_t i = 1; i < meshes.size(); i += 2)
+        for (size_t k = 0; k < rendersystem.getNode(meshes[i])->mesh.size; ++k)
+            assert(rendersystem.getNodeMesh(meshes[i], k)->position == sf::Vector2f(i, k) && "Mesh corrupted by compaction");
+
+    checkBatches(rendersystem);
+
+    // Incremental bbox updates match recalculating it
+    NodeHandle shape = rendersystem.createNode(owner);
+    rendersystem.createNodeMesh(shape, 16, sf::TriangleFan);
+    for (int i = 0; i < 1000; ++i)
+    {
+        sf::Vector2f points[4];
+        size_t size = 1 + rand() % 4;
+        size_t offset = rand() % 16;
+        for (size_t k = 0; k < size; ++k)
+            points[k] = sf::Vector2f(rand() % 200 - 100, rand() % 200 - 100);
+        rendersystem.updateNodeMesh(shape, size, offset, points, nullptr, nullptr, false);
+
+        const RenderNode* node = rendersystem.getNode(shape);
+        math::Vec2f min(1000, 1000), max(-1000, -1000);
+        for (size_t k = 0; k < node->mesh.size; ++k)
+        {
+            const sf::Vector2f& p = rendersystem.getNodeMesh(shape, k)->position;
+            min.x = std::min(min.x, p.x); min.y = std::min(min.y, p.y);
+            max.x = std::max(max.x, p.x); max.y = std::max(max.y, p.y);
+        }
+
+        const math::AABBf& bbox = node->mesh.bbox;
+        assert(bbox.x == min.x && bbox.y == min.y && bbox.x + bbox.w == max.x && bbox.y + bbox.h == max.y
+                && "Wrong incremental bbox");
+    }
+
+    // Only changed vertices are dirty
+    rendersystem.forceUpdate();
+    rendersystem.clearDirtyVertexRanges();
+    const Mesh& shapemesh = rendersystem.getNode(shape)->mesh;
+    sf::Vector2f uvs[] = { { 1, 2 }, { 3, 4 } };
+    rendersystem.updateNodeMesh(shape, 2, 5, nullptr, uvs);
+    rendersystem.updateNodeMesh(shape, 2, 5, nullptr, uvs);
+    rendersystem.updateNodeMesh(shape, 1, 1, nullptr, uvs);
+    const auto& ranges = rendersystem.getDirtyVertexRanges();
+    assert(ranges.size() == 2 && "Wrong number of dirty ranges");
+    assert(ranges[0].begin == shapemesh.handle.index + 1 && ranges[0].end == shapemesh.handle.index + 2
+            && ranges[1].begin == shapemesh.handle.index + 5 && ranges[1].end == shapemesh.handle.index + 7
+            && "Wrong dirty ranges");
+
+    return 0;
+}
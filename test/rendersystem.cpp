@@ -11,18 +11,28 @@ using namespace gamelib;
 
 constexpr int max_size = 20;
 
-void checkQueue(RenderSystem& rendersystem)
+void checkQueue(RenderSystem& rendersystem, size_t numnodes)
 {
     rendersystem.forceUpdate();
 
+    int lastlayerdepth = __INT_MAX__;
     int lastdepth = __INT_MAX__;
+    size_t size = 0;
     for (NodeHandle h : rendersystem)
     {
         const RenderNode* node = rendersystem.getNode(h);
         assert(node && "Invalid node in render queue");
-        assert(node->depth <= lastdepth && "Wrong node order");
+
+        const RenderLayer* layer = rendersystem.getLayer(node->layer);
+        const int layerdepth = layer ? layer->depth : 0;
+        assert(layerdepth <= lastlayerdepth && "Wrong layer order");
+        assert((layerdepth < lastlayerdepth || node->depth <= lastdepth) && "Wrong node order");
+        lastlayerdepth = layerdepth;
         lastdepth = node->depth;
+        ++size;
     }
+
+    assert(size == numnodes && "Wrong render queue size");
 }
 
 int main()
@@ -87,7 +97,7 @@ int main()
             }
         }
 
-        checkQueue(rendersystem);
+        checkQueue(rendersystem, handles.size());
     }
 
     for (size_t n = 0; n < 100; ++n)
@@ -99,7 +109,26 @@ int main()
         rendersystem.setNodeTransform(handle, matrix);
     }
 
-    checkQueue(rendersystem);
+    checkQueue(rendersystem, handles.size());
+
+    // Layers are sorted before node depths
+    LayerHandle layers[] = { rendersystem.createLayer("a"), rendersystem.createLayer("b"), rendersystem.createLayer("c") };
+    for (auto layer : layers)
+        rendersystem.setLayerDepth(layer, rand() % 10 - 5);
+
+    for (size_t n = 0; n < 200; ++n)
+        rendersystem.setNodeLayer(handles[rand() % handles.size()], layers[rand() % 3]);
+    checkQueue(rendersystem, handles.size());
+
+    for (size_t n = 0; n < 10; ++n)
+    {
+        rendersystem.setLayerDepth(layers[rand() % 3], rand() % 10 - 5);
+        rendersystem.setNodeDepth(handles[rand() % handles.size()], rand() % 10 - 5);
+        checkQueue(rendersystem, handles.size());
+    }
+
+    rendersystem.removeLayer(layers[0]);
+    checkQueue(rendersystem, handles.size());
 
     for (size_t n = 0; n < 50; ++n)
     {
@@ -109,8 +138,29 @@ int main()
             rendersystem.removeNode(handles[index]);
             handles.erase(handles.begin() + index);
         }
-        checkQueue(rendersystem);
+        checkQueue(rendersystem, handles.size());
     }
 
+    // Nodes with equal depths stay in insertion order after reordering
+    rendersystem.clear();
+    handles.clear();
+    for (size_t n = 0; n < 50; ++n)
+    {
+        handles.push_back(rendersystem.createNode(owner));
+        rendersystem.createNodeMesh(handles.back(), 1, sf::Points);
+    }
+
+    for (size_t n = 0; n < handles.size(); n += 3)
+        rendersystem.setNodeDepth(handles[n], 1);
+    checkQueue(rendersystem, handles.size());
+
+    for (size_t n = 0; n < handles.size(); n += 3)
+        rendersystem.setNodeDepth(handles[n], 0);
+    checkQueue(rendersystem, handles.size());
+
+    size_t i = 0;
+    for (NodeHandle h : rendersystem)
+        assert(h == handles[i++] && "Insertion order not kept");
+
     return 0;
 }
@@ -1,7 +1,11 @@
 #include <cassert>
 #include <memory>
 #include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
 #include "gamelib/utils/SlotMap.hpp"
+#include "gamelib/utils/DenseSlotMap.hpp"
 
 using namespace gamelib;
 using namespace std;
@@ -20,17 +24,19 @@ struct Foo
 
 bool Foo::control = false;
 
-int main()
+template <template <typename> class MapType>
+void testMap()
 {
-    SlotMapShort<std::unique_ptr<Foo>> pmap;
+    Foo::control = false;
+    MapType<std::unique_ptr<Foo>> pmap;
     auto pkey = pmap.acquire();
     pmap[pkey] = std::unique_ptr<Foo>(new Foo());
     pmap.destroy(pkey);
 
     assert(Foo::control && "Object didn't get overwritten");
 
-    SlotMapShort<Foo> map(5);
-    static_assert(sizeof(SlotMapShort<Foo>::Handle) == 2 * sizeof(unsigned short),
+    MapType<Foo> map(5);
+    static_assert(sizeof(typename MapType<Foo>::Handle) == 2 * sizeof(unsigned short),
             "Wrong key size");
 
     auto key = map.acquire();
@@ -47,7 +53,7 @@ int main()
     assert(key2.index == 1 && "Wrong index");
     assert(key2.version == 0 && "Wrong version tag");
     assert(map.isValid(key2) && "Key should be valid");
-    // assert(map.size() == 2 && "Wrong size");
+    assert(map.size() == 2 && "Wrong size");
 
     int i = 0;
     for (auto it = map.begin(), end = map.end(); it != end; ++it)
@@ -60,6 +66,10 @@ int main()
     map.destroy(key);
 
     assert(!map.isValid(key) && "Key should be invalid");
+    assert(map.size() == 1 && "Wrong size");
+
+    map.destroy(key);
+    assert(map.size() == 1 && "Destroyed invalid key");
 
     key = map.acquire();
 
@@ -75,6 +85,7 @@ int main()
         num++;
 
     assert(num == 12 && "Wrong size");
+    assert(map.size() == 12 && "Wrong size");
 
     map.clear();
 
@@ -83,6 +94,84 @@ int main()
         num++;
 
     assert(num == 0 && "Wrong size");
+    assert(map.size() == 0 && "Wrong size");
+
+    // Slots are retired before their version wraps around
+    MapType<int> rmap;
+    auto first = rmap.acquire();
+    auto rkey = first;
+    for (int i = 0; i < 70000; ++i)
+    {
+        rmap.destroy(rkey);
+        rkey = rmap.acquire();
+        assert(!rmap.isValid(first) && "Stale key became valid");
+    }
+    assert(rkey.index == 1 && "Slot not retired");
+    assert(rmap.size() == 1 && "Wrong size");
+}
+
+int main()
+{
+    testMap<SlotMapShort>();
+    testMap<DenseSlotMapShort>();
+
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    // Random churn, compared against a list of live keys
+    DenseSlotMapShort<int> dense;
+    vector<pair<SlotKeyShort, int>> live;
+    vector<SlotKeyShort> dead;
+
+    for (int i = 0; i < 20000; ++i)
+    {
+        if (live.empty() || rand() % 3 != 0)
+        {
+            auto key = dense.acquire();
+            assert(dense.isValid(key) && "Key should be valid");
+            dense[key] = i;
+            live.push_back({ key, i });
+        }
+        else
+        {
+            size_t k = rand() % live.size();
+            dense.destroy(live[k].first);
+            dead.push_back(live[k].first);
+            live[k] = live.back();
+            live.pop_back();
+        }
+
+        assert(dense.size() == live.size() && "Wrong size");
+    }
+
+    for (auto& i : live)
+        assert(dense.isValid(i.first) && dense[i.first] == i.second && "Wrong value");
+
+    for (auto& i : dead)
+        assert(!dense.get(i) && "Key should be invalid");
+
+    // Iteration visits every live object exactly once, in packed order
+    size_t n = 0;
+    for (auto it = dense.begin(), end = dense.end(); it != end; ++it, ++n)
+    {
+        assert(dense.get(it.handle()) == &*it && "Wrong handle");
+        assert(&*it == dense.data() + n && "Not packed");
+    }
+    assert(n == live.size() && "Wrong amount of objects iterated");
+
+    // Objects acquired while iterating are iterated too
+    n = 0;
+    for (auto it = dense.begin(), end = dense.end(); it != end; ++it, ++n)
+        if (n == 0)
+            dense[dense.acquire()] = -1;
+    assert(n == live.size() + 1 && "Objects added while iterating were skipped");
+
+    const auto& cdense = dense;
+    n = 0;
+    for (auto& i : cdense)
+        n += i == -1;
+    assert(n == 1 && "Wrong const iteration");
 
     return 0;
 }
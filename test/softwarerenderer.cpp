@@ -0,0 +1,187 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include <cstring>
+#include "gamelib/core/rendering/SoftwareRenderer.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+sf::Color getPixel(const SoftwareRenderer& renderer, int x, int y)
+{
+    const sf::Uint8* p = renderer.getPixels() + (y * renderer.getSize().x + x) * 4;
+    return sf::Color(p[0], p[1], p[2], p[3]);
+}
+
+size_t countPixels(const SoftwareRenderer& renderer, const sf::Color& color)
+{
+    size_t n = 0;
+    for (unsigned int y = 0; y < renderer.getSize().y; ++y)
+        for (unsigned int x = 0; x < renderer.getSize().x; ++x)
+            if (getPixel(renderer, x, y) == color)
+                ++n;
+    return n;
+}
+
+RenderBatch makeBatch(const vector<sf::Vertex>& vertices, sf::PrimitiveType type)
+{
+    RenderBatch batch;
+    batch.vertices = vertices.data();
+    batch.size = vertices.size();
+    batch.primitiveType = type;
+    return batch;
+}
+
+vector<sf::Vertex> makeQuad(float x, float y, float w, float h, sf::Color color)
+{
+    return {
+        sf::Vertex(sf::Vector2f(x, y), color, sf::Vector2f(0, 0)),
+        sf::Vertex(sf::Vector2f(x + w, y), color, sf::Vector2f(w, 0)),
+        sf::Vertex(sf::Vector2f(x + w, y + h), color, sf::Vector2f(w, h)),
+        sf::Vertex(sf::Vector2f(x, y + h), color, sf::Vector2f(0, h))
+    };
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    SoftwareRenderer renderer(100, 80);
+    renderer.threads = 0;
+
+    // Quads cover exactly their pixels, also when split into triangles
+    renderer.clear(sf::Color::Black);
+    auto quad = makeQuad(10, 20, 30, 15, sf::Color::Red);
+    renderer.draw(makeBatch(quad, sf::Quads));
+    assert(countPixels(renderer, sf::Color::Black) == 100 * 80 && "Drawn before display()");
+    renderer.display();
+    assert(countPixels(renderer, sf::Color::Red) == 30 * 15 && "Wrong quad coverage");
+    assert(getPixel(renderer, 10, 20) == sf::Color::Red && getPixel(renderer, 39, 34) == sf::Color::Red && "Missing corners");
+    assert(getPixel(renderer, 9, 20) == sf::Color::Black && getPixel(renderer, 40, 34) == sf::Color::Black
+            && getPixel(renderer, 10, 35) == sf::Color::Black && "Quad too large");
+
+    // Adjacent triangles don't overlap or leave gaps
+    renderer.clear(sf::Color::Black);
+    vector<sf::Vertex> fan;
+    fan.push_back(sf::Vertex(sf::Vector2f(50, 40), sf::Color(0, 0, 0, 255)));
+    for (int i = 0; i <= 16; ++i)
+    {
+        float a = i * 2 * 3.14159265f / 16;
+        fan.push_back(sf::Vertex(sf::Vector2f(50 + 30 * cos(a), 40 + 30 * sin(a)), sf::Color(0, 0, 0, 255)));
+    }
+    fan.back().position = fan[1].position;
+    auto fanbatch = makeBatch(fan, sf::TriangleFan);
+    fanbatch.states.blendMode = sf::BlendAdd;
+    for (auto& v : fan)
+        v.color = sf::Color(100, 0, 0, 255);
+    renderer.draw(fanbatch);
+    renderer.display();
+    assert(countPixels(renderer, sf::Color(200, 0, 0)) == 0 && "Triangles overlap");
+    assert(getPixel(renderer, 50, 40) == sf::Color(100, 0, 0) && "Gap in triangle fan");
+
+    // Alpha blending
+    renderer.clear(sf::Color(0, 0, 200));
+    quad = makeQuad(0, 0, 10, 10, sf::Color(255, 0, 0, 128));
+    renderer.draw(makeBatch(quad, sf::Quads));
+    renderer.display();
+    sf::Color c = getPixel(renderer, 5, 5);
+    assert(c.r == 128 && c.g == 0 && c.b >= 99 && c.b <= 100 && c.a == 255 && "Wrong alpha blending");
+
+    // Later draw calls are drawn on top
+    renderer.clear(sf::Color::Black);
+    auto a = makeQuad(0, 0, 100, 80, sf::Color::Red);
+    auto b = makeQuad(20, 20, 10, 10, sf::Color::White);
+    renderer.draw(makeBatch(a, sf::Quads));
+    renderer.draw(makeBatch(b, sf::Quads));
+    renderer.display();
+    assert(countPixels(renderer, sf::Color::White) == 100 && "Wrong draw order");
+
+    // View and viewport, only the right half is drawn to
+    renderer.clear(sf::Color::Black);
+    sf::View view(sf::FloatRect(0, 0, 50, 80));
+    view.setViewport(sf::FloatRect(0.5, 0, 0.5, 1));
+    renderer.setView(view);
+    a = makeQuad(-100, -100, 300, 300, sf::Color::Red);
+    renderer.draw(makeBatch(a, sf::Quads));
+    renderer.display();
+    assert(countPixels(renderer, sf::Color::Red) == 50 * 80 && "Not clipped to the viewport");
+    assert(getPixel(renderer, 49, 0) == sf::Color::Black && getPixel(renderer, 50, 0) == sf::Color::Red && "Wrong viewport");
+
+    renderer.clear(sf::Color::Black);
+    b = makeQuad(0, 0, 10, 10, sf::Color::Red);
+    renderer.draw(makeBatch(b, sf::Quads));
+    renderer.display();
+    assert(countPixels(renderer, sf::Color::Red) == 100 && getPixel(renderer, 50, 0) == sf::Color::Red && "Wrong view transform");
+    renderer.setView(sf::View(sf::FloatRect(0, 0, 100, 80)));
+
+    // Textures, unknown textures are drawn untextured
+    sf::Image img;
+    img.create(4, 4, sf::Color::Red);
+    img.setPixel(3, 2, sf::Color::White);
+    sf::Texture tex;
+    quad = makeQuad(0, 0, 8, 8, sf::Color::White);
+    auto texbatch = makeBatch(quad, sf::Quads);
+    texbatch.states.texture = &tex;
+
+    renderer.clear(sf::Color::Black);
+    renderer.draw(texbatch);
+    renderer.display();
+    assert(countPixels(renderer, sf::Color::White) == 64 && "Unknown texture not ignored");
+
+    renderer.setTextureImage(&tex, &img);
+    renderer.clear(sf::Color::Black);
+    renderer.draw(texbatch);
+    renderer.display();
+    assert(getPixel(renderer, 3, 2) == sf::Color::White && getPixel(renderer, 2, 2) == sf::Color::Red && "Wrong texel");
+    assert(countPixels(renderer, sf::Color::White) == 5 && "Texture not clamped");
+
+    tex.setRepeated(true);
+    renderer.clear(sf::Color::Black);
+    renderer.draw(texbatch);
+    renderer.display();
+    assert(getPixel(renderer, 7, 6) == sf::Color::White && countPixels(renderer, sf::Color::White) == 4 && "Texture not repeated");
+    renderer.setTextureImage(&tex, nullptr);
+
+    // Lines and points
+    renderer.clear(sf::Color::Black);
+    vector<sf::Vertex> lines = {
+        sf::Vertex(sf::Vector2f(10.5, 5.5), sf::Color::Red), sf::Vertex(sf::Vector2f(19.5, 5.5), sf::Color::Red),
+        sf::Vertex(sf::Vector2f(-10.5, 6.5), sf::Color::Red), sf::Vertex(sf::Vector2f(199.5, 6.5), sf::Color::Red)
+    };
+    renderer.draw(makeBatch(lines, sf::Lines));
+    vector<sf::Vertex> points = {
+        sf::Vertex(sf::Vector2f(3.5, 70.5), sf::Color::White), sf::Vertex(sf::Vector2f(-1, 1), sf::Color::White)
+    };
+    renderer.draw(makeBatch(points, sf::Points));
+    renderer.display();
+    assert(countPixels(renderer, sf::Color::Red) == 10 + 100 && "Wrong line pixels");
+    assert(getPixel(renderer, 3, 70) == sf::Color::White && countPixels(renderer, sf::Color::White) == 1 && "Wrong point pixels");
+
+    // Random triangles give the same result regardless of the amount of threads
+    vector<sf::Vertex> tris;
+    for (int i = 0; i < 300; ++i)
+        tris.push_back(sf::Vertex(sf::Vector2f(rand() % 1200 - 100, rand() % 1000 - 100),
+                    sf::Color(rand() % 256, rand() % 256, rand() % 256, rand() % 256)));
+
+    vector<sf::Uint8> expected;
+    for (size_t threads : { 0, 1, 3 })
+    {
+        SoftwareRenderer r(1000, 800);
+        r.threads = threads;
+        r.clear(sf::Color(20, 40, 60));
+        r.draw(makeBatch(tris, sf::Triangles));
+        r.draw(makeBatch(tris, sf::TriangleStrip));
+        r.display();
+
+        if (expected.empty())
+            expected.assign(r.getPixels(), r.getPixels() + 1000 * 800 * 4);
+        else
+            assert(memcmp(expected.data(), r.getPixels(), expected.size()) == 0 && "Results differ between thread counts");
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include "gamelib/utils/SpatialGrid.hpp"
+
+using namespace std;
+using namespace gamelib;
+
+struct TestObject
+{
+    math::AABBf bbox;
+    int proxy;
+    bool alive;
+};
+
+math::AABBf randomBox()
+{
+    // Some boxes are large enough to end up in the oversized list
+    int size = rand() % 10 == 0 ? 2000 : 50;
+    return math::AABBf(rand() % 3000 - 1500, rand() % 3000 - 1500, 1 + rand() % size, 1 + rand() % size);
+}
+
+void checkQuery(const SpatialGrid<int>& grid, const math::AABBf& rect, const std::vector<TestObject>& objects)
+{
+    std::vector<int> result, expected;
+    grid.query(rect, &result);
+
+    for (size_t i = 0; i < objects.size(); ++i)
+        if (objects[i].alive && math::intersect(rect, objects[i].bbox))
+            expected.push_back(i);
+
+    std::sort(result.begin(), result.end());
+    assert(std::adjacent_find(result.begin(), result.end()) == result.end() && "Duplicate result");
+    assert(result == expected && "Wrong result");
+}
+
+int main()
+{
+    auto seed = time(0);
+    srand(seed);
+    cout<<"seed: "<<seed<<endl;
+
+    SpatialGrid<int> grid(64);
+    std::vector<TestObject> objects;
+
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        TestObject obj;
+        obj.bbox = randomBox();
+        obj.proxy = grid.add(i, obj.bbox);
+        obj.alive = true;
+        objects.push_back(obj);
+    }
+
+    assert(grid.size() == 2000 && "Wrong size");
+
+    for (size_t round = 0; round < 5000; ++round)
+    {
+        size_t index = rand() % objects.size();
+        auto& obj = objects[index];
+
+        switch (rand() % 4)
+        {
+            case 0: // move
+                if (!obj.alive)
+                    break;
+                obj.bbox.x += rand() % 201 - 100;
+                obj.bbox.y += rand() % 201 - 100;
+                grid.update(obj.proxy, obj.bbox);
+                break;
+            case 1: // resize
+                if (!obj.alive)
+                    break;
+                obj.bbox = randomBox();
+                grid.update(obj.proxy, obj.bbox);
+                break;
+            case 2: // remove / readd
+                if (obj.alive)
+                    grid.remove(obj.proxy);
+                else
+                    obj.proxy = grid.add(index, obj.bbox);
+                obj.alive = !obj.alive;
+                break;
+            case 3:
+                checkQuery(grid, randomBox(), objects);
+                break;
+        }
+
+        assert(grid.get(objects[index].proxy) == (int)index || !objects[index].alive);
+    }
+
+    // Queries covering more cells than are occupied
+    checkQuery(grid, math::AABBf(-100000, -100000, 200000, 200000), objects);
+
+    for (auto& obj : objects)
+        if (obj.alive)
+            grid.remove(obj.proxy);
+
+    assert(grid.size() == 0 && "Grid should be empty");
+
+    std::vector<int> result;
+    grid.query(math::AABBf(-1000, -1000, 2000, 2000), &result);
+    assert(result.empty() && "Grid should be empty");
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include "gamelib/utils/ThreadPool.hpp"
+
+using namespace gamelib;
+
+int main()
+{
+    for (size_t numthreads : { 0, 1, 3, 8 })
+    {
+        ThreadPool pool(numthreads);
+        assert(pool.getNumThreads() == numthreads && "Wrong number of threads");
+
+        for (size_t numtasks : { 0, 1, 2, 7, 100, 1000 })
+        {
+            // Repeat to check that runs don't interfere with each other
+            for (size_t round = 0; round < 20; ++round)
+            {
+                std::vector<std::atomic<int>> counters(numtasks);
+                for (auto& i : counters)
+                    i = 0;
+
+                // Uneven workloads trigger stealing
+                pool.run(numtasks, [&](size_t task) {
+                        volatile size_t sink = 0;
+                        for (size_t i = 0; i < (task % 10) * 1000; ++i)
+                            sink += i;
+                        ++counters[task];
+                    });
+
+                for (auto& i : counters)
+                    assert(i == 1 && "Task was not run exactly once");
+            }
+        }
+    }
+
+    return 0;
+}